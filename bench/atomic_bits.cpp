@@ -0,0 +1,94 @@
+// Field updates of one shared 64-bit word from several threads: a mutex
+// around setBits compared with the lock-free functions in atomic_bits.hpp.
+// Pass the largest thread count to try; the default is the number of cores.
+
+#include "bench.hpp"
+#include "atomic_bits.hpp"
+#include <cinttypes>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+const unsigned UPDATES = 1 << 18;
+
+// Each thread owns a 16-bit field of word; thread t uses field t % 4.
+template<typename Update>
+void run(const char* label, unsigned threadCount, Update update) {
+    char name[96];
+    std::snprintf(name, sizeof(name), "%s, %u thread%s", label, threadCount, threadCount == 1 ? "" : "s");
+    bench::report(name, bench::timeIt([&] {
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < threadCount; ++t) {
+            threads.push_back(std::thread([&update, t] {
+                for (unsigned i = 0; i < UPDATES; ++i) {
+                    update(t % 4, i);
+                }
+            }));
+        }
+        for (size_t t = 0; t < threads.size(); ++t) {
+            threads[t].join();
+        }
+    }), static_cast<double>(UPDATES) * threadCount);
+}
+
+template<unsigned lsb>
+void setField(std::atomic<uint64_t>& word, unsigned value) {
+    atomicSetBits<16, lsb>(word, value, std::memory_order_relaxed);
+}
+
+template<unsigned lsb>
+void toggleBit(std::atomic<uint64_t>& word, unsigned value) {
+    if (value & 1) {
+        atomicSetBit<lsb>(word, std::memory_order_relaxed);
+    } else {
+        atomicClearBit<lsb>(word, std::memory_order_relaxed);
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned maxThreads = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : cores;
+
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        std::mutex mutex;
+        uint64_t locked = 0;
+        run("mutex + setBits", threads, [&](unsigned field, unsigned value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            switch (field) {
+            case 0: setBits<16, 0>(locked, value); break;
+            case 1: setBits<16, 16>(locked, value); break;
+            case 2: setBits<16, 32>(locked, value); break;
+            default: setBits<16, 48>(locked, value); break;
+            }
+        });
+        bench::doNotOptimize(locked);
+
+        std::atomic<uint64_t> word(0);
+        run("atomicSetBits (CAS loop)", threads, [&](unsigned field, unsigned value) {
+            switch (field) {
+            case 0: setField<0>(word, value); break;
+            case 1: setField<16>(word, value); break;
+            case 2: setField<32>(word, value); break;
+            default: setField<48>(word, value); break;
+            }
+        });
+
+        run("atomicSetBit/ClearBit (fetch_or/and)", threads, [&](unsigned field, unsigned value) {
+            switch (field) {
+            case 0: toggleBit<0>(word, value); break;
+            case 1: toggleBit<16>(word, value); break;
+            case 2: toggleBit<32>(word, value); break;
+            default: toggleBit<48>(word, value); break;
+            }
+        });
+        bench::doNotOptimize(word);
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+#ifndef BITS_BENCH_HPP
+#define BITS_BENCH_HPP
+
+// Minimal timing helpers shared by the benchmarks. Each benchmark is a plain
+// executable that prints one line per measurement.
+
+#include "bitset.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstddef>
+
+namespace bench {
+
+/**
+ * Keep the compiler from discarding a computed value.
+ */
+template<typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * Run fn repeatedly for at least minSeconds and return the mean seconds per call.
+ */
+template<typename Fn>
+double timeIt(Fn fn, double minSeconds = 0.2) {
+    typedef std::chrono::steady_clock Clock;
+    fn(); // warm up caches and the kernel dispatch
+    std::size_t iterations = 0;
+    const Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    do {
+        fn();
+        ++iterations;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    return elapsed / iterations;
+}
+
+/**
+ * xorshift64: a fixed sequence per seed, cheap enough to fill large inputs.
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed) : x_(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+    uint64_t next() {
+        x_ ^= x_ << 13;
+        x_ ^= x_ >> 7;
+        x_ ^= x_ << 17;
+        return x_;
+    }
+
+private:
+    uint64_t x_;
+};
+
+/**
+ * A set of size bits with each bit set with probability 1 / density.
+ */
+inline bits::Bitset randomBits(std::size_t size, unsigned density, uint64_t seed) {
+    bits::Bitset set(size);
+    Random random(seed);
+    for (std::size_t i = 0; i < size; ++i) {
+        if (random.next() % density == 0) {
+            set.set(i);
+        }
+    }
+    return set;
+}
+
+/**
+ * Print a throughput line: name, nanoseconds per item and millions of items per second.
+ */
+inline void report(const char* name, double secondsPerCall, double itemsPerCall) {
+    std::printf("%-48s %8.3f ns/item %10.1f Mitems/s\n", name,
+        secondsPerCall * 1e9 / itemsPerCall, itemsPerCall / secondsPerCall / 1e6);
+}
+
+/**
+ * Print a bandwidth line: name and gigabytes per second.
+ */
+inline void reportBytes(const char* name, double secondsPerCall, double bytesPerCall) {
+    std::printf("%-48s %8.3f GB/s\n", name, bytesPerCall / secondsPerCall / 1e9);
+}
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+// BitWriter/BitReader throughput in fields and in bytes of stream.
+
+#include "bench.hpp"
+#include "bit_stream.hpp"
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+template<typename Order>
+void run(const char* label, const std::vector<unsigned>& widths, const std::vector<uint64_t>& values) {
+    const size_t n = widths.size();
+    char name[96];
+    std::vector<unsigned char> stream;
+
+    BitWriter<Order> writer;
+    const double writeSeconds = bench::timeIt([&] {
+        writer.clear();
+        for (size_t i = 0; i < n; ++i) {
+            writer.put(widths[i], values[i]);
+        }
+        bench::doNotOptimize(writer.finish()[0]);
+    });
+    stream = writer.finish();
+
+    std::snprintf(name, sizeof(name), "%s BitWriter::put", label);
+    bench::report(name, writeSeconds, n);
+    bench::reportBytes(name, writeSeconds, stream.size());
+
+    const double readSeconds = bench::timeIt([&] {
+        BitReader<Order> reader(stream.data(), stream.size());
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += reader.get(widths[i]);
+        }
+        bench::doNotOptimize(sum);
+    });
+    std::snprintf(name, sizeof(name), "%s BitReader::get", label);
+    bench::report(name, readSeconds, n);
+    bench::reportBytes(name, readSeconds, stream.size());
+
+    const double fixedSeconds = bench::timeIt([&] {
+        BitReader<Order> reader(stream.data(), stream.size());
+        uint64_t sum = 0;
+        for (size_t i = 0; i < stream.size() * 8 / 12; ++i) {
+            sum += reader.template get<12>();
+        }
+        bench::doNotOptimize(sum);
+    });
+    std::snprintf(name, sizeof(name), "%s BitReader::get<12>", label);
+    bench::reportBytes(name, fixedSeconds, stream.size());
+}
+
+}
+
+int main() {
+    const size_t n = 1 << 20;
+    std::vector<unsigned> widths(n);
+    std::vector<uint64_t> values(n);
+    bench::Random random(0);
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t x = random.next();
+        widths[i] = static_cast<unsigned>(x % 32) + 1; // 1-32 bits, 16.5 on average
+        values[i] = x >> (64 - widths[i]);
+    }
+    run<LsbFirst>("lsb-first", widths, values);
+    run<MsbFirst>("msb-first", widths, values);
+    return 0;
+}
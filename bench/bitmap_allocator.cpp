@@ -0,0 +1,156 @@
+// Slot allocation at several occupancies: a linear scan of the occupancy
+// bits one at a time, a word-at-a-time scan with findNextClear, and
+// BitmapAllocator and AtomicBitmapAllocator. Each item is one allocation
+// plus the free of a random allocated slot, which keeps the occupancy
+// steady. Pass the number of slots and the largest thread count to try.
+
+#include "bench.hpp"
+#include "bitmap_allocator.hpp"
+#include <cinttypes>
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+const unsigned CHURN = 1 << 10;
+
+/** Occupancy bits with a linear search for a clear bit. */
+class ScanPool {
+public:
+    explicit ScanPool(size_t capacity) : used_(capacity) {}
+
+    bool free(size_t slot) {
+        used_.reset(slot);
+        return true;
+    }
+
+    void allocateAll() { used_.set(); }
+
+protected:
+    size_t take(size_t i) {
+        if (i < used_.size()) {
+            used_.set(i);
+        }
+        return i;
+    }
+
+    Bitset used_;
+};
+
+/** Searches one bit at a time from slot 0. */
+class BitScanPool : public ScanPool {
+public:
+    explicit BitScanPool(size_t capacity) : ScanPool(capacity) {}
+
+    size_t allocate() {
+        const uint64_t* words = used_.data();
+        size_t i = 0;
+        while (i < used_.size() && ((words[i / 64] >> (i % 64)) & 1) != 0) {
+            ++i;
+        }
+        return take(i);
+    }
+};
+
+/** Searches a word at a time from slot 0. */
+class WordScanPool : public ScanPool {
+public:
+    explicit WordScanPool(size_t capacity) : ScanPool(capacity) {}
+
+    size_t allocate() { return take(used_.findNextClear(0)); }
+};
+
+void allocateAll(ScanPool& pool) {
+    pool.allocateAll();
+}
+
+template<typename Word>
+void allocateAll(BasicBitmapAllocator<Word>& pool) {
+    while (pool.allocate() < pool.capacity()) {
+    }
+}
+
+/** Fill pool to occupancy and return the allocated slots. */
+template<typename Pool>
+std::vector<size_t> fill(Pool& pool, size_t capacity, double occupancy, uint64_t seed) {
+    allocateAll(pool);
+    std::vector<size_t> live(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+        live[i] = i;
+    }
+    bench::Random random(seed);
+    while (live.size() > static_cast<size_t>(capacity * occupancy)) {
+        const size_t i = static_cast<size_t>(random.next() % live.size());
+        pool.free(live[i]);
+        live[i] = live.back();
+        live.pop_back();
+    }
+    return live;
+}
+
+template<typename Pool>
+void churn(Pool& pool, std::vector<size_t>& live, bench::Random& random) {
+    for (unsigned n = 0; n < CHURN; ++n) {
+        const size_t slot = pool.allocate();
+        const size_t i = static_cast<size_t>(random.next() % live.size());
+        pool.free(live[i]);
+        live[i] = slot;
+    }
+}
+
+template<typename Pool>
+void run(const char* label, size_t capacity, double occupancy) {
+    Pool pool(capacity);
+    std::vector<size_t> live = fill(pool, capacity, occupancy, 1);
+    bench::Random random(2);
+    char name[96];
+    std::snprintf(name, sizeof(name), "%s, %.2f%% full", label, occupancy * 100);
+    bench::report(name, bench::timeIt([&] { churn(pool, live, random); }), CHURN);
+}
+
+void runThreads(unsigned threadCount, size_t capacity, double occupancy) {
+    AtomicBitmapAllocator pool(capacity);
+    std::vector<size_t> all = fill(pool, capacity, occupancy, 1);
+    std::vector<std::vector<size_t> > live(threadCount);
+    for (size_t i = 0; i < all.size(); ++i) {
+        live[i % threadCount].push_back(all[i]);
+    }
+    char name[96];
+    std::snprintf(name, sizeof(name), "AtomicBitmapAllocator, %.2f%% full, %u threads",
+        occupancy * 100, threadCount);
+    bench::report(name, bench::timeIt([&] {
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < threadCount; ++t) {
+            threads.push_back(std::thread([&pool, &live, t] {
+                bench::Random random(t + 2);
+                churn(pool, live[t], random);
+            }));
+        }
+        for (size_t t = 0; t < threads.size(); ++t) {
+            threads[t].join();
+        }
+    }), static_cast<double>(CHURN) * threadCount);
+}
+
+}
+
+int main(int argc, char** argv) {
+    const size_t capacity = argc > 1 ? static_cast<size_t>(atoll(argv[1])) : static_cast<size_t>(1) << 20;
+    const unsigned maxThreads = argc > 2 ? static_cast<unsigned>(atoi(argv[2]))
+        : std::max(2u, std::thread::hardware_concurrency());
+    const double occupancies[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (unsigned o = 0; o < 4; ++o) {
+        run<BitScanPool>("bit scan", capacity, occupancies[o]);
+        run<WordScanPool>("word scan", capacity, occupancies[o]);
+        run<BitmapAllocator>("BitmapAllocator", capacity, occupancies[o]);
+        run<AtomicBitmapAllocator>("AtomicBitmapAllocator", capacity, occupancies[o]);
+        for (unsigned threads = 2; threads <= maxThreads; threads *= 2) {
+            runThreads(threads, capacity, occupancies[o]);
+        }
+    }
+    return 0;
+}
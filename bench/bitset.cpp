@@ -0,0 +1,128 @@
+// Bitset operations compared with plain word loops, and each count kernel
+// on its own. Sizes are in bits; the default fits two sets in L2.
+
+#include "bench.hpp"
+#include "bitset.hpp"
+#include <cinttypes>
+#include <cstdlib>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+template<typename Kernel>
+void runCount(const char* name, const Bitset& a, const Bitset& b, Kernel kernel) {
+    const double seconds = bench::timeIt([&] {
+        bench::doNotOptimize(kernel(a.data(), b.data(), a.wordCount()));
+    });
+    bench::reportBytes(name, seconds, 2.0 * a.wordCount() * sizeof(uint64_t));
+}
+
+void runDecode(const char* kernelName, unsigned density, const Bitset& set,
+    std::vector<uint32_t>& out, detail::SetBitIndexesFn kernel) {
+    char name[96];
+    std::snprintf(name, sizeof(name), "1/%u set: setBitIndexes %s", density, kernelName);
+    const size_t count = set.count();
+    bench::report(name, bench::timeIt([&] {
+        kernel(set.data(), set.wordCount(), out.data(), out.data() + count);
+        bench::doNotOptimize(out[0]);
+    }), set.size());
+}
+
+}
+
+int main(int argc, char** argv) {
+    const size_t bits = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 1 << 20;
+    Bitset a(bits);
+    Bitset b(bits);
+    bench::Random random(0);
+    for (size_t i = 0; i < a.wordCount(); ++i) {
+        a.data()[i] = random.next();
+        b.data()[i] = random.next();
+    }
+    a.resize(bits);
+    b.resize(bits);
+    const double bytes = 2.0 * a.wordCount() * sizeof(uint64_t);
+    const size_t n = a.wordCount();
+
+    std::vector<uint64_t> scratch(n);
+    bench::reportBytes("word loop: and then count", bench::timeIt([&] {
+        for (size_t i = 0; i < n; ++i) {
+            scratch[i] = a.data()[i] & b.data()[i];
+        }
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i) {
+            count += detail::popcount64(scratch[i]);
+        }
+        bench::doNotOptimize(count);
+    }), bytes);
+
+    bench::reportBytes("Bitset: (a & b).count()", bench::timeIt([&] {
+        bench::doNotOptimize((a & b).count());
+    }), bytes);
+
+    bench::reportBytes("Bitset: andCount(a, b)", bench::timeIt([&] {
+        bench::doNotOptimize(andCount(a, b));
+    }), bytes);
+
+    bench::reportBytes("word loop: a |= b", bench::timeIt([&] {
+        for (size_t i = 0; i < n; ++i) {
+            a.data()[i] |= b.data()[i];
+        }
+        bench::doNotOptimize(a.data()[0]);
+    }), bytes);
+
+    bench::reportBytes("Bitset: a |= b", bench::timeIt([&] {
+        a |= b;
+        bench::doNotOptimize(a.data()[0]);
+    }), bytes);
+
+    const Bitset copy = a;
+    bench::reportBytes("Bitset: a == copy of a", bench::timeIt([&] {
+        bench::doNotOptimize(a == copy);
+    }), bytes);
+
+    runCount("andCount kernel: portable", a, b, &detail::countPortable<detail::OpAnd>);
+#if defined(BITS_X86)
+    const CpuFeatures& cpu = cpuFeatures();
+    if (cpu.popcnt) {
+        runCount("andCount kernel: popcnt", a, b, &detail::countPopcnt<detail::OpAnd>);
+    }
+    if (cpu.avx2 && cpu.popcnt) {
+        runCount("andCount kernel: avx2", a, b, &detail::countAvx2<detail::OpAnd>);
+    }
+    if (cpu.avx512f && cpu.avx512vpopcntdq && cpu.popcnt) {
+        runCount("andCount kernel: avx512", a, b, &detail::countAvx512<detail::OpAnd>);
+    }
+#endif
+
+    // decoding set bits to indexes, in bits of bitmap per second
+    std::vector<uint32_t> indexes(bits);
+    const unsigned densities[] = { 2, 8, 64 };
+    for (unsigned d = 0; d < 3; ++d) {
+        const Bitset sparse = bench::randomBits(bits, densities[d], d + 1);
+        char name[96];
+        std::snprintf(name, sizeof(name), "1/%u set: getUbits per position", densities[d]);
+        bench::report(name, bench::timeIt([&] {
+            uint32_t* out = indexes.data();
+            for (size_t i = 0; i < bits; ++i) {
+                if (getUbits(sparse.data()[i / 64], 1, static_cast<unsigned>(i % 64)) != 0) {
+                    *out++ = static_cast<uint32_t>(i);
+                }
+            }
+            bench::doNotOptimize(out);
+        }), bits);
+
+        runDecode("portable (TZCNT/BLSR)", densities[d], sparse, indexes, &detail::setBitIndexesPortable);
+#if defined(BITS_X86)
+        if (cpu.avx2 && cpu.popcnt) {
+            runDecode("avx2 lookup table", densities[d], sparse, indexes, &detail::setBitIndexesAvx2);
+        }
+        if (cpu.avx512f && cpu.popcnt) {
+            runDecode("avx512 vpcompressd", densities[d], sparse, indexes, &detail::setBitIndexesAvx512);
+        }
+#endif
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+// BitsetView over a memory-mapped file against the in-memory
+// RankSelectBitVector it was written from. "open" maps and parses the file
+// (where mmap is available) or parses a buffer; "build" rebuilds the index
+// from a Bitset, which is what loading without the format costs. Pass the
+// size in bits.
+
+#include "bench.hpp"
+#include "bitset_view.hpp"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__unix__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+using namespace bits;
+
+namespace {
+
+void queries(const BitsetView& view, const RankSelectBitVector& index,
+        const std::vector<size_t>& positions, const std::vector<size_t>& ranks) {
+    bench::report("rank1, view", bench::timeIt([&] {
+        size_t sum = 0;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            sum += view.rank1(positions[i]);
+        }
+        bench::doNotOptimize(sum);
+    }), static_cast<double>(positions.size()));
+    bench::report("rank1, RankSelectBitVector", bench::timeIt([&] {
+        size_t sum = 0;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            sum += index.rank1(positions[i]);
+        }
+        bench::doNotOptimize(sum);
+    }), static_cast<double>(positions.size()));
+    bench::report("select1, view", bench::timeIt([&] {
+        size_t sum = 0;
+        for (size_t i = 0; i < ranks.size(); ++i) {
+            sum += view.select1(ranks[i]);
+        }
+        bench::doNotOptimize(sum);
+    }), static_cast<double>(ranks.size()));
+    bench::report("select1, RankSelectBitVector", bench::timeIt([&] {
+        size_t sum = 0;
+        for (size_t i = 0; i < ranks.size(); ++i) {
+            sum += index.select1(ranks[i]);
+        }
+        bench::doNotOptimize(sum);
+    }), static_cast<double>(ranks.size()));
+}
+
+}
+
+int main(int argc, char** argv) {
+    const size_t size = argc > 1 ? static_cast<size_t>(atoll(argv[1])) : static_cast<size_t>(1) << 26;
+    const Bitset bits = bench::randomBits(size, 3, 1);
+    const Bitset other = bench::randomBits(size, 3, 2);
+    const RankSelectBitVector index(bits);
+    const size_t bytes = BitsetView::bytes(index);
+    std::printf("%zu bits, %zu file bytes\n", size, bytes);
+
+    std::vector<uint64_t> buffer(bytes / sizeof(uint64_t));
+    if (!BitsetView::write(index, buffer.data(), bytes)) {
+        std::printf("serialization needs a little-endian host\n");
+        return 1;
+    }
+    const void* data = buffer.data();
+
+#if defined(__unix__)
+    char path[] = "/tmp/bench_bitset_view_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0 || write(fd, buffer.data(), bytes) != static_cast<ssize_t>(bytes)) {
+        std::printf("cannot write %s\n", path);
+        return 1;
+    }
+    bench::report("open (mmap + parse)", bench::timeIt([&] {
+        void* mapped = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        BitsetView view;
+        bench::doNotOptimize(BitsetView::parse(mapped, bytes, view));
+        munmap(mapped, bytes);
+    }), 1);
+    void* mapped = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    unlink(path);
+    if (mapped == MAP_FAILED) {
+        std::printf("cannot map %s\n", path);
+        return 1;
+    }
+    data = mapped;
+#else
+    bench::report("open (parse)", bench::timeIt([&] {
+        BitsetView view;
+        bench::doNotOptimize(BitsetView::parse(data, bytes, view));
+    }), 1);
+#endif
+    bench::report("build (RankSelectBitVector)", bench::timeIt([&] {
+        bench::doNotOptimize(RankSelectBitVector(bits).count());
+    }), 1);
+
+    BitsetView view;
+    if (!BitsetView::parse(data, bytes, view)) {
+        std::printf("parse failed\n");
+        return 1;
+    }
+
+    std::vector<size_t> positions(1 << 16);
+    std::vector<size_t> ranks(1 << 16);
+    bench::Random random(12345);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const uint64_t x = random.next();
+        positions[i] = static_cast<size_t>(x % size);
+        ranks[i] = static_cast<size_t>(x % view.count());
+    }
+    queries(view, index, positions, ranks);
+
+    bench::reportBytes("andCount, view", bench::timeIt([&] {
+        bench::doNotOptimize(andCount(view, other));
+    }), static_cast<double>(size / 8));
+    bench::reportBytes("andCount, Bitset", bench::timeIt([&] {
+        bench::doNotOptimize(andCount(bits, other));
+    }), static_cast<double>(size / 8));
+    bench::reportBytes("forEachSetBit, view", bench::timeIt([&] {
+        size_t n = 0;
+        view.forEachSetBit([&](size_t) { ++n; });
+        bench::doNotOptimize(n);
+    }), static_cast<double>(size / 8));
+    return 0;
+}
@@ -0,0 +1,138 @@
+// Bloom filter lookups in a filter larger than the caches: a standard filter
+// that sets k scattered bits of a Bitset, BlockedBloomFilter and
+// RegisterBloomFilter, one key at a time and through containsMany. Also
+// prints each filter's measured false positive rate against its expected
+// rate. Pass the number of keys and the bits per key.
+
+#include "bench.hpp"
+#include "bloom.hpp"
+#include <cinttypes>
+#include <cstdlib>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+std::vector<uint64_t> randomKeys(size_t n, uint64_t seed) {
+    std::vector<uint64_t> keys(n);
+    bench::Random random(seed);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = random.next();
+    }
+    return keys;
+}
+
+/** k bits anywhere in the filter, from double hashing. */
+class StandardBloomFilter {
+public:
+    StandardBloomFilter(size_t keys, double bitsPerKey)
+        : k_(static_cast<unsigned>(bitsPerKey * 0.693 + 0.5)), keys_(0),
+          bits_(static_cast<size_t>(keys * bitsPerKey)) {}
+
+    void add(uint64_t key) {
+        const uint64_t hash = detail::bloomHash(key);
+        for (unsigned i = 0; i < k_; ++i) {
+            bits_.set(position(hash, i));
+        }
+        ++keys_;
+    }
+
+    bool contains(uint64_t key) const {
+        const uint64_t hash = detail::bloomHash(key);
+        for (unsigned i = 0; i < k_; ++i) {
+            if (!bits_[position(hash, i)]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t containsMany(const uint64_t* keys, size_t n, bool* out) const {
+        size_t found = 0;
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = contains(keys[i]);
+            found += out[i];
+        }
+        return found;
+    }
+
+    void clear() {
+        bits_.reset();
+        keys_ = 0;
+    }
+
+    size_t bits() const { return bits_.size(); }
+
+    double falsePositiveRate() const { return bloomFalsePositiveRate(keys_, bits_.size(), k_); }
+
+private:
+    size_t position(uint64_t hash, unsigned i) const {
+        const uint32_t h = static_cast<uint32_t>(hash) + i * static_cast<uint32_t>(hash >> 32);
+        return static_cast<size_t>((static_cast<uint64_t>(h) * bits_.size()) >> 32);
+    }
+
+    unsigned k_;
+    size_t keys_;
+    Bitset bits_;
+};
+
+template<typename Filter>
+void run(const char* label, Filter& filter, const std::vector<uint64_t>& keys,
+    const std::vector<uint64_t>& others) {
+    char name[96];
+    std::snprintf(name, sizeof(name), "%s, add", label);
+    bench::report(name, bench::timeIt([&] {
+        filter.clear();
+        for (size_t i = 0; i < keys.size(); ++i) {
+            filter.add(keys[i]);
+        }
+    }, 0), static_cast<double>(keys.size()));
+
+    // mixed hits and misses, as in front of a disk lookup
+    std::vector<uint64_t> queries(others.begin(), others.end());
+    for (size_t i = 0; i < queries.size(); i += 2) {
+        queries[i] = keys[i % keys.size()];
+    }
+    std::snprintf(name, sizeof(name), "%s, contains", label);
+    bench::report(name, bench::timeIt([&] {
+        size_t found = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            found += filter.contains(queries[i]);
+        }
+        bench::doNotOptimize(found);
+    }), static_cast<double>(queries.size()));
+
+    std::vector<char> out(queries.size());
+    std::snprintf(name, sizeof(name), "%s, containsMany", label);
+    bench::report(name, bench::timeIt([&] {
+        bench::doNotOptimize(filter.containsMany(queries.data(), queries.size(),
+            reinterpret_cast<bool*>(out.data())));
+    }), static_cast<double>(queries.size()));
+
+    // the best k for a standard filter with the same bits per key
+    const unsigned k = static_cast<unsigned>(0.693 * filter.bits() / keys.size() + 0.5);
+    const size_t falsePositives = filter.containsMany(others.data(), others.size(),
+        reinterpret_cast<bool*>(out.data()));
+    std::printf("%s: false positives %.4f%%, expected %.4f%%, standard filter of the same size %.4f%%\n",
+        label, 100.0 * falsePositives / others.size(), 100 * filter.falsePositiveRate(),
+        100 * bloomFalsePositiveRate(keys.size(), filter.bits(), k));
+}
+
+}
+
+int main(int argc, char** argv) {
+    const size_t n = argc > 1 ? static_cast<size_t>(atoll(argv[1])) : static_cast<size_t>(1) << 24;
+    const double bitsPerKey = argc > 2 ? atof(argv[2]) : 10;
+    const std::vector<uint64_t> keys = randomKeys(n, 1);
+    const std::vector<uint64_t> others = randomKeys(std::min<size_t>(n, 1 << 22), 2);
+    std::printf("%zu keys, %.1f bits per key\n", n, bitsPerKey);
+
+    StandardBloomFilter standard(n, bitsPerKey);
+    run("standard", standard, keys, others);
+    BlockedBloomFilter blocked(n, bitsPerKey);
+    run("BlockedBloomFilter", blocked, keys, others);
+    RegisterBloomFilter registers(n, bitsPerKey);
+    run("RegisterBloomFilter", registers, keys, others);
+    return 0;
+}
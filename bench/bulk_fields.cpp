@@ -0,0 +1,106 @@
+// Bulk extraction and insertion kernels compared with getSbits/setBits loops.
+
+#include "bench.hpp"
+#include "bulk.hpp"
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+template<typename T, typename Out>
+void run(const char* label, size_t n) {
+    std::vector<T> in(n);
+    bench::Random random(0);
+    for (size_t i = 0; i < n; ++i) {
+        in[i] = static_cast<T>(random.next());
+    }
+    std::vector<Out> out(n);
+    const unsigned lsb = sizeof(T) * BITS_IN_BYTE - 20;
+    typedef void (*Kernel)(const T*, size_t, Out*, unsigned, unsigned);
+    char name[96];
+
+    std::snprintf(name, sizeof(name), "%s getSbits<17, %u> loop", label, lsb);
+    bench::report(name, bench::timeIt([&] {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = static_cast<Out>(getSbits<17, sizeof(T) * BITS_IN_BYTE - 20, int64_t>(in[i]));
+        }
+        bench::doNotOptimize(out[0]);
+    }), n);
+
+    struct { const char* name; Kernel kernel; bool available; } kernels[] = {
+        { "portable", &detail::getSbitsBulkPortable<T, Out>, true },
+#if defined(BITS_X86)
+        { "sse4.2", &detail::getSbitsBulkSse42<T, Out>, cpuFeatures().sse42 },
+        { "avx2", &detail::getSbitsBulkAvx2<T, Out>, cpuFeatures().avx2 },
+        { "avx512", &detail::getSbitsBulkAvx512<T, Out>, cpuFeatures().avx512f },
+#endif
+    };
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (!kernels[k].available) {
+            continue;
+        }
+        std::snprintf(name, sizeof(name), "%s getSbitsBulk %s", label, kernels[k].name);
+        bench::report(name, bench::timeIt([&] {
+            kernels[k].kernel(&in[0], n, &out[0], 17, lsb);
+            bench::doNotOptimize(out[0]);
+        }), n);
+    }
+}
+
+template<typename T>
+void runSet(const char* label, size_t n) {
+    std::vector<T> dest(n);
+    std::vector<int32_t> values(n);
+    bench::Random random(0);
+    for (size_t i = 0; i < n; ++i) {
+        dest[i] = static_cast<T>(random.next());
+        values[i] = static_cast<int32_t>(i % 16) - 8;
+    }
+    char name[96];
+
+    std::snprintf(name, sizeof(name), "%s setBits<4, 8> loop", label);
+    bench::report(name, bench::timeIt([&] {
+        for (size_t i = 0; i < n; ++i) {
+            setBits<4, 8>(dest[i], values[i]);
+        }
+        bench::doNotOptimize(dest[0]);
+    }), n);
+
+    std::snprintf(name, sizeof(name), "%s setBitsBulk<4, 8>", label);
+    bench::report(name, bench::timeIt([&] {
+        setBitsBulk<4, 8>(&dest[0], &values[0], n);
+        bench::doNotOptimize(dest[0]);
+    }), n);
+
+    std::snprintf(name, sizeof(name), "%s setBits<4, 8> loop, one value", label);
+    bench::report(name, bench::timeIt([&] {
+        for (size_t i = 0; i < n; ++i) {
+            setBits<4, 8>(dest[i], 5);
+        }
+        bench::doNotOptimize(dest[0]);
+    }), n);
+
+    std::snprintf(name, sizeof(name), "%s fillBits<4, 8>", label);
+    bench::report(name, bench::timeIt([&] {
+        fillBits<4, 8>(&dest[0], n, 5);
+        bench::doNotOptimize(dest[0]);
+    }), n);
+}
+
+}
+
+int main() {
+    // L2-resident and DRAM-sized inputs
+    const size_t sizes[] = { 1 << 14, 1 << 24 };
+    for (size_t s = 0; s < 2; ++s) {
+        std::printf("n = %zu\n", sizes[s]);
+        run<uint32_t, int32_t>("u32->i32", sizes[s]);
+        run<uint64_t, int64_t>("u64->i64", sizes[s]);
+        run<uint64_t, int32_t>("u64->i32", sizes[s]);
+        runSet<uint32_t>("u32", sizes[s]);
+        runSet<uint64_t>("i32->u64", sizes[s]);
+    }
+    return 0;
+}
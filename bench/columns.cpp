@@ -0,0 +1,69 @@
+// unpackColumns/packColumns compared with per-field and per-record loops.
+
+#include "bench.hpp"
+#include "columns.hpp"
+#include <cinttypes>
+#include <cstdlib>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+typedef Field<4, 60> Kind;
+typedef Field<20, 40, int32_t> Delta;
+typedef Field<32, 8> Id;
+typedef Field<8, 0> Flags;
+typedef Layout<uint64_t, Kind, Delta, Id, Flags> Record;
+
+}
+
+int main(int argc, char** argv) {
+    const size_t n = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 1 << 22;
+    std::vector<uint64_t> records(n);
+    bench::Random random(0);
+    for (size_t i = 0; i < n; ++i) {
+        records[i] = random.next();
+    }
+    std::vector<uint8_t> kinds(n);
+    std::vector<int32_t> deltas(n);
+    std::vector<uint32_t> ids(n);
+    std::vector<uint8_t> flags(n);
+
+    bench::report("getField, one pass per field", bench::timeIt([&] {
+        for (size_t i = 0; i < n; ++i) kinds[i] = static_cast<uint8_t>(getField<Kind>(records[i]));
+        for (size_t i = 0; i < n; ++i) deltas[i] = getField<Delta>(records[i]);
+        for (size_t i = 0; i < n; ++i) ids[i] = static_cast<uint32_t>(getField<Id>(records[i]));
+        for (size_t i = 0; i < n; ++i) flags[i] = static_cast<uint8_t>(getField<Flags>(records[i]));
+        bench::doNotOptimize(flags[0]);
+    }), n);
+
+    bench::report("getFields, one pass per record", bench::timeIt([&] {
+        for (size_t i = 0; i < n; ++i) {
+            const Record::ValuesType v = Record::unpack(records[i]);
+            kinds[i] = static_cast<uint8_t>(std::get<0>(v));
+            deltas[i] = std::get<1>(v);
+            ids[i] = static_cast<uint32_t>(std::get<2>(v));
+            flags[i] = static_cast<uint8_t>(std::get<3>(v));
+        }
+        bench::doNotOptimize(flags[0]);
+    }), n);
+
+    bench::report("unpackColumns", bench::timeIt([&] {
+        unpackColumns<Record>(&records[0], n, &kinds[0], &deltas[0], &ids[0], &flags[0]);
+        bench::doNotOptimize(flags[0]);
+    }), n);
+
+    bench::report("Layout::pack loop", bench::timeIt([&] {
+        for (size_t i = 0; i < n; ++i) {
+            records[i] = Record::pack(kinds[i], deltas[i], ids[i], flags[i]);
+        }
+        bench::doNotOptimize(records[0]);
+    }), n);
+
+    bench::report("packColumns", bench::timeIt([&] {
+        packColumns<Record>(&records[0], n, &kinds[0], &deltas[0], &ids[0], &flags[0]);
+        bench::doNotOptimize(records[0]);
+    }), n);
+    return 0;
+}
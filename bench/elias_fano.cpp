@@ -0,0 +1,85 @@
+// EliasFanoSequence size, iteration, access and nextGEQ on a posting list
+// with an average gap of 32, against the same values in a std::vector.
+// Pass the number of values.
+
+#include "bench.hpp"
+#include "elias_fano.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace bits;
+
+int main(int argc, char** argv) {
+    const size_t n = argc > 1 ? static_cast<size_t>(atoll(argv[1])) : static_cast<size_t>(1) << 25;
+    std::vector<uint64_t> values(n);
+    bench::Random random(0);
+    uint64_t value = 0;
+    for (size_t i = 0; i < n; ++i) {
+        value += random.next() % 64;
+        values[i] = value;
+    }
+
+    bench::report("build", bench::timeIt([&] {
+        bench::doNotOptimize(EliasFanoSequence(values).size());
+    }), n);
+
+    const EliasFanoSequence sequence(values);
+    // log2(u choose n) / n
+    const double u = static_cast<double>(sequence.back()) + 1;
+    const double bound = (std::lgamma(u + 1) - std::lgamma(n + 1.0) - std::lgamma(u - n + 1)) / std::log(2.0) / n;
+    std::printf("bits per value: %.2f (bound %.2f, L = %u)\n",
+        8.0 * sequence.memoryBytes() / n, bound, sequence.lowBits());
+
+    bench::report("iterate", bench::timeIt([&] {
+        uint64_t sum = 0;
+        for (EliasFanoSequence::Iterator it = sequence.begin(); it != sequence.end(); ++it) {
+            sum += *it;
+        }
+        bench::doNotOptimize(sum);
+    }), n);
+
+    bench::report("iterate std::vector", bench::timeIt([&] {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += values[i];
+        }
+        bench::doNotOptimize(sum);
+    }), n);
+
+    const size_t QUERIES = 1 << 20;
+    std::vector<size_t> indexes(QUERIES);
+    std::vector<uint64_t> targets(QUERIES);
+    for (size_t q = 0; q < QUERIES; ++q) {
+        const uint64_t x = random.next();
+        indexes[q] = x % n;
+        targets[q] = x % (sequence.back() + 1);
+    }
+
+    bench::report("access, random", bench::timeIt([&] {
+        uint64_t sum = 0;
+        for (size_t q = 0; q < QUERIES; ++q) {
+            sum += sequence.access(indexes[q]);
+        }
+        bench::doNotOptimize(sum);
+    }), QUERIES);
+
+    bench::report("nextGEQ, random", bench::timeIt([&] {
+        size_t sum = 0;
+        for (size_t q = 0; q < QUERIES; ++q) {
+            sum += sequence.nextGEQ(targets[q]);
+        }
+        bench::doNotOptimize(sum);
+    }), QUERIES);
+
+    bench::report("std::lower_bound, random", bench::timeIt([&] {
+        size_t sum = 0;
+        for (size_t q = 0; q < QUERIES; ++q) {
+            sum += static_cast<size_t>(std::lower_bound(values.begin(), values.end(), targets[q]) - values.begin());
+        }
+        bench::doNotOptimize(sum);
+    }), QUERIES);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Header::parse compared with hand-written IPv4 + UDP parsers.
+
+#include "bench.hpp"
+#include "header.hpp"
+#include <cinttypes>
+#include <cstdlib>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+struct Packet {
+    uint8_t version, ihl, tos;
+    uint16_t totalLength, id;
+    uint8_t flags;
+    uint16_t fragmentOffset;
+    uint8_t ttl, protocol;
+    uint16_t checksum;
+    uint32_t src, dst;
+    uint16_t srcPort, dstPort, udpLength, udpChecksum;
+};
+
+typedef Field<4, 28> Version;
+typedef Field<4, 24> Ihl;
+typedef Field<8, 16> Tos;
+typedef Field<16, 0> TotalLength;
+typedef Field<16, 16> Id;
+typedef Field<3, 13> Flags;
+typedef Field<13, 0> FragmentOffset;
+typedef Field<8, 24> Ttl;
+typedef Field<8, 16> Protocol;
+typedef Field<16, 0> HeaderChecksum;
+typedef Field<32, 32> SrcAddr;
+typedef Field<32, 0> DstAddr;
+typedef Field<16, 48> SrcPort;
+typedef Field<16, 32> DstPort;
+typedef Field<16, 16> UdpLength;
+typedef Field<16, 0> UdpChecksum;
+
+typedef Header<Packet, BigEndian,
+    HeaderWord<0, uint32_t,
+        BITS_BIND(Version, &Packet::version),
+        BITS_BIND(Ihl, &Packet::ihl),
+        BITS_BIND(Tos, &Packet::tos),
+        BITS_BIND(TotalLength, &Packet::totalLength)>,
+    HeaderWord<4, uint32_t,
+        BITS_BIND(Id, &Packet::id),
+        BITS_BIND(Flags, &Packet::flags),
+        BITS_BIND(FragmentOffset, &Packet::fragmentOffset)>,
+    HeaderWord<8, uint32_t,
+        BITS_BIND(Ttl, &Packet::ttl),
+        BITS_BIND(Protocol, &Packet::protocol),
+        BITS_BIND(HeaderChecksum, &Packet::checksum)>,
+    HeaderWord<12, uint64_t,
+        BITS_BIND(SrcAddr, &Packet::src),
+        BITS_BIND(DstAddr, &Packet::dst)>,
+    HeaderWord<20, uint64_t,
+        BITS_BIND(SrcPort, &Packet::srcPort),
+        BITS_BIND(DstPort, &Packet::dstPort),
+        BITS_BIND(UdpLength, &Packet::udpLength),
+        BITS_BIND(UdpChecksum, &Packet::udpChecksum)>> PacketHeader;
+
+const size_t PACKET_BYTES = 28;
+
+// One Msb0 call per field, each checking that its bits are in the buffer.
+#define BITS_BENCH_FIELD(member, width, offset) \
+    if (size * 8 < (offset) + (width)) return false; \
+    out.member = static_cast<decltype(out.member)>(Msb0::getUbits<width, offset>(p))
+
+bool parsePerField(const unsigned char* p, size_t size, Packet& out) {
+    BITS_BENCH_FIELD(version, 4, 0);
+    BITS_BENCH_FIELD(ihl, 4, 4);
+    BITS_BENCH_FIELD(tos, 8, 8);
+    BITS_BENCH_FIELD(totalLength, 16, 16);
+    BITS_BENCH_FIELD(id, 16, 32);
+    BITS_BENCH_FIELD(flags, 3, 48);
+    BITS_BENCH_FIELD(fragmentOffset, 13, 51);
+    BITS_BENCH_FIELD(ttl, 8, 64);
+    BITS_BENCH_FIELD(protocol, 8, 72);
+    BITS_BENCH_FIELD(checksum, 16, 80);
+    BITS_BENCH_FIELD(src, 32, 96);
+    BITS_BENCH_FIELD(dst, 32, 128);
+    BITS_BENCH_FIELD(srcPort, 16, 160);
+    BITS_BENCH_FIELD(dstPort, 16, 176);
+    BITS_BENCH_FIELD(udpLength, 16, 192);
+    BITS_BENCH_FIELD(udpChecksum, 16, 208);
+    return true;
+}
+
+#undef BITS_BENCH_FIELD
+
+// The usual byte shifts after a single length check.
+bool parseBytes(const unsigned char* p, size_t size, Packet& out) {
+    if (size < PACKET_BYTES) {
+        return false;
+    }
+    out.version = p[0] >> 4;
+    out.ihl = p[0] & 0xF;
+    out.tos = p[1];
+    out.totalLength = static_cast<uint16_t>(p[2] << 8 | p[3]);
+    out.id = static_cast<uint16_t>(p[4] << 8 | p[5]);
+    out.flags = p[6] >> 5;
+    out.fragmentOffset = static_cast<uint16_t>((p[6] & 0x1F) << 8 | p[7]);
+    out.ttl = p[8];
+    out.protocol = p[9];
+    out.checksum = static_cast<uint16_t>(p[10] << 8 | p[11]);
+    out.src = static_cast<uint32_t>(p[12]) << 24 | p[13] << 16 | p[14] << 8 | p[15];
+    out.dst = static_cast<uint32_t>(p[16]) << 24 | p[17] << 16 | p[18] << 8 | p[19];
+    out.srcPort = static_cast<uint16_t>(p[20] << 8 | p[21]);
+    out.dstPort = static_cast<uint16_t>(p[22] << 8 | p[23]);
+    out.udpLength = static_cast<uint16_t>(p[24] << 8 | p[25]);
+    out.udpChecksum = static_cast<uint16_t>(p[26] << 8 | p[27]);
+    return true;
+}
+
+template<typename Parse>
+void run(const char* name, const std::vector<unsigned char>& packets, std::vector<Packet>& out, Parse parse) {
+    const size_t n = out.size();
+    bench::report(name, bench::timeIt([&] {
+        size_t ok = 0;
+        for (size_t i = 0; i < n; ++i) {
+            ok += parse(&packets[i * PACKET_BYTES], PACKET_BYTES, out[i]);
+        }
+        bench::doNotOptimize(ok);
+        bench::doNotOptimize(out[n - 1]);
+    }), n);
+}
+
+}
+
+int main(int argc, char** argv) {
+    const size_t n = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 1 << 16;
+    std::vector<unsigned char> packets(n * PACKET_BYTES);
+    bench::Random random(0);
+    for (size_t i = 0; i < packets.size(); ++i) {
+        packets[i] = static_cast<unsigned char>(random.next());
+    }
+    std::vector<Packet> out(n);
+
+    run("hand-written, Msb0 call per field", packets, out, parsePerField);
+    run("hand-written, byte shifts", packets, out, parseBytes);
+    run("Header::parse", packets, out, PacketHeader::parse);
+    return 0;
+}
@@ -0,0 +1,75 @@
+// PackedVector scan throughput and memory use compared with std::vector<uint32_t>.
+
+#include "bench.hpp"
+#include "packed_vector.hpp"
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+const size_t N = 1 << 24;
+const size_t CHUNK = 4096;
+
+template<unsigned width>
+void run() {
+    std::vector<uint32_t> plain(N);
+    PackedVector<width> packed;
+    packed.reserve(N);
+    for (size_t i = 0; i < N; ++i) {
+        plain[i] = static_cast<uint32_t>(i * 2654435761u) & ((1u << width) - 1);
+        packed.push_back(plain[i]);
+    }
+
+    char name[64];
+    std::printf("width %u: std::vector %zu MB, PackedVector %zu MB\n", width,
+        plain.size() * sizeof(uint32_t) >> 20, packed.memoryBytes() >> 20);
+
+    std::snprintf(name, sizeof(name), "std::vector<uint32_t> sum");
+    bench::report(name, bench::timeIt([&] {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < N; ++i) {
+            sum += plain[i];
+        }
+        bench::doNotOptimize(sum);
+    }), N);
+
+    std::snprintf(name, sizeof(name), "PackedVector<%u> unpack + sum", width);
+    bench::report(name, bench::timeIt([&] {
+        uint32_t buffer[CHUNK];
+        uint64_t sum = 0;
+        for (size_t begin = 0; begin < N; begin += CHUNK) {
+            packed.unpack(begin, begin + CHUNK, buffer);
+            for (size_t i = 0; i < CHUNK; ++i) {
+                sum += buffer[i];
+            }
+        }
+        bench::doNotOptimize(sum);
+    }), N);
+
+    std::snprintf(name, sizeof(name), "PackedVector<%u> operator[] + sum", width);
+    bench::report(name, bench::timeIt([&] {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < N; ++i) {
+            sum += packed[i];
+        }
+        bench::doNotOptimize(sum);
+    }), N);
+
+    std::snprintf(name, sizeof(name), "PackedVector<%u> pack", width);
+    bench::report(name, bench::timeIt([&] {
+        packed.pack(0, plain.data(), N);
+        bench::doNotOptimize(packed.data()[0]);
+    }), N);
+}
+
+}
+
+int main() {
+    std::printf("avx2: %s\n", cpuFeatures().avx2 ? "yes" : "no");
+    run<5>();
+    run<13>();
+    run<17>();
+    return 0;
+}
@@ -0,0 +1,70 @@
+// RankSelectBitVector construction, rank1 and select1 on random bits.
+// Pass the number of bits; the default is well past the last-level cache.
+
+#include "bench.hpp"
+#include "rank_select.hpp"
+#include <cinttypes>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace bits;
+
+int main(int argc, char** argv) {
+    const size_t size = argc > 1 ? static_cast<size_t>(atoll(argv[1])) : static_cast<size_t>(1) << 30;
+    Bitset bits(size);
+    bench::Random random(0);
+    for (size_t i = 0; i < bits.wordCount(); ++i) {
+        const uint64_t x = random.next();
+        bits.data()[i] = x & (x >> 7); // about a quarter of the bits set
+    }
+    bits.resize(size);
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    bench::reportBytes("build, 1 thread", bench::timeIt([&] {
+        bench::doNotOptimize(RankSelectBitVector(bits, 1).count());
+    }), size / 8.0);
+    char name[96];
+    std::snprintf(name, sizeof(name), "build, %u threads", cores);
+    bench::reportBytes(name, bench::timeIt([&] {
+        bench::doNotOptimize(RankSelectBitVector(bits, cores).count());
+    }), size / 8.0);
+
+    const RankSelectBitVector vector(bits);
+    std::printf("index overhead: %.2f%%\n", 100.0 * vector.indexBytes() * 8 / size);
+
+    const size_t QUERIES = 1 << 20;
+    std::vector<size_t> positions(QUERIES);
+    std::vector<size_t> ranks(QUERIES);
+    for (size_t q = 0; q < QUERIES; ++q) {
+        const uint64_t x = random.next();
+        positions[q] = x % size;
+        ranks[q] = x % vector.count();
+    }
+
+    bench::report("rank1, random positions", bench::timeIt([&] {
+        size_t sum = 0;
+        for (size_t q = 0; q < QUERIES; ++q) {
+            sum += vector.rank1(positions[q]);
+        }
+        bench::doNotOptimize(sum);
+    }), QUERIES);
+
+    bench::report("select1, random ranks", bench::timeIt([&] {
+        size_t sum = 0;
+        for (size_t q = 0; q < QUERIES; ++q) {
+            sum += vector.select1(ranks[q]);
+        }
+        bench::doNotOptimize(sum);
+    }), QUERIES);
+
+    bench::report("selectInWord", bench::timeIt([&] {
+        unsigned sum = 0;
+        for (size_t q = 0; q < QUERIES; ++q) {
+            const uint64_t word = positions[q] * 0x9E3779B97F4A7C15ULL | 1;
+            sum += detail::selectInWord(word, static_cast<unsigned>(ranks[q] % detail::popcount64(word)));
+        }
+        bench::doNotOptimize(sum);
+    }), QUERIES);
+    return 0;
+}
@@ -0,0 +1,70 @@
+// RoaringBitmap against a plain Bitset over the same universe, for random
+// sets of several densities and for long runs. Items are the set bits of
+// both operands. Pass the universe size in bits.
+
+#include "bench.hpp"
+#include "roaring.hpp"
+#include <cinttypes>
+#include <cstdlib>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+/** Runs of 1000 set bits every 5000 bits, shifted by the seed. */
+Bitset runBits(size_t size, uint64_t seed) {
+    Bitset bits(size);
+    for (size_t i = 0; i < size; ++i) {
+        if ((i + seed * 1700) % 5000 < 1000) {
+            bits.set(i);
+        }
+    }
+    return bits;
+}
+
+void run(const char* what, const char* label, size_t items, double seconds) {
+    char name[96];
+    std::snprintf(name, sizeof(name), "%s: %s", label, what);
+    bench::report(name, seconds, items);
+}
+
+void compare(const char* label, const Bitset& a, const Bitset& b) {
+    RoaringBitmap ra(a);
+    RoaringBitmap rb(b);
+    ra.runOptimize();
+    rb.runOptimize();
+    const size_t setBits = a.count() + b.count();
+    std::printf("%s: %.3f bytes per set bit (Bitset %.3f)\n", label,
+        static_cast<double>(ra.memoryBytes() + rb.memoryBytes()) / setBits,
+        static_cast<double>(a.size() / 4) / setBits);
+
+    run("and, roaring", label, setBits, bench::timeIt([&] { bench::doNotOptimize((ra & rb).any()); }));
+    run("and, Bitset", label, setBits, bench::timeIt([&] { bench::doNotOptimize((a & b).data()[0]); }));
+    run("or, roaring", label, setBits, bench::timeIt([&] { bench::doNotOptimize((ra | rb).any()); }));
+    run("or, Bitset", label, setBits, bench::timeIt([&] { bench::doNotOptimize((a | b).data()[0]); }));
+    run("andNot, roaring", label, setBits, bench::timeIt([&] {
+        bench::doNotOptimize(RoaringBitmap(ra).andNot(rb).any());
+    }));
+    run("andNot, Bitset", label, setBits, bench::timeIt([&] {
+        bench::doNotOptimize(Bitset(a).andNot(b).data()[0]);
+    }));
+    run("andCount, roaring", label, setBits, bench::timeIt([&] { bench::doNotOptimize(andCount(ra, rb)); }));
+    run("andCount, Bitset", label, setBits, bench::timeIt([&] { bench::doNotOptimize(andCount(a, b)); }));
+    run("count, roaring", label, setBits, bench::timeIt([&] { bench::doNotOptimize(ra.count()); }));
+    run("count, Bitset", label, setBits, bench::timeIt([&] { bench::doNotOptimize(a.count()); }));
+}
+
+}
+
+int main(int argc, char** argv) {
+    const size_t size = argc > 1 ? static_cast<size_t>(atoll(argv[1])) : static_cast<size_t>(1) << 24;
+    const unsigned densities[] = { 10000, 1000, 100, 10, 2 };
+    for (unsigned d = 0; d < 5; ++d) {
+        char label[32];
+        std::snprintf(label, sizeof(label), "1/%u", densities[d]);
+        compare(label, bench::randomBits(size, densities[d], 1), bench::randomBits(size, densities[d], 2));
+    }
+    compare("runs", runBits(size, 1), runBits(size, 2));
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Run-time width/lsb field access compared with the template versions.
+
+#include "bench.hpp"
+#include "bulk.hpp"
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+const size_t N = 1 << 16;
+
+// Read through a volatile so the compiler can't treat them as constants.
+volatile unsigned runtimeWidth = 13;
+volatile unsigned runtimeLsb = 40;
+
+}
+
+int main() {
+    std::vector<uint64_t> words(N);
+    bench::Random random(0);
+    for (size_t i = 0; i < N; ++i) {
+        words[i] = random.next();
+    }
+    std::vector<uint64_t> out(N);
+    std::vector<int64_t> sout(N);
+    const unsigned width = runtimeWidth;
+    const unsigned lsb = runtimeLsb;
+
+    std::printf("bmi2: %s, avx2: %s\n",
+        cpuFeatures().bmi2 ? "yes" : "no", cpuFeatures().avx2 ? "yes" : "no");
+
+    bench::report("getUbits<13, 40> loop", bench::timeIt([&] {
+        for (size_t i = 0; i < N; ++i) {
+            out[i] = getUbits<13, 40>(words[i]);
+        }
+        bench::doNotOptimize(out[0]);
+    }), N);
+
+    bench::report("getUbits(src, width, lsb) loop", bench::timeIt([&] {
+        for (size_t i = 0; i < N; ++i) {
+            out[i] = getUbits(words[i], width, lsb);
+        }
+        bench::doNotOptimize(out[0]);
+    }), N);
+
+    bench::report("getUbitsBulk(width, lsb) dispatched", bench::timeIt([&] {
+        getUbitsBulk(&words[0], N, &out[0], width, lsb);
+        bench::doNotOptimize(out[0]);
+    }), N);
+
+    bench::report("getUbitsBulk(width, lsb) portable loop", bench::timeIt([&] {
+        detail::getUbitsBulkPortable(&words[0], N, &out[0], width, lsb);
+        bench::doNotOptimize(out[0]);
+    }), N);
+
+    bench::report("getSbits<13, 40> loop", bench::timeIt([&] {
+        for (size_t i = 0; i < N; ++i) {
+            sout[i] = getSbits<13, 40, int64_t>(words[i]);
+        }
+        bench::doNotOptimize(sout[0]);
+    }), N);
+
+    bench::report("getSbits(src, width, lsb) loop", bench::timeIt([&] {
+        for (size_t i = 0; i < N; ++i) {
+            sout[i] = getSbits<int64_t>(words[i], width, lsb);
+        }
+        bench::doNotOptimize(sout[0]);
+    }), N);
+
+    bench::report("getSbitsBulk(width, lsb) dispatched", bench::timeIt([&] {
+        getSbitsBulk(&words[0], N, &sout[0], width, lsb);
+        bench::doNotOptimize(sout[0]);
+    }), N);
+
+    bench::report("setBits<13, 40> loop", bench::timeIt([&] {
+        for (size_t i = 0; i < N; ++i) {
+            setBits<13, 40>(words[i], i);
+        }
+        bench::doNotOptimize(words[0]);
+    }), N);
+
+    bench::report("setBits(dest, width, lsb, value) loop", bench::timeIt([&] {
+        for (size_t i = 0; i < N; ++i) {
+            setBits(words[i], width, lsb, i);
+        }
+        bench::doNotOptimize(words[0]);
+    }), N);
+
+    return 0;
+}
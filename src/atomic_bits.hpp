@@ -0,0 +1,178 @@
+#ifndef BITS_ATOMIC_BITS_HPP
+#define BITS_ATOMIC_BITS_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * Lock-free updates of bits and fields in a std::atomic word, for state
+  * shared between threads such as a refcount, a state and an epoch packed
+  * into one 64-bit word.
+  *
+  * Single bits are set and cleared with fetch_or and fetch_and. Fields are
+  * updated with a compare-exchange loop that only retries when another thread
+  * changed the word in between; fields updated concurrently by other threads
+  * are preserved.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "atomic_bits.hpp requires C++11"
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <tuple>
+
+namespace bits {
+
+namespace detail {
+
+/**
+ * The strongest memory order a failed compare-exchange may use for the
+ * success order order.
+ */
+inline BITS_CONSTEXPR std::memory_order failureOrder(std::memory_order order) {
+    return order == std::memory_order_acq_rel ? std::memory_order_acquire
+        : order == std::memory_order_release ? std::memory_order_relaxed
+        : order;
+}
+
+template<size_t... indexes>
+struct IndexList {};
+
+template<size_t n, size_t... indexes>
+struct MakeIndexList : MakeIndexList<n - 1, n - 1, indexes...> {};
+
+template<size_t... indexes>
+struct MakeIndexList<0, indexes...> {
+    typedef IndexList<indexes...> type;
+};
+
+template<typename T, typename... Fields, typename Tuple, size_t... indexes>
+T packTuple(const Tuple& values, IndexList<indexes...>) {
+    return FieldPacker<T, Fields...>::pack(std::get<indexes>(values)...);
+}
+
+}
+
+/**
+ * Get an unsigned field from word with a single atomic load.
+ */
+template<unsigned width, unsigned lsb, typename T>
+T atomicGetUbits(const std::atomic<T>& word, std::memory_order order = std::memory_order_seq_cst) {
+    return getUbits<width, lsb>(word.load(order));
+}
+
+/**
+ * Get a signed field from word with a single atomic load.
+ */
+template<unsigned width, unsigned lsb, typename ValueType, typename T>
+ValueType atomicGetSbits(const std::atomic<T>& word, std::memory_order order = std::memory_order_seq_cst) {
+    return getSbits<width, lsb, ValueType>(word.load(order));
+}
+
+/**
+ * Set the bit at pos with fetch_or. Returns whether it was already set.
+ */
+template<unsigned pos, typename T>
+bool atomicSetBit(std::atomic<T>& word, std::memory_order order = std::memory_order_seq_cst) {
+    static_assert(detail::IsUnsignedWord<T>::value,
+        "T must be an unsigned integer type");
+
+    static_assert(pos < sizeof(T) * BITS_IN_BYTE,
+        "pos must be less than sizeof T * BITS_IN_BYTE");
+
+    const T bit = static_cast<T>(static_cast<T>(1) << pos);
+    return (word.fetch_or(bit, order) & bit) != 0;
+}
+
+/**
+ * Clear the bit at pos with fetch_and. Returns whether it was set.
+ */
+template<unsigned pos, typename T>
+bool atomicClearBit(std::atomic<T>& word, std::memory_order order = std::memory_order_seq_cst) {
+    static_assert(detail::IsUnsignedWord<T>::value,
+        "T must be an unsigned integer type");
+
+    static_assert(pos < sizeof(T) * BITS_IN_BYTE,
+        "pos must be less than sizeof T * BITS_IN_BYTE");
+
+    const T bit = static_cast<T>(static_cast<T>(1) << pos);
+    return (word.fetch_and(static_cast<T>(~bit), order) & bit) != 0;
+}
+
+/**
+ * Set the field of width bits at lsb to value, leaving the rest of word as
+ * other threads leave it. Returns the word the field was set in.
+ */
+template<unsigned width, unsigned lsb, typename T, typename ValueType>
+T atomicSetBits(std::atomic<T>& word, const ValueType value,
+    std::memory_order order = std::memory_order_seq_cst) {
+    T old = word.load(std::memory_order_relaxed);
+    while (!word.compare_exchange_weak(old, withBits<width, lsb>(old, value),
+        order, detail::failureOrder(order))) {
+    }
+    return old;
+}
+
+/**
+ * If each field of Fields in word equals its value in expected, set them to
+ * the values in desired and return true; other fields may change meanwhile
+ * without making the exchange fail. Otherwise store the fields' current
+ * values in expected and return false, as compare_exchange_strong does.
+ *
+ *     typedef Field<32, 0> RefCount;
+ *     typedef Field<8, 32> State;
+ *     std::tuple<uint64_t> expected(IDLE);
+ *     compareExchangeFields<State>(word, expected, std::make_tuple(BUSY));
+ */
+template<typename... Fields, typename T>
+bool compareExchangeFields(std::atomic<T>& word,
+    std::tuple<typename FieldValue<Fields, T>::type...>& expected,
+    const std::tuple<typename FieldValue<Fields, T>::type...>& desired,
+    std::memory_order order = std::memory_order_seq_cst) {
+    static_assert(!detail::CombinedMask<T, Fields...>::OVERLAP,
+        "fields passed to compareExchangeFields must not overlap");
+
+    typedef typename detail::MakeIndexList<sizeof...(Fields)>::type Indexes;
+    const T mask = detail::CombinedMask<T, Fields...>::value;
+    const T match = detail::packTuple<T, Fields...>(expected, Indexes());
+    const T update = detail::packTuple<T, Fields...>(desired, Indexes());
+
+    T old = word.load(detail::failureOrder(order));
+    while ((old & mask) == match) {
+        if (word.compare_exchange_weak(old, static_cast<T>((old & ~mask) | update),
+            order, detail::failureOrder(order))) {
+            return true;
+        }
+    }
+    // the fields differ; old came from a load or a failed exchange, both of
+    // which give the current value
+    expected = getFields<Fields...>(old);
+    return false;
+}
+
+}
+
+#endif
@@ -0,0 +1,438 @@
+#ifndef BITS_BIT_STREAM_HPP
+#define BITS_BIT_STREAM_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * BitWriter appends fields of any width to a growing byte stream and
+  * BitReader reads them back. Both keep the bits in flight in a 64-bit
+  * accumulator and exchange it with memory as one unaligned 64-bit load or
+  * store on every call, advancing by however many whole bytes are done.
+  * That takes no branch on the field width or the accumulator's fill level,
+  * which vary unpredictably in real streams.
+  *
+  * Order is LsbFirst (the first field starts at the least significant bit of
+  * the first byte, as in DEFLATE) or MsbFirst (the first field starts at the
+  * most significant bit, as in most codec and network formats).
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "bit_stream.hpp requires C++11"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace bits {
+
+namespace detail {
+
+/**
+ * How an Order maps stream bits to accumulator bits. For LsbFirst the next
+ * bit is the accumulator's least significant bit; for MsbFirst it is the
+ * most significant.
+ */
+template<typename Order>
+struct StreamOrder;
+
+template<>
+struct StreamOrder<LsbFirst> {
+    static uint64_t load(const unsigned char* p) {
+#if defined(BITS_LITTLE_ENDIAN)
+        return loadBytes64(p);
+#else
+        uint64_t word = 0;
+        for (unsigned i = 0; i < 8; ++i) {
+            word |= static_cast<uint64_t>(p[i]) << (i * BITS_IN_BYTE);
+        }
+        return word;
+#endif
+    }
+
+    static void store(unsigned char* p, uint64_t word) {
+#if defined(BITS_LITTLE_ENDIAN)
+        storeBytes64(p, word);
+#else
+        for (unsigned i = 0; i < 8; ++i) {
+            p[i] = static_cast<unsigned char>(word >> (i * BITS_IN_BYTE));
+        }
+#endif
+    }
+
+    // add width bits of value after the count bits in acc; count + width <= 64
+    static void append(uint64_t& acc, unsigned count, uint64_t value, unsigned) {
+        acc |= value << count;
+    }
+
+    // add word, loaded from the byte after the avail bits in acc
+    static void fill(uint64_t& acc, unsigned avail, uint64_t word) {
+        acc |= word << avail;
+    }
+
+    static uint64_t peek(uint64_t acc, unsigned width) {
+        return acc & (~static_cast<uint64_t>(0) >> (64 - width));
+    }
+
+    static void consume(uint64_t& acc, unsigned width) {
+        acc >>= width;
+    }
+};
+
+template<>
+struct StreamOrder<MsbFirst> {
+    static uint64_t load(const unsigned char* p) {
+#if defined(BITS_LITTLE_ENDIAN)
+        return byteSwap(loadBytes64(p));
+#else
+        uint64_t word = 0;
+        for (unsigned i = 0; i < 8; ++i) {
+            word = (word << BITS_IN_BYTE) | p[i];
+        }
+        return word;
+#endif
+    }
+
+    static void store(unsigned char* p, uint64_t word) {
+#if defined(BITS_LITTLE_ENDIAN)
+        storeBytes64(p, byteSwap(word));
+#else
+        for (unsigned i = 0; i < 8; ++i) {
+            p[i] = static_cast<unsigned char>(word >> (56 - i * BITS_IN_BYTE));
+        }
+#endif
+    }
+
+    static void append(uint64_t& acc, unsigned count, uint64_t value, unsigned width) {
+        acc |= value << (64 - count - width);
+    }
+
+    static void fill(uint64_t& acc, unsigned avail, uint64_t word) {
+        acc |= word >> avail;
+    }
+
+    static uint64_t peek(uint64_t acc, unsigned width) {
+        return acc >> (64 - width);
+    }
+
+    static void consume(uint64_t& acc, unsigned width) {
+        acc <<= width;
+    }
+};
+
+// The most bits one accumulator operation handles: a refill leaves at least
+// this many and a write has room for this many next to a partial byte.
+constexpr unsigned STREAM_CHUNK = 56;
+
+}
+
+/**
+ * Appends fields to a byte stream. Values are truncated to their width, as
+ * setBits does. Widths are 1 to 64 bits; fields wider than 56 bits are
+ * written in two parts.
+ */
+template<typename Order = LsbFirst>
+class BitWriter {
+public:
+    BitWriter() : out_(0), capacity_(0), acc_(0), count_(0), size_(0) {}
+
+    // out_ points into bytes_, so copies and moves re-point it at their own
+    BitWriter(const BitWriter& other)
+        : bytes_(other.bytes_), out_(bytes_.data()), capacity_(bytes_.size()),
+          acc_(other.acc_), count_(other.count_), size_(other.size_) {}
+
+    BitWriter(BitWriter&& other)
+        : bytes_(std::move(other.bytes_)), out_(bytes_.data()), capacity_(bytes_.size()),
+          acc_(other.acc_), count_(other.count_), size_(other.size_) {
+        other.reset();
+    }
+
+    BitWriter& operator=(const BitWriter& other) {
+        if (this != &other) {
+            bytes_ = other.bytes_;
+            copyState(other);
+        }
+        return *this;
+    }
+
+    BitWriter& operator=(BitWriter&& other) {
+        if (this != &other) {
+            bytes_ = std::move(other.bytes_);
+            copyState(other);
+            other.reset();
+        }
+        return *this;
+    }
+
+    /** Reserve room for bytes bytes of output. */
+    void reserve(size_t bytes) {
+        if (capacity_ < bytes + 8) {
+            bytes_.resize(bytes + 8);
+            out_ = bytes_.data();
+            capacity_ = bytes_.size();
+        }
+    }
+
+    template<unsigned width>
+    void put(uint64_t value) {
+        static_assert(width > 0 && width <= 64,
+            "width must be > 0 and <= 64");
+
+        put(width, value);
+    }
+
+    void put(unsigned width, uint64_t value) {
+        if (width > detail::STREAM_CHUNK) {
+            // high or low half first depending on the order
+            const unsigned rest = width - 32;
+            if (std::is_same<Order, LsbFirst>::value) {
+                putChunk(32, value & 0xFFFFFFFF);
+                putChunk(rest, (value >> 32) & (~static_cast<uint64_t>(0) >> (64 - rest)));
+            } else {
+                putChunk(32, (value >> rest) & 0xFFFFFFFF);
+                putChunk(rest, value & (~static_cast<uint64_t>(0) >> (64 - rest)));
+            }
+            return;
+        }
+        putChunk(width, value & (~static_cast<uint64_t>(0) >> (64 - width)));
+    }
+
+    /** Start a new stream, keeping the memory of the old one. */
+    void clear() {
+        acc_ = 0;
+        count_ = 0;
+        size_ = 0;
+    }
+
+    /** Bits written so far. */
+    size_t bitCount() const { return size_ * BITS_IN_BYTE + count_; }
+
+    /** Pad with zero bits to the next byte boundary. */
+    void alignToByte() {
+        if (count_ != 0) {
+            // the partial byte is already in memory
+            ++size_;
+            acc_ = 0;
+            count_ = 0;
+        }
+    }
+
+    /**
+     * Pad to a byte boundary and return the stream. Writing can continue
+     * afterwards; later fields start at the next byte.
+     */
+    const std::vector<unsigned char>& finish() {
+        alignToByte();
+        bytes_.resize(size_);
+        out_ = bytes_.data();
+        capacity_ = size_;
+        return bytes_;
+    }
+
+private:
+    // Write width <= 56 bits: count_ < 8 before, so they fit in acc_. The
+    // whole of acc_ is stored and the whole bytes are kept.
+    void putChunk(unsigned width, uint64_t value) {
+        if (size_ + 8 > capacity_) {
+            grow();
+        }
+        uint64_t acc = acc_;
+        detail::StreamOrder<Order>::append(acc, count_, value, width);
+        unsigned char* out = out_ + size_;
+        const unsigned count = count_ + width;
+        const unsigned done = count / BITS_IN_BYTE;
+        size_ += done;
+        count_ = count % BITS_IN_BYTE;
+        acc_ = acc;
+        // done * 8 is 56 at most, so the shift is defined
+        detail::StreamOrder<Order>::consume(acc_, done * BITS_IN_BYTE);
+        // last, as the compiler must assume it can overwrite the members
+        detail::StreamOrder<Order>::store(out, acc);
+    }
+
+    void copyState(const BitWriter& other) {
+        out_ = bytes_.data();
+        capacity_ = bytes_.size();
+        acc_ = other.acc_;
+        count_ = other.count_;
+        size_ = other.size_;
+    }
+
+    void reset() {
+        bytes_.clear();
+        out_ = bytes_.data();
+        capacity_ = 0;
+        clear();
+    }
+
+    void grow() {
+        bytes_.resize(bytes_.size() * 2 + 64);
+        out_ = bytes_.data();
+        capacity_ = bytes_.size();
+    }
+
+    std::vector<unsigned char> bytes_;
+    // bytes_.data() and bytes_.size(), kept where the compiler can see them
+    unsigned char* out_;
+    size_t capacity_;
+    uint64_t acc_;
+    // bits in acc_ not yet counted in size_, < 8 between calls
+    unsigned count_;
+    // whole bytes written; bytes_ past them is room for the next store
+    size_t size_;
+};
+
+/**
+ * Reads fields from a byte stream written by BitWriter with the same Order.
+ * Reading past the end of the stream returns zero bits; overrun() reports it.
+ *
+ * Each read tops the accumulator up to at least 56 bits with one unaligned
+ * 64-bit load, so a field of up to 56 bits is then a shift and a mask. Only
+ * the last 7 bytes of the stream go through a slower, bounds-checked load.
+ */
+template<typename Order = LsbFirst>
+class BitReader {
+public:
+    BitReader(const void* data, size_t bytes)
+        : data_(static_cast<const unsigned char*>(data)), size_(bytes), next_(0), acc_(0), avail_(0) {}
+
+    template<unsigned width>
+    uint64_t get() {
+        static_assert(width > 0 && width <= 64,
+            "width must be > 0 and <= 64");
+
+        if (width > MAX_PEEK) {
+            return get(width);
+        }
+        // with a fixed width the refills follow a pattern branch predictors
+        // learn, so refilling only when needed is cheaper
+        if (avail_ < width) {
+            refill();
+        }
+        const uint64_t value = detail::StreamOrder<Order>::peek(acc_, width);
+        detail::StreamOrder<Order>::consume(acc_, width);
+        avail_ -= width;
+        return value;
+    }
+
+    uint64_t get(unsigned width) {
+        if (width > MAX_PEEK) {
+            // two reads, high or low half first depending on the order
+            const unsigned rest = width - 32;
+            if (std::is_same<Order, LsbFirst>::value) {
+                const uint64_t low = get(32);
+                return low | (get(rest) << 32);
+            }
+            const uint64_t high = get(32);
+            return (high << rest) | get(rest);
+        }
+        const uint64_t value = peek(width);
+        detail::StreamOrder<Order>::consume(acc_, width);
+        avail_ -= width;
+        return value;
+    }
+
+    /** The next width bits, 1 <= width <= 56, without consuming them. */
+    template<unsigned width>
+    uint64_t peek() {
+        static_assert(width > 0 && width <= MAX_PEEK,
+            "width must be > 0 and <= 56");
+
+        return peek(width);
+    }
+
+    uint64_t peek(unsigned width) {
+        refill();
+        return detail::StreamOrder<Order>::peek(acc_, width);
+    }
+
+    void skip(size_t bits) {
+        if (bits <= avail_) {
+            detail::StreamOrder<Order>::consume(acc_, static_cast<unsigned>(bits));
+            avail_ -= static_cast<unsigned>(bits);
+            return;
+        }
+        const size_t target = bitPosition() + bits;
+        next_ = target / BITS_IN_BYTE;
+        acc_ = 0;
+        avail_ = 0;
+        const unsigned partial = target % BITS_IN_BYTE;
+        if (partial != 0) {
+            refill();
+            detail::StreamOrder<Order>::consume(acc_, partial);
+            avail_ -= partial;
+        }
+    }
+
+    /** Skip to the next byte boundary, as BitWriter::alignToByte pads. */
+    void alignToByte() {
+        skip((BITS_IN_BYTE - bitPosition() % BITS_IN_BYTE) % BITS_IN_BYTE);
+    }
+
+    /** Bits read or skipped so far. */
+    size_t bitPosition() const { return next_ * BITS_IN_BYTE - avail_; }
+
+    /** True once more bits have been read than the stream holds. */
+    bool overrun() const { return bitPosition() > size_ * BITS_IN_BYTE; }
+
+    static constexpr unsigned MAX_PEEK = detail::STREAM_CHUNK;
+
+private:
+    void refill() {
+        uint64_t word;
+        if (next_ + 8 <= size_) {
+            word = detail::StreamOrder<Order>::load(data_ + next_);
+        } else {
+            // near the end: zeros stand in for the bytes past it
+            unsigned char tail[8] = {};
+            if (next_ < size_) {
+                memcpy(tail, data_ + next_, size_ - next_);
+            }
+            word = detail::StreamOrder<Order>::load(tail);
+        }
+        detail::StreamOrder<Order>::fill(acc_, avail_, word);
+        // take as many whole bytes as fit; the bits of a partial byte loaded
+        // above avail_ are loaded again, at the same place, next time
+        next_ += (63 - avail_) / BITS_IN_BYTE;
+        avail_ |= MAX_PEEK;
+    }
+
+    const unsigned char* data_;
+    size_t size_;
+    // the next byte to load
+    size_t next_;
+    uint64_t acc_;
+    // bits in acc_ not yet read
+    unsigned avail_;
+};
+
+template<typename Order>
+constexpr unsigned BitReader<Order>::MAX_PEEK;
+
+}
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef BITS_BITMAP_ALLOCATOR_HPP
+#define BITS_BITMAP_ALLOCATOR_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+ /**
+  * BitmapAllocator hands out slot numbers from a fixed-size table: allocate
+  * returns the lowest free slot and free returns a slot to the pool.
+  *
+  * The leaf words hold one bit per slot, set while the slot is free. Above
+  * them each summary level holds one bit per word of the level below, set
+  * while that word has any bit set, until a level fits in one word. Finding
+  * a free slot reads one word per level and takes its lowest set bit, so it
+  * costs O(log64 n) however full the table is; 2^24 slots need three summary
+  * levels. A summary bit only changes when a word fills up or stops being
+  * full, once per 64 allocations at most.
+  *
+  * AtomicBitmapAllocator is the same structure over std::atomic words for
+  * allocation and freeing from several threads without locks. Slots are
+  * claimed with fetch_and and returned with fetch_or. A thread that empties
+  * a word clears the summary bit above it and then checks the word again,
+  * restoring the bit if a free raced in; a thread that fills an empty word
+  * sets the summary bit after its fetch_or. Either way the last writer
+  * leaves the summary right. Summary bits may briefly be set over an empty
+  * word, and allocate repairs them when it meets one. allocate may report
+  * the table full while a concurrent free is still in progress.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+#include "bitset.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "bitmap_allocator.hpp requires C++11"
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bits {
+
+namespace detail {
+
+inline uint64_t loadWord(const uint64_t& word) { return word; }
+
+inline uint64_t loadWord(const std::atomic<uint64_t>& word) { return word.load(); }
+
+inline void storeWord(uint64_t& word, uint64_t value) { word = value; }
+
+inline void storeWord(std::atomic<uint64_t>& word, uint64_t value) { word.store(value); }
+
+inline uint64_t fetchAndWord(uint64_t& word, uint64_t mask) {
+    const uint64_t old = word;
+    word = old & mask;
+    return old;
+}
+
+inline uint64_t fetchAndWord(std::atomic<uint64_t>& word, uint64_t mask) {
+    return word.fetch_and(mask);
+}
+
+inline uint64_t fetchOrWord(uint64_t& word, uint64_t bits) {
+    const uint64_t old = word;
+    word = old | bits;
+    return old;
+}
+
+inline uint64_t fetchOrWord(std::atomic<uint64_t>& word, uint64_t bits) {
+    return word.fetch_or(bits);
+}
+
+}
+
+/**
+ * A pool of capacity slots numbered [0, capacity) over words of type Word,
+ * uint64_t or std::atomic<uint64_t>. Use the BitmapAllocator and
+ * AtomicBitmapAllocator typedefs.
+ */
+template<typename Word>
+class BasicBitmapAllocator {
+public:
+    explicit BasicBitmapAllocator(size_t capacity)
+        : capacity_(capacity), levelOffsets_(1, 0), words_() {
+        // the leaf level, then summaries until one word covers the level below
+        size_t levelWords = detail::bitsetWords(capacity);
+        size_t total = levelWords;
+        while (levelWords > 1) {
+            levelOffsets_.push_back(total);
+            levelWords = (levelWords + 63) / 64;
+            total += levelWords;
+        }
+        levelOffsets_.push_back(total);
+        if (total == 0) {
+            // keep one empty top word so allocate needs no special case
+            levelOffsets_.back() = 1;
+            total = 1;
+        }
+        std::vector<Word> words(total);
+        words_.swap(words);
+        fill();
+    }
+
+    /** The number of slots, which allocate also returns when none is free. */
+    size_t capacity() const { return capacity_; }
+
+    /** Whether slot is allocated. */
+    bool test(size_t slot) const {
+        return (detail::loadWord(words_[slot / 64]) & bitAt(slot)) == 0;
+    }
+
+    /** The number of allocated slots. Scans the leaf words. */
+    size_t count() const {
+        size_t free = 0;
+        for (size_t i = 0; i < levelWords(0); ++i) {
+            free += detail::popcount64(detail::loadWord(words_[i]));
+        }
+        return capacity_ - free;
+    }
+
+    /**
+     * Claim the lowest free slot (in the single-threaded allocator) and
+     * return it, or return capacity() if every slot is allocated.
+     */
+    size_t allocate() {
+        const unsigned top = levels() - 1;
+        for (;;) {
+            size_t index = 0;
+            unsigned level = top;
+            uint64_t word = detail::loadWord(words_[levelOffsets_[top]]);
+            if (word == 0) {
+                return capacity_;
+            }
+            // follow the lowest set summary bit down to a leaf word
+            while (level > 0 && word != 0) {
+                index = index * 64 + detail::countTrailingZeros64(word);
+                --level;
+                word = detail::loadWord(words_[levelOffsets_[level] + index]);
+            }
+            if (level == 0) {
+                while (word != 0) {
+                    const uint64_t bit = word & (~word + 1);
+                    const uint64_t old = detail::fetchAndWord(words_[index], ~bit);
+                    if ((old & bit) != 0) {
+                        if (old == bit) {
+                            markEmpty(0, index);
+                        }
+                        return index * 64 + detail::countTrailingZeros64(bit);
+                    }
+                    word = old;
+                }
+            }
+            // a summary bit was stale or other threads took the word's slots
+            markEmpty(level, index);
+        }
+    }
+
+    /**
+     * Return slot to the pool. Returns false, changing nothing, if it was
+     * not allocated or is not below capacity().
+     */
+    bool free(size_t slot) {
+        if (slot >= capacity_) {
+            return false;
+        }
+        const size_t index = slot / 64;
+        const uint64_t bit = bitAt(slot);
+        const uint64_t old = detail::fetchOrWord(words_[index], bit);
+        if ((old & bit) != 0) {
+            return false;
+        }
+        if (old == 0) {
+            markNonEmpty(0, index);
+        }
+        return true;
+    }
+
+    /** Free every slot. Not safe to call while other threads use the pool. */
+    void clear() { fill(); }
+
+    /** Bytes of leaf and summary words. */
+    size_t memoryBytes() const { return words_.size() * sizeof(uint64_t); }
+
+private:
+    static uint64_t bitAt(size_t i) { return static_cast<uint64_t>(1) << (i % 64); }
+
+    unsigned levels() const { return static_cast<unsigned>(levelOffsets_.size() - 1); }
+
+    size_t levelWords(unsigned level) const {
+        return levelOffsets_[level + 1] - levelOffsets_[level];
+    }
+
+    Word& word(unsigned level, size_t index) { return words_[levelOffsets_[level] + index]; }
+
+    void fill() {
+        for (size_t i = 0; i < words_.size(); ++i) {
+            detail::storeWord(words_[i], 0);
+        }
+        for (size_t i = 0; i < capacity_ / 64; ++i) {
+            detail::storeWord(words_[i], ~static_cast<uint64_t>(0));
+        }
+        if (capacity_ % 64 != 0) {
+            detail::storeWord(words_[capacity_ / 64], detail::lastWordMask(capacity_));
+        }
+        for (unsigned level = 1; level < levels(); ++level) {
+            for (size_t i = 0; i < levelWords(level - 1); ++i) {
+                if (detail::loadWord(word(level - 1, i)) != 0) {
+                    detail::fetchOrWord(word(level, i / 64), bitAt(i));
+                }
+            }
+        }
+    }
+
+    /**
+     * Word index of level was seen empty: clear its summary bit, then look at
+     * the word again in case a free raced with the clear.
+     */
+    void markEmpty(unsigned level, size_t index) {
+        for (; level + 1 < levels(); ++level, index /= 64) {
+            const uint64_t bit = bitAt(index);
+            const uint64_t old = detail::fetchAndWord(word(level + 1, index / 64), ~bit);
+            if (detail::loadWord(word(level, index)) != 0) {
+                markNonEmpty(level, index);
+                return;
+            }
+            if (old != bit) {
+                // the summary word still covers other non-empty words
+                return;
+            }
+        }
+    }
+
+    /** Word index of level went from empty to non-empty: set its summary bit. */
+    void markNonEmpty(unsigned level, size_t index) {
+        for (; level + 1 < levels(); ++level, index /= 64) {
+            if (detail::fetchOrWord(word(level + 1, index / 64), bitAt(index)) != 0) {
+                return;
+            }
+        }
+    }
+
+    size_t capacity_;
+    // levelOffsets_[l] is the first word of level l in words_, level 0 the
+    // leaves; the last entry is the total
+    std::vector<size_t> levelOffsets_;
+    std::vector<Word> words_;
+};
+
+/** A slot allocator for use by one thread at a time. */
+typedef BasicBitmapAllocator<uint64_t> BitmapAllocator;
+
+/** A lock-free slot allocator that threads can share. */
+typedef BasicBitmapAllocator<std::atomic<uint64_t>> AtomicBitmapAllocator;
+
+}
+
+#endif
@@ -27,7 +27,8 @@
   * on c++11 or better.
   *
   * Bit positions are specified using little-endian order; pos == 0 is the least
-  * significant bit.
+  * significant bit. Msb0 numbers bits of byte buffers MSB-first instead, as
+  * protocol diagrams do.
   */
 
 // Allow it to compile on pre-C++11 compilers
@@ -40,26 +41,127 @@
 #if __cplusplus < 201103L && _MSVC_LANG < 201103L
     #define constexpr const
     #define static_assert(a,b)
+    #define BITS_CONSTEXPR
     #include <limits.h>
+    // C99's header, for uint64_t without spelling out long long
+    #include <stdint.h>
 #else
+    // Variadic field access (getFields, setFields, Layout) needs C++11
+    #define BITS_HAS_CXX11 1
+    // C++11 constexpr functions are limited to a single return statement
+    #define BITS_CONSTEXPR constexpr
     #include <type_traits>
     #include <climits>
+    #include <tuple>
+    #include <array>
+    #include <cstdint>
+#endif
+
+// Functions that assign to their arguments can only be constexpr from C++14
+#if __cplusplus >= 201402L || _MSVC_LANG >= 201402L
+    #define BITS_HAS_CXX14 1
+    #define BITS_CONSTEXPR14 constexpr
+#else
+    #define BITS_CONSTEXPR14 inline
+#endif
+
+// Fields that cross word boundaries are read with unaligned loads when the
+// words of a buffer are stored least significant byte first.
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) \
+    || defined(_M_X64) || defined(_M_IX86) || defined(_M_ARM64)
+    #define BITS_LITTLE_ENDIAN 1
+#endif
+
+#include <stddef.h>
+#include <string.h>
+
+// BMI1/BMI2 are only used when the compiler is told the target has them
+// (e.g. -mbmi2 or -march=haswell); see cpu_features.hpp for run-time dispatch.
+#if defined(__BMI__) || defined(__BMI2__)
+    #include <immintrin.h>
 #endif
 
 namespace bits {
 
 constexpr unsigned BITS_IN_BYTE = CHAR_BIT;
 
+namespace detail {
+
+/**
+ * Mask and shift constants for a field. They live here rather than in the
+ * functions that use them because constexpr functions can't have statics.
+ */
+template<typename T, unsigned width, unsigned lsb>
+struct FieldConstants {
+    static constexpr T MASK = ((static_cast<T>(1) << width) - 1) << lsb;
+
+    static constexpr T INV_MASK = static_cast<T>(~MASK);
+
+    // minimum value in a signed field of width bits
+    static constexpr T MIN_VALUE = static_cast<T>(1) << (width - 1);
+};
+
+#ifdef BITS_HAS_CXX11
+
+/**
+ * Word types the field functions accept: the unsigned integer types and,
+ * where the compiler has it, unsigned __int128, which std::is_integral only
+ * reports in GNU modes.
+ */
+template<typename T>
+struct IsUnsignedWord {
+    static constexpr bool value = std::is_integral<T>::value && std::is_unsigned<T>::value;
+};
+
+template<typename T>
+struct IsSignedValue {
+    static constexpr bool value = std::is_integral<T>::value && std::is_signed<T>::value;
+};
+
+template<typename T>
+struct IsFieldValue {
+    static constexpr bool value = std::is_integral<T>::value || std::is_enum<T>::value;
+};
+
+#if defined(__SIZEOF_INT128__)
+
+// __extension__ keeps -pedantic quiet about the non-standard type
+__extension__ typedef unsigned __int128 Uint128;
+__extension__ typedef __int128 Int128;
+
+template<>
+struct IsUnsignedWord<Uint128> {
+    static constexpr bool value = true;
+};
+
+template<>
+struct IsSignedValue<Int128> {
+    static constexpr bool value = true;
+};
+
+template<>
+struct IsFieldValue<Uint128> {
+    static constexpr bool value = true;
+};
+
+template<>
+struct IsFieldValue<Int128> {
+    static constexpr bool value = true;
+};
+
+#endif
+
+#endif
+
+}
+
 /**
  * Set a bit in dest at pos.
  */
 template <unsigned pos, typename DestType>
-void setBit(DestType& dest, bool value) {
+BITS_CONSTEXPR14 void setBit(DestType& dest, bool value) {
 
-  static_assert(std::is_integral<DestType>::value,
-    "DestType must be an unsigned integer type");
-
-  static_assert(std::is_unsigned<DestType>::value,
+  static_assert(detail::IsUnsignedWord<DestType>::value,
     "DestType must be an unsigned integer type");
 
   static_assert(pos < sizeof(DestType) * BITS_IN_BYTE,
@@ -68,16 +170,28 @@ void setBit(DestType& dest, bool value) {
   dest = (static_cast<DestType>(value) << pos) | (dest & ~(static_cast<DestType>(1) << pos));
 }
 
+/**
+ * Return word with the bit at pos set to value.
+ */
+template <unsigned pos, typename T>
+BITS_CONSTEXPR T withBit(const T word, bool value) {
+
+  static_assert(detail::IsUnsignedWord<T>::value,
+    "T must be an unsigned integer type");
+
+  static_assert(pos < sizeof(T) * BITS_IN_BYTE,
+    "pos must be < sizeof(T) * BITS_IN_BYTE");
+
+  return static_cast<T>((static_cast<T>(value) << pos) | (word & ~(static_cast<T>(1) << pos)));
+}
+
 /**
  * Get a bit from src at pos.
  */
 template <unsigned pos, typename SrcType>
-bool getBit(const SrcType& src) {
+BITS_CONSTEXPR bool getBit(const SrcType& src) {
 
-  static_assert(std::is_integral<SrcType>::value,
-    "SrcType must be an unsigned integer type");
-
-  static_assert(std::is_unsigned<SrcType>::value,
+  static_assert(detail::IsUnsignedWord<SrcType>::value,
     "SrcType must be an unsigned integer type");
 
   static_assert(pos < sizeof(SrcType) * BITS_IN_BYTE,
@@ -91,15 +205,11 @@ bool getBit(const SrcType& src) {
  * field's least significant bit is at lsb.
  */
 template<unsigned width, unsigned lsb, typename DestType, typename ValueType>
-void setBits(DestType& dest, const ValueType value) {
-    static_assert(std::is_integral<DestType>::value,
-        "DestType must be an unsigned integer type");
-
-    static_assert(std::is_unsigned<DestType>::value,
+BITS_CONSTEXPR14 void setBits(DestType& dest, const ValueType value) {
+    static_assert(detail::IsUnsignedWord<DestType>::value,
         "DestType must be an unsigned integer type");
 
-    static_assert(std::is_integral<ValueType>::value
-        || std::is_enum<ValueType>::value,
+    static_assert(detail::IsFieldValue<ValueType>::value,
         "ValueType must be an integer or enum type");
 
     static_assert(width > 0,
@@ -111,11 +221,34 @@ void setBits(DestType& dest, const ValueType value) {
     static_assert(sizeof(DestType) * BITS_IN_BYTE >= width + lsb,
         "sizeof DestType * BITS_IN_BYTE must be >= width + lsb");
 
-    static constexpr DestType MASK = ((static_cast<DestType>(1) << width) - 1) << lsb;
+    typedef detail::FieldConstants<DestType, width, lsb> Constants;
+
+    dest = (Constants::MASK & (static_cast<DestType>(value) << lsb)) | (dest & Constants::INV_MASK);
+}
+
+/**
+ * Return word with the field of width bits at lsb set to value. This is the
+ * constexpr form of setBits, for building constant tables at compile time.
+ */
+template<unsigned width, unsigned lsb, typename T, typename ValueType>
+BITS_CONSTEXPR T withBits(const T word, const ValueType value) {
+    static_assert(detail::IsUnsignedWord<T>::value,
+        "T must be an unsigned integer type");
 
-    static constexpr DestType INV_MASK = ~MASK;
+    static_assert(detail::IsFieldValue<ValueType>::value,
+        "ValueType must be an integer or enum type");
 
-    dest = (MASK & (static_cast<DestType>(value) << lsb)) | (dest & INV_MASK);
+    static_assert(width > 0,
+        "width must be > 0");
+
+    static_assert(width < sizeof(T) * BITS_IN_BYTE,
+        "width must be < than sizeof T * BITS_IN_BYTE");
+
+    static_assert(sizeof(T) * BITS_IN_BYTE >= width + lsb,
+        "sizeof T * BITS_IN_BYTE must be >= width + lsb");
+
+    return static_cast<T>((detail::FieldConstants<T, width, lsb>::MASK & (static_cast<T>(value) << lsb))
+        | (word & detail::FieldConstants<T, width, lsb>::INV_MASK));
 }
 
 /**
@@ -123,11 +256,8 @@ void setBits(DestType& dest, const ValueType value) {
  * field's least significant bit at lsb.
  */
 template<unsigned width, unsigned lsb, typename T>
-T getUbits(const T& src){
-    static_assert(std::is_integral<T>::value,
-        "T must be an unsigned integer type");
-
-    static_assert(std::is_unsigned<T>::value,
+BITS_CONSTEXPR T getUbits(const T& src){
+    static_assert(detail::IsUnsignedWord<T>::value,
         "T must be an unsigned integer type");
 
     static_assert(width > 0,
@@ -139,9 +269,7 @@ T getUbits(const T& src){
     static_assert(sizeof(T) * BITS_IN_BYTE >= width + lsb,
         "sizeof T * BITS_IN_BYTE must be >= width + lsb");
 
-    static constexpr T MASK = ((static_cast<T>(1) << width) - 1) << lsb;
-
-    return (MASK & src) >> lsb;
+    return (detail::FieldConstants<T, width, lsb>::MASK & src) >> lsb;
 }
 
 /**
@@ -149,17 +277,11 @@ T getUbits(const T& src){
  * field's least significant bit at lsb.
  */
 template<unsigned width, unsigned lsb, typename ValueType, typename SrcType>
-ValueType getSbits(const SrcType& src) {
-    static_assert(std::is_integral<SrcType>::value,
-        "SrcType must be an unsigned integer type");
-
-    static_assert(std::is_unsigned<SrcType>::value,
+BITS_CONSTEXPR ValueType getSbits(const SrcType& src) {
+    static_assert(detail::IsUnsignedWord<SrcType>::value,
         "SrcType must be an unsigned integer type");
 
-    static_assert(std::is_integral<ValueType>::value,
-        "ValueType must be a signed integer type");
-
-    static_assert(std::is_signed<ValueType>::value,
+    static_assert(detail::IsSignedValue<ValueType>::value,
         "ValueType must be a signed integer type");
 
     static_assert(width > 0,
@@ -174,19 +296,1101 @@ ValueType getSbits(const SrcType& src) {
     static_assert(sizeof(ValueType) * BITS_IN_BYTE >= width,
         "sizeof ValueType * BITS_IN_BYTE must be >= width");
 
-    static constexpr SrcType MASK = ((static_cast<SrcType>(1) << width) - 1) << lsb;
-
-    // minimum value in a signed field of width bits
-    static constexpr SrcType MIN_VALUE = static_cast<SrcType>(1) << (width - 1);
-
-    SrcType retVal = (MASK & src) >> lsb;
     // sign extend without implementation defined behavior
     // XORing clears the bit at MIN_VALUE;
     // then it uses unsigned integer underflow behavior guaranteed by the
     // standard to fill MIN_VALUE and the bits to the left of it
-    return static_cast<ValueType>((retVal ^ MIN_VALUE) - MIN_VALUE);
+    return static_cast<ValueType>(
+        (static_cast<SrcType>((detail::FieldConstants<SrcType, width, lsb>::MASK & src) >> lsb)
+            ^ detail::FieldConstants<SrcType, width, lsb>::MIN_VALUE)
+        - detail::FieldConstants<SrcType, width, lsb>::MIN_VALUE);
+}
+
+/**
+ * Describes a field of width bits whose least significant bit is at lsb.
+ * ValueType is the type the field is read as: an unsigned integer (the default,
+ * void, means the type of the word holding the field), a signed integer, which
+ * is sign extended the same way getSbits does, or an enum, which is sign
+ * extended if its underlying type is signed.
+ */
+template<unsigned width, unsigned lsb, typename Value = void>
+struct Field {
+    static constexpr unsigned WIDTH = width;
+    static constexpr unsigned LSB = lsb;
+    typedef Value ValueType;
+};
+
+template<unsigned width, unsigned lsb, typename Value>
+constexpr unsigned Field<width, lsb, Value>::WIDTH;
+
+template<unsigned width, unsigned lsb, typename Value>
+constexpr unsigned Field<width, lsb, Value>::LSB;
+
+#ifdef BITS_HAS_CXX11
+
+namespace detail {
+
+template<typename ValueType, typename WordType,
+    bool isEnum = std::is_enum<ValueType>::value>
+struct FieldRepresentation {
+    typedef ValueType type;
+};
+
+template<typename ValueType, typename WordType>
+struct FieldRepresentation<ValueType, WordType, true> {
+    typedef typename std::underlying_type<ValueType>::type type;
+};
+
+template<typename WordType>
+struct FieldRepresentation<void, WordType, false> {
+    typedef WordType type;
+};
+
+template<typename F, typename WordType,
+    bool isSigned = IsSignedValue<typename FieldRepresentation<typename F::ValueType, WordType>::type>::value>
+struct FieldReader {
+    static BITS_CONSTEXPR typename FieldRepresentation<typename F::ValueType, WordType>::type read(const WordType& word) {
+        return static_cast<typename FieldRepresentation<typename F::ValueType, WordType>::type>(
+            getUbits<F::WIDTH, F::LSB>(word));
+    }
+};
+
+template<typename F, typename WordType>
+struct FieldReader<F, WordType, true> {
+    static BITS_CONSTEXPR typename FieldRepresentation<typename F::ValueType, WordType>::type read(const WordType& word) {
+        return getSbits<F::WIDTH, F::LSB,
+            typename FieldRepresentation<typename F::ValueType, WordType>::type>(word);
+    }
+};
+
+}
+
+/**
+ * The type a Field is read as when it is stored in a WordType.
+ */
+template<typename F, typename WordType>
+struct FieldValue {
+    typedef typename std::conditional<std::is_void<typename F::ValueType>::value,
+        WordType, typename F::ValueType>::type type;
+};
+
+/**
+ * Get the field described by F from src, converted to F's value type.
+ */
+template<typename F, typename SrcType>
+BITS_CONSTEXPR14 typename FieldValue<F, typename std::remove_cv<SrcType>::type>::type getField(const SrcType& src) {
+    typedef typename std::remove_cv<SrcType>::type WordType;
+    const WordType word = src;
+    return static_cast<typename FieldValue<F, WordType>::type>(
+        detail::FieldReader<F, WordType>::read(word));
+}
+
+/**
+ * Get several fields from src at once. src is read once and every field is
+ * extracted from that copy, so a volatile or shared src costs a single load.
+ * Returns a tuple holding each field's value in the order the fields are given.
+ */
+template<typename... Fields, typename SrcType>
+BITS_CONSTEXPR14 std::tuple<typename FieldValue<Fields, typename std::remove_cv<SrcType>::type>::type...>
+getFields(const SrcType& src) {
+    typedef typename std::remove_cv<SrcType>::type WordType;
+    const WordType word = src;
+    return std::tuple<typename FieldValue<Fields, WordType>::type...>(
+        getField<Fields>(word)...);
+}
+
+namespace detail {
+
+/**
+ * The mask of the field F in a WordType, with the same checks setBits does.
+ */
+template<typename WordType, typename F>
+struct FieldMask {
+    static_assert(F::WIDTH > 0,
+        "width must be > 0");
+
+    static_assert(F::WIDTH < sizeof(WordType) * BITS_IN_BYTE,
+        "width must be < than sizeof WordType * BITS_IN_BYTE");
+
+    static_assert(sizeof(WordType) * BITS_IN_BYTE >= F::WIDTH + F::LSB,
+        "sizeof WordType * BITS_IN_BYTE must be >= width + lsb");
+
+    static constexpr WordType value = ((static_cast<WordType>(1) << F::WIDTH) - 1) << F::LSB;
+};
+
+/**
+ * The union of the masks of Fields, and whether any two of them overlap.
+ */
+template<typename WordType, typename... Fields>
+struct CombinedMask {
+    static constexpr WordType value = 0;
+    static constexpr bool OVERLAP = false;
+};
+
+template<typename WordType, typename F, typename... Rest>
+struct CombinedMask<WordType, F, Rest...> {
+    static constexpr WordType value =
+        FieldMask<WordType, F>::value | CombinedMask<WordType, Rest...>::value;
+    static constexpr bool OVERLAP =
+        (FieldMask<WordType, F>::value & CombinedMask<WordType, Rest...>::value) != 0
+        || CombinedMask<WordType, Rest...>::OVERLAP;
+};
+
+/**
+ * OR together each value shifted and masked into its field.
+ */
+template<typename WordType, typename... Fields>
+struct FieldPacker {
+    static BITS_CONSTEXPR WordType pack() {
+        return 0;
+    }
+};
+
+template<typename WordType, typename F, typename... Rest>
+struct FieldPacker<WordType, F, Rest...> {
+    template<typename ValueType, typename... Values>
+    static BITS_CONSTEXPR WordType pack(const ValueType value, const Values... values) {
+        static_assert(detail::IsFieldValue<ValueType>::value,
+            "ValueType must be an integer or enum type");
+
+        return (FieldMask<WordType, F>::value & (static_cast<WordType>(value) << F::LSB))
+            | FieldPacker<WordType, Rest...>::pack(values...);
+    }
+};
+
+}
+
+/**
+ * Set several fields of dest with a single read-modify-write. The combined mask
+ * is computed at compile time and the fields must not overlap. When the fields
+ * cover every bit of dest it is only written, not read.
+ */
+template<typename... Fields, typename DestType, typename... Values>
+BITS_CONSTEXPR14 void setFields(DestType& dest, const Values... values) {
+    typedef typename std::remove_cv<DestType>::type WordType;
+
+    static_assert(detail::IsUnsignedWord<WordType>::value,
+        "DestType must be an unsigned integer type");
+
+    static_assert(sizeof...(Fields) == sizeof...(Values),
+        "setFields needs one value per field");
+
+    static_assert(!detail::CombinedMask<WordType, Fields...>::OVERLAP,
+        "fields passed to setFields must not overlap");
+
+    typedef detail::CombinedMask<WordType, Fields...> Combined;
+
+    const WordType packed = detail::FieldPacker<WordType, Fields...>::pack(values...);
+    if (Combined::value == static_cast<WordType>(~static_cast<WordType>(0))) {
+        dest = packed;
+    } else {
+        const WordType word = dest;
+        dest = (word & static_cast<WordType>(~Combined::value)) | packed;
+    }
+}
+
+/**
+ * Return word with several fields set; the constexpr form of setFields.
+ */
+template<typename... Fields, typename T, typename... Values>
+BITS_CONSTEXPR T withFields(const T word, const Values... values) {
+    static_assert(detail::IsUnsignedWord<T>::value,
+        "T must be an unsigned integer type");
+
+    static_assert(sizeof...(Fields) == sizeof...(Values),
+        "withFields needs one value per field");
+
+    static_assert(!detail::CombinedMask<T, Fields...>::OVERLAP,
+        "fields passed to withFields must not overlap");
+
+    return static_cast<T>((word & static_cast<T>(~detail::CombinedMask<T, Fields...>::value))
+        | detail::FieldPacker<T, Fields...>::pack(values...));
+}
+
+namespace detail {
+
+template<bool... values>
+struct All : std::true_type {};
+
+template<bool first, bool... rest>
+struct All<first, rest...>
+    : std::integral_constant<bool, first && All<rest...>::value> {};
+
+template<typename F, typename... Fields>
+struct ContainsField : std::false_type {};
+
+template<typename F, typename First, typename... Rest>
+struct ContainsField<F, First, Rest...>
+    : std::integral_constant<bool,
+        std::is_same<F, First>::value || ContainsField<F, Rest...>::value> {};
+
+}
+
+/**
+ * A word of type Word holding the fields Fields. The layout is checked at
+ * compile time: every field must fit in Word and no two fields may overlap.
+ * Use CompleteLayout when every bit of the word must belong to a field.
+ *
+ * Layout has no state; it collects the functions above under one name so the
+ * field list only appears once:
+ *
+ *     typedef Layout<uint32_t, Opcode, Dest, Imm> Insn;
+ *     uint32_t word = Insn::pack(Op::ADDI, 3, -12);
+ *     int32_t imm = Insn::get<Imm>(word);
+ */
+template<typename Word, typename... Fields>
+struct Layout {
+    static_assert(detail::IsUnsignedWord<Word>::value,
+        "Word must be an unsigned integer type");
+
+    static_assert(!detail::CombinedMask<Word, Fields...>::OVERLAP,
+        "fields in a Layout must not overlap");
+
+    typedef Word WordType;
+
+    /** The Field descriptors, for code that needs to iterate over them. */
+    typedef std::tuple<Fields...> FieldsType;
+
+    typedef std::tuple<typename FieldValue<Fields, Word>::type...> ValuesType;
+
+    static constexpr unsigned FIELD_COUNT = sizeof...(Fields);
+
+    /** The bits that belong to some field. */
+    static constexpr Word MASK = detail::CombinedMask<Word, Fields...>::value;
+
+    /** The bits that belong to no field. */
+    static constexpr Word UNUSED_MASK = static_cast<Word>(~MASK);
+
+    static constexpr bool IS_COMPLETE = UNUSED_MASK == 0;
+
+    /** The mask of a single field. */
+    template<typename F>
+    static constexpr Word fieldMask() {
+        static_assert(detail::ContainsField<F, Fields...>::value,
+            "F is not a field of this Layout");
+        return detail::FieldMask<Word, F>::value;
+    }
+
+    template<typename F>
+    static BITS_CONSTEXPR14 typename FieldValue<F, Word>::type get(const Word& word) {
+        static_assert(detail::ContainsField<F, Fields...>::value,
+            "F is not a field of this Layout");
+        return getField<F>(word);
+    }
+
+    /**
+     * Set one or more fields of word with a single read-modify-write.
+     */
+    template<typename... SetFields, typename... Values>
+    static BITS_CONSTEXPR14 void set(Word& word, const Values... values) {
+        static_assert(detail::All<detail::ContainsField<SetFields, Fields...>::value...>::value,
+            "every field passed to set must be a field of this Layout");
+        setFields<SetFields...>(word, values...);
+    }
+
+    /**
+     * Build a whole word from one value per field, in the order the fields
+     * are listed. Unused bits are zero.
+     */
+    static BITS_CONSTEXPR Word pack(const typename FieldValue<Fields, Word>::type... values) {
+        return detail::FieldPacker<Word, Fields...>::pack(values...);
+    }
+
+    /**
+     * Every field's value, in the order the fields are listed.
+     */
+    static BITS_CONSTEXPR14 ValuesType unpack(const Word& word) {
+        return getFields<Fields...>(word);
+    }
+};
+
+// Definitions for odr-used static members, needed before C++17.
+template<typename Word, typename... Fields>
+constexpr unsigned Layout<Word, Fields...>::FIELD_COUNT;
+
+template<typename Word, typename... Fields>
+constexpr Word Layout<Word, Fields...>::MASK;
+
+template<typename Word, typename... Fields>
+constexpr Word Layout<Word, Fields...>::UNUSED_MASK;
+
+template<typename Word, typename... Fields>
+constexpr bool Layout<Word, Fields...>::IS_COMPLETE;
+
+/**
+ * A Layout whose fields must cover every bit of Word.
+ */
+template<typename Word, typename... Fields>
+struct CompleteLayout : Layout<Word, Fields...> {
+    static_assert(Layout<Word, Fields...>::IS_COMPLETE,
+        "the fields of a CompleteLayout must cover every bit of Word");
+};
+
+/**
+ * Words wider than 128 bits are stored as arrays of 64-bit limbs, limb 0
+ * holding bits 0-63. A field of up to 64 bits covers one or two limbs and
+ * only those limbs are accessed; the masks are still computed at compile time.
+ */
+typedef uint64_t Limb;
+
+namespace detail {
+
+constexpr unsigned LIMB_BITS = 64;
+
+template<unsigned width, unsigned lsb,
+    bool crosses = (lsb % LIMB_BITS + width > LIMB_BITS),
+    bool whole = (width == LIMB_BITS)>
+struct LimbField {
+    // a field inside one limb
+    template<size_t N>
+    static BITS_CONSTEXPR14 Limb get(const std::array<Limb, N>& limbs) {
+        return getUbits<width, lsb % LIMB_BITS>(limbs[lsb / LIMB_BITS]);
+    }
+
+    template<size_t N, typename ValueType>
+    static void set(std::array<Limb, N>& limbs, const ValueType value) {
+        setBits<width, lsb % LIMB_BITS>(limbs[lsb / LIMB_BITS], value);
+    }
+};
+
+template<unsigned lsb>
+struct LimbField<LIMB_BITS, lsb, false, true> {
+    template<size_t N>
+    static BITS_CONSTEXPR14 Limb get(const std::array<Limb, N>& limbs) {
+        return limbs[lsb / LIMB_BITS];
+    }
+
+    template<size_t N, typename ValueType>
+    static void set(std::array<Limb, N>& limbs, const ValueType value) {
+        limbs[lsb / LIMB_BITS] = static_cast<Limb>(value);
+    }
+};
+
+template<unsigned width, unsigned lsb, bool whole>
+struct LimbField<width, lsb, true, whole> {
+    // the low part fills the top of the first limb, the rest is at the
+    // bottom of the next
+    static constexpr unsigned FIRST = lsb / LIMB_BITS;
+    static constexpr unsigned SHIFT = lsb % LIMB_BITS;
+    static constexpr unsigned LOW_WIDTH = LIMB_BITS - SHIFT;
+
+    template<size_t N>
+    static BITS_CONSTEXPR14 Limb get(const std::array<Limb, N>& limbs) {
+        return getUbits<LOW_WIDTH, SHIFT>(limbs[FIRST])
+            | (getUbits<width - LOW_WIDTH, 0>(limbs[FIRST + 1]) << LOW_WIDTH);
+    }
+
+    template<size_t N, typename ValueType>
+    static void set(std::array<Limb, N>& limbs, const ValueType value) {
+        setBits<LOW_WIDTH, SHIFT>(limbs[FIRST], value);
+        setBits<width - LOW_WIDTH, 0>(limbs[FIRST + 1], static_cast<Limb>(value) >> LOW_WIDTH);
+    }
+};
+
+}
+
+/**
+ * Set the bit at pos of a multi-limb word.
+ */
+template<unsigned pos, size_t N>
+inline void setBit(std::array<Limb, N>& dest, bool value) {
+    static_assert(pos < N * detail::LIMB_BITS,
+        "pos must be < N * 64");
+
+    setBit<pos % detail::LIMB_BITS>(dest[pos / detail::LIMB_BITS], value);
+}
+
+/**
+ * Get the bit at pos of a multi-limb word.
+ */
+template<unsigned pos, size_t N>
+BITS_CONSTEXPR14 bool getBit(const std::array<Limb, N>& src) {
+    static_assert(pos < N * detail::LIMB_BITS,
+        "pos must be < N * 64");
+
+    return getBit<pos % detail::LIMB_BITS>(src[pos / detail::LIMB_BITS]);
+}
+
+/**
+ * Set a field of a multi-limb word. The field may cross a limb boundary.
+ */
+template<unsigned width, unsigned lsb, size_t N, typename ValueType>
+inline void setBits(std::array<Limb, N>& dest, const ValueType value) {
+    static_assert(detail::IsFieldValue<ValueType>::value,
+        "ValueType must be an integer or enum type");
+
+    static_assert(width > 0 && width <= detail::LIMB_BITS,
+        "width must be > 0 and <= 64");
+
+    static_assert(N * detail::LIMB_BITS >= width + lsb,
+        "N * 64 must be >= width + lsb");
+
+    detail::LimbField<width, lsb>::set(dest, value);
+}
+
+/**
+ * Get an unsigned field of a multi-limb word.
+ */
+template<unsigned width, unsigned lsb, size_t N>
+BITS_CONSTEXPR14 Limb getUbits(const std::array<Limb, N>& src) {
+    static_assert(width > 0 && width <= detail::LIMB_BITS,
+        "width must be > 0 and <= 64");
+
+    static_assert(N * detail::LIMB_BITS >= width + lsb,
+        "N * 64 must be >= width + lsb");
+
+    return detail::LimbField<width, lsb>::get(src);
+}
+
+/**
+ * Get a signed field of a multi-limb word, sign extended the same way
+ * getSbits does.
+ */
+template<unsigned width, unsigned lsb, typename ValueType, size_t N>
+BITS_CONSTEXPR14 ValueType getSbits(const std::array<Limb, N>& src) {
+    static_assert(detail::IsSignedValue<ValueType>::value,
+        "ValueType must be a signed integer type");
+
+    static_assert(sizeof(ValueType) * BITS_IN_BYTE >= width,
+        "sizeof ValueType * BITS_IN_BYTE must be >= width");
+
+    return static_cast<ValueType>((getUbits<width, lsb>(src) ^ (static_cast<Limb>(1) << (width - 1)))
+        - (static_cast<Limb>(1) << (width - 1)));
+}
+
+#endif
+
+namespace detail {
+
+/**
+ * Extract width bits of src starting at lsb, where width and lsb are run-time
+ * values. Uses SHRX+BZHI on BMI2 targets, BEXTR on BMI1 targets and a shift
+ * and mask otherwise. Types narrower than 32 bits are widened first; types
+ * wider than 64 bits, such as unsigned __int128, always take the shift and
+ * mask.
+ */
+template<typename T>
+inline T extractBits(T src, unsigned width, unsigned lsb) {
+#if defined(__BMI2__)
+    if (sizeof(T) > 8) {
+        return static_cast<T>((src >> lsb) & ((static_cast<T>(1) << width) - 1));
+    }
+    if (sizeof(T) > 4) {
+        return static_cast<T>(_bzhi_u64(static_cast<uint64_t>(src) >> lsb, width));
+    }
+    return static_cast<T>(_bzhi_u32(static_cast<unsigned>(src) >> lsb, width));
+#elif defined(__BMI__)
+    if (sizeof(T) > 8) {
+        return static_cast<T>((src >> lsb) & ((static_cast<T>(1) << width) - 1));
+    }
+    if (sizeof(T) > 4) {
+        return static_cast<T>(_bextr_u64(static_cast<uint64_t>(src), lsb, width));
+    }
+    return static_cast<T>(_bextr_u32(static_cast<unsigned>(src), lsb, width));
+#else
+    return static_cast<T>((src >> lsb) & ((static_cast<T>(1) << width) - 1));
+#endif
+}
+
+/**
+ * A mask of width ones starting at lsb, where width and lsb are run-time values.
+ */
+template<typename T>
+inline T fieldMask(unsigned width, unsigned lsb) {
+#if defined(__BMI2__)
+    if (sizeof(T) > 8) {
+        return static_cast<T>(((static_cast<T>(1) << width) - 1) << lsb);
+    }
+    if (sizeof(T) > 4) {
+        return static_cast<T>(_bzhi_u64(~static_cast<uint64_t>(0), width) << lsb);
+    }
+    return static_cast<T>(_bzhi_u32(~0U, width) << lsb);
+#else
+    return static_cast<T>(((static_cast<T>(1) << width) - 1) << lsb);
+#endif
+}
+
+}
+
+/**
+ * Set a field in dest to value when the field's width and lsb are only known
+ * at run time, e.g. when they come from a schema. The caller must ensure
+ * 0 < width < sizeof(DestType) * BITS_IN_BYTE and width + lsb fits in DestType;
+ * unlike the template version this cannot be checked at compile time.
+ */
+template<typename DestType, typename ValueType>
+inline void setBits(DestType& dest, unsigned width, unsigned lsb, const ValueType value) {
+    static_assert(detail::IsUnsignedWord<DestType>::value,
+        "DestType must be an unsigned integer type");
+
+    static_assert(detail::IsFieldValue<ValueType>::value,
+        "ValueType must be an integer or enum type");
+
+    const DestType mask = detail::fieldMask<DestType>(width, lsb);
+
+    dest = (mask & (static_cast<DestType>(value) << lsb)) | (dest & ~mask);
+}
+
+/**
+ * Get an unsigned field from src when the field's width and lsb are only known
+ * at run time. The same preconditions as the run-time setBits apply.
+ */
+template<typename T>
+inline T getUbits(const T& src, unsigned width, unsigned lsb) {
+    static_assert(detail::IsUnsignedWord<T>::value,
+        "T must be an unsigned integer type");
+
+    return detail::extractBits(src, width, lsb);
+}
+
+/**
+ * Get a signed field from src when the field's width and lsb are only known
+ * at run time. The same preconditions as the run-time setBits apply.
+ */
+template<typename ValueType, typename SrcType>
+inline ValueType getSbits(const SrcType& src, unsigned width, unsigned lsb) {
+    static_assert(detail::IsUnsignedWord<SrcType>::value,
+        "SrcType must be an unsigned integer type");
+
+    static_assert(detail::IsSignedValue<ValueType>::value,
+        "ValueType must be a signed integer type");
+
+    const SrcType minValue = static_cast<SrcType>(1) << (width - 1);
+
+    const SrcType retVal = detail::extractBits(src, width, lsb);
+    // same sign extension as the template version
+    return static_cast<ValueType>((retVal ^ minValue) - minValue);
+}
+
+namespace detail {
+
+inline uint64_t loadBytes64(const unsigned char* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline void storeBytes64(unsigned char* p, uint64_t value) {
+    memcpy(p, &value, sizeof(value));
+}
+
+template<typename Word>
+inline Word byteSwap(Word word) {
+    Word swapped = 0;
+    for (size_t i = 0; i < sizeof(Word); ++i) {
+        swapped = static_cast<Word>((swapped << BITS_IN_BYTE) | ((word >> (i * BITS_IN_BYTE)) & 0xFF));
+    }
+    return swapped;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+
+inline unsigned short byteSwap(unsigned short word) { return __builtin_bswap16(word); }
+inline unsigned int byteSwap(unsigned int word) { return __builtin_bswap32(word); }
+inline unsigned long byteSwap(unsigned long word) {
+    return sizeof(word) == 8 ? static_cast<unsigned long>(__builtin_bswap64(word))
+        : static_cast<unsigned long>(__builtin_bswap32(static_cast<unsigned int>(word)));
+}
+#ifdef BITS_HAS_CXX11
+inline unsigned long long byteSwap(unsigned long long word) { return __builtin_bswap64(word); }
+#endif
+
+#endif
+
+/**
+ * Where a field of width bits at bitOffset lies in a buffer of Words: in
+ * words [first, last], starting shift bits into words[first].
+ */
+template<typename Word>
+struct BitSpan {
+    static constexpr unsigned WORD_BITS = sizeof(Word) * BITS_IN_BYTE;
+
+    BitSpan(size_t bitOffset, unsigned width)
+        : first(bitOffset / WORD_BITS),
+          last((bitOffset + width - 1) / WORD_BITS),
+          shift(static_cast<unsigned>(bitOffset % WORD_BITS)) {}
+
+    // Offset in bytes from words[first] of an 8-byte window that lies inside
+    // the covered words and holds the field, or -1 if there is none.
+    int window(unsigned width) const {
+#if defined(BITS_LITTLE_ENDIAN)
+        // a field of at most 64 bits crosses at most one 64-bit word boundary
+        const size_t spanBytes = sizeof(Word) >= 8 ? 2 * sizeof(Word) : (last - first + 1) * sizeof(Word);
+        if (spanBytes >= 8) {
+            const size_t start = shift / 8 < spanBytes - 8 ? shift / 8 : spanBytes - 8;
+            // 8 bytes from the field's first byte hold any field of up to 57 bits
+            if (width <= 57 || shift - start * 8 + width <= 64) {
+                return static_cast<int>(start);
+            }
+        }
+#endif
+        (void)width;
+        return -1;
+    }
+
+    size_t first;
+    size_t last;
+    unsigned shift;
+};
+
+template<typename Word>
+constexpr unsigned BitSpan<Word>::WORD_BITS;
+
+template<typename Word>
+inline uint64_t readBitsAt(const Word* buf, size_t bitOffset, unsigned width) {
+    const uint64_t mask = ~static_cast<uint64_t>(0) >> (64 - width);
+    const BitSpan<Word> span(bitOffset, width);
+    if (span.first == span.last) {
+        return static_cast<uint64_t>(buf[span.first] >> span.shift) & mask;
+    }
+    const int window = span.window(width);
+    if (window >= 0) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(buf + span.first) + window;
+        return (loadBytes64(p) >> (span.shift - static_cast<unsigned>(window) * 8)) & mask;
+    }
+    uint64_t value = static_cast<uint64_t>(buf[span.first] >> span.shift);
+    unsigned filled = BitSpan<Word>::WORD_BITS - span.shift;
+    for (size_t w = span.first + 1; w <= span.last; ++w, filled += BitSpan<Word>::WORD_BITS) {
+        value |= static_cast<uint64_t>(buf[w]) << filled;
+    }
+    return value & mask;
+}
+
+template<typename Word>
+inline void writeBitsAt(Word* buf, size_t bitOffset, unsigned width, uint64_t value) {
+    const uint64_t mask = ~static_cast<uint64_t>(0) >> (64 - width);
+    value &= mask;
+    const BitSpan<Word> span(bitOffset, width);
+    if (span.first == span.last) {
+        const Word wordMask = static_cast<Word>(static_cast<Word>(mask) << span.shift);
+        buf[span.first] = static_cast<Word>((buf[span.first] & ~wordMask)
+            | static_cast<Word>(static_cast<Word>(value) << span.shift));
+        return;
+    }
+    const int window = span.window(width);
+    if (window >= 0) {
+        unsigned char* p = reinterpret_cast<unsigned char*>(buf + span.first) + window;
+        const unsigned shift = span.shift - static_cast<unsigned>(window) * 8;
+        storeBytes64(p, (loadBytes64(p) & ~(mask << shift)) | (value << shift));
+        return;
+    }
+    const Word firstMask = static_cast<Word>(static_cast<Word>(mask) << span.shift);
+    buf[span.first] = static_cast<Word>((buf[span.first] & ~firstMask)
+        | static_cast<Word>(static_cast<Word>(value) << span.shift));
+    unsigned filled = BitSpan<Word>::WORD_BITS - span.shift;
+    size_t w = span.first + 1;
+    for (; w < span.last; ++w, filled += BitSpan<Word>::WORD_BITS) {
+        buf[w] = static_cast<Word>(value >> filled);
+    }
+    const Word lastMask = static_cast<Word>(~static_cast<uint64_t>(0) >> (64 - (width - filled)));
+    buf[w] = static_cast<Word>((buf[w] & ~lastMask) | (static_cast<Word>(value >> filled) & lastMask));
+}
+
+/**
+ * readBitsAt for packed arrays of 64-bit words that keep a readable word past
+ * their last field: two loads and no branch, for hot decode loops. mask has
+ * the field's width low bits set.
+ */
+inline uint64_t readPaddedBits(const uint64_t* words, size_t bitOffset, uint64_t mask) {
+    const size_t word = bitOffset / 64;
+    const unsigned offset = bitOffset % 64;
+    // the second term is 0 unless the field straddles two words;
+    // splitting the shift keeps it below 64 when offset == 0
+    return ((words[word] >> offset) | ((words[word + 1] << 1) << (63 - offset))) & mask;
+}
+
+}
+
+/**
+ * Get an unsigned field of width bits starting at bit bitOffset of buf, which
+ * may cross word boundaries. Bit k of buf is bit k % W of buf[k / W] for
+ * W-bit words, continuing the little-endian bit order of the other functions.
+ * Only the words the field covers are read. On little-endian hosts a field
+ * spanning several words is read with one unaligned 64-bit load when it fits
+ * in 8 bytes of those words.
+ */
+template<unsigned width, typename Word>
+inline uint64_t getUbitsAt(const Word* buf, size_t bitOffset) {
+    static_assert(detail::IsUnsignedWord<Word>::value,
+        "Word must be an unsigned integer type");
+
+    static_assert(width > 0 && width <= 64,
+        "width must be > 0 and <= 64");
+
+    return detail::readBitsAt(buf, bitOffset, width);
 }
 
+/**
+ * getUbitsAt with the bit offset known at compile time, so the choice of
+ * load folds away.
+ */
+template<unsigned width, size_t bitOffset, typename Word>
+inline uint64_t getUbitsAt(const Word* buf) {
+    return getUbitsAt<width>(buf, bitOffset);
+}
+
+/**
+ * Get a signed field of width bits starting at bit bitOffset of buf. It is
+ * sign extended the same way getSbits does.
+ */
+template<unsigned width, typename ValueType, typename Word>
+inline ValueType getSbitsAt(const Word* buf, size_t bitOffset) {
+    static_assert(detail::IsSignedValue<ValueType>::value,
+        "ValueType must be a signed integer type");
+
+    static_assert(width > 0 && width <= 64,
+        "width must be > 0 and <= 64");
+
+    static_assert(sizeof(ValueType) * BITS_IN_BYTE >= width,
+        "sizeof ValueType * BITS_IN_BYTE must be >= width");
+
+    const uint64_t minValue = static_cast<uint64_t>(1) << (width - 1);
+    return static_cast<ValueType>((getUbitsAt<width>(buf, bitOffset) ^ minValue) - minValue);
+}
+
+template<unsigned width, size_t bitOffset, typename ValueType, typename Word>
+inline ValueType getSbitsAt(const Word* buf) {
+    return getSbitsAt<width, ValueType>(buf, bitOffset);
+}
+
+/**
+ * Set the field of width bits starting at bit bitOffset of buf to value,
+ * truncated to width bits. Only the words the field covers are written; the
+ * bits around the field are preserved.
+ */
+template<unsigned width, typename Word, typename ValueType>
+inline void setBitsAt(Word* buf, size_t bitOffset, const ValueType value) {
+    static_assert(detail::IsUnsignedWord<Word>::value,
+        "Word must be an unsigned integer type");
+
+    static_assert(detail::IsFieldValue<ValueType>::value,
+        "ValueType must be an integer or enum type");
+
+    static_assert(width > 0 && width <= 64,
+        "width must be > 0 and <= 64");
+
+    detail::writeBitsAt(buf, bitOffset, width, static_cast<uint64_t>(value));
+}
+
+template<unsigned width, size_t bitOffset, typename Word, typename ValueType>
+inline void setBitsAt(Word* buf, const ValueType value) {
+    setBitsAt<width>(buf, bitOffset, value);
+}
+
+/**
+ * Bit order policies for Bytes. With LsbFirst bit k of a byte buffer is bit
+ * k % 8 of byte k / 8 and a field's least significant bit comes first, the
+ * order getUbitsAt uses. With MsbFirst bit k is bit 7 - k % 8 of byte k / 8
+ * and a field's most significant bit comes first, the order of RFC packet
+ * diagrams and big-endian bus signals.
+ */
+struct LsbFirst {};
+struct MsbFirst {};
+
+namespace detail {
+
+template<typename Order>
+struct OrderedBits;
+
+template<>
+struct OrderedBits<LsbFirst> {
+    static unsigned bitInByte(size_t pos) {
+        return static_cast<unsigned>(pos % BITS_IN_BYTE);
+    }
+
+    // Byte b holds field bits [shift, shift + 8); only the first byte has a
+    // negative shift.
+    static int byteShift(size_t bitOffset, unsigned, size_t b) {
+        return static_cast<int>(b * BITS_IN_BYTE - bitOffset);
+    }
+};
+
+template<>
+struct OrderedBits<MsbFirst> {
+    static unsigned bitInByte(size_t pos) {
+        return static_cast<unsigned>(BITS_IN_BYTE - 1 - pos % BITS_IN_BYTE);
+    }
+
+    // Byte b holds field bits [shift, shift + 8) where shift is the distance
+    // from the least significant bit of b to the end of the field; only the
+    // last byte has a negative shift.
+    static int byteShift(size_t bitOffset, unsigned width, size_t b) {
+        return static_cast<int>(bitOffset + width - (b + 1) * BITS_IN_BYTE);
+    }
+};
+
+/**
+ * Field access byte by byte. Only the bytes the field covers are touched;
+ * with a constant offset and width the loops unroll and compilers merge them
+ * into single loads and stores (with a byte swap for MsbFirst).
+ */
+template<typename Order>
+inline uint64_t readOrdered(const unsigned char* buf, size_t bitOffset, unsigned width) {
+    const uint64_t mask = ~static_cast<uint64_t>(0) >> (64 - width);
+    const size_t first = bitOffset / BITS_IN_BYTE;
+    const size_t last = (bitOffset + width - 1) / BITS_IN_BYTE;
+    uint64_t value = 0;
+    for (size_t b = first; b <= last; ++b) {
+        const int shift = OrderedBits<Order>::byteShift(bitOffset, width, b);
+        const uint64_t byte = buf[b];
+        value |= shift >= 0 ? byte << shift : byte >> -shift;
+    }
+    return value & mask;
+}
+
+template<typename Order>
+inline void writeOrdered(unsigned char* buf, size_t bitOffset, unsigned width, uint64_t value) {
+    const uint64_t mask = ~static_cast<uint64_t>(0) >> (64 - width);
+    const size_t first = bitOffset / BITS_IN_BYTE;
+    const size_t last = (bitOffset + width - 1) / BITS_IN_BYTE;
+    for (size_t b = first; b <= last; ++b) {
+        const int shift = OrderedBits<Order>::byteShift(bitOffset, width, b);
+        const unsigned byteMask = static_cast<unsigned char>(shift >= 0 ? mask >> shift : mask << -shift);
+        const unsigned byte = static_cast<unsigned char>(shift >= 0 ? value >> shift : value << -shift);
+        buf[b] = static_cast<unsigned char>((buf[b] & ~byteMask) | (byte & byteMask));
+    }
+}
+
+}
+
+/**
+ * The bit and field functions over byte buffers with bit positions numbered
+ * in Order. Positions and widths are template parameters in the first form of
+ * each function, so the byte indexes, shifts and masks are all constants. A
+ * run-time bit offset is also accepted. Fields are up to 64 bits wide.
+ *
+ *     // the 4-bit IPv4 IHL field, bits 4-7 of the RFC 791 diagram
+ *     unsigned ihl = bits::Msb0::getUbits<4, 4>(packet);
+ */
+template<typename Order>
+struct Bytes {
+    template<unsigned pos>
+    static bool getBit(const unsigned char* buf) {
+        return ((buf[pos / BITS_IN_BYTE] >> detail::OrderedBits<Order>::bitInByte(pos)) & 1) != 0;
+    }
+
+    template<unsigned pos>
+    static void setBit(unsigned char* buf, bool value) {
+        const unsigned bit = detail::OrderedBits<Order>::bitInByte(pos);
+        buf[pos / BITS_IN_BYTE] = static_cast<unsigned char>(
+            (buf[pos / BITS_IN_BYTE] & ~(1u << bit)) | (static_cast<unsigned>(value) << bit));
+    }
+
+    template<unsigned width, size_t bitOffset>
+    static uint64_t getUbits(const unsigned char* buf) {
+        return getUbits<width>(buf, bitOffset);
+    }
+
+    template<unsigned width>
+    static uint64_t getUbits(const unsigned char* buf, size_t bitOffset) {
+        static_assert(width > 0 && width <= 64,
+            "width must be > 0 and <= 64");
+
+        return detail::readOrdered<Order>(buf, bitOffset, width);
+    }
+
+    template<unsigned width, size_t bitOffset, typename ValueType>
+    static ValueType getSbits(const unsigned char* buf) {
+        return getSbits<width, ValueType>(buf, bitOffset);
+    }
+
+    template<unsigned width, typename ValueType>
+    static ValueType getSbits(const unsigned char* buf, size_t bitOffset) {
+        static_assert(detail::IsSignedValue<ValueType>::value,
+            "ValueType must be a signed integer type");
+
+        static_assert(width > 0 && width <= 64,
+            "width must be > 0 and <= 64");
+
+        static_assert(sizeof(ValueType) * BITS_IN_BYTE >= width,
+            "sizeof ValueType * BITS_IN_BYTE must be >= width");
+
+        const uint64_t minValue = static_cast<uint64_t>(1) << (width - 1);
+        return static_cast<ValueType>((getUbits<width>(buf, bitOffset) ^ minValue) - minValue);
+    }
+
+    template<unsigned width, size_t bitOffset, typename ValueType>
+    static void setBits(unsigned char* buf, const ValueType value) {
+        setBits<width>(buf, bitOffset, value);
+    }
+
+    template<unsigned width, typename ValueType>
+    static void setBits(unsigned char* buf, size_t bitOffset, const ValueType value) {
+        static_assert(detail::IsFieldValue<ValueType>::value,
+            "ValueType must be an integer or enum type");
+
+        static_assert(width > 0 && width <= 64,
+            "width must be > 0 and <= 64");
+
+        detail::writeOrdered<Order>(buf, bitOffset, width, static_cast<uint64_t>(value));
+    }
+};
+
+typedef Bytes<LsbFirst> Lsb0;
+typedef Bytes<MsbFirst> Msb0;
+
+#ifdef BITS_HAS_CXX11
+
+/**
+ * Access policies of a memory mapped register. ReadWrite registers are
+ * updated with one bus read and one bus write. WriteOnly registers can't be
+ * read back, so Register keeps a shadow copy of the last value written and
+ * updates cost one bus write. ReadOnly registers can't be written. In a
+ * WriteOneToClear register writing 1 to a bit clears it and writing 0 leaves
+ * it alone, so it is never read-modify-written: that would clear every bit
+ * that happened to be set.
+ */
+struct ReadWrite {};
+struct ReadOnly {};
+struct WriteOnly {};
+struct WriteOneToClear {};
+
+/**
+ * The bus access Register uses by default: a volatile load or store of the
+ * whole register. A test can substitute any type with the same read and
+ * write members, such as a simulated register that counts accesses.
+ */
+template<typename Word>
+class VolatilePort {
+public:
+    // implicit so a Register can be constructed from the register's address
+    VolatilePort(volatile Word* reg) : reg_(reg) {}
+
+    Word read() const { return *reg_; }
+
+    void write(Word word) const { *reg_ = word; }
+
+private:
+    volatile Word* reg_;
+};
+
+namespace detail {
+
+/**
+ * The union of the masks of Fields, each of which must be a field of L.
+ */
+template<typename L, typename... Fields>
+struct LayoutMask {
+    static constexpr typename L::WordType value = 0;
+};
+
+template<typename L, typename F, typename... Rest>
+struct LayoutMask<L, F, Rest...> {
+    static constexpr typename L::WordType value =
+        L::template fieldMask<F>() | LayoutMask<L, Rest...>::value;
+};
+
+template<typename L, typename... Fields>
+constexpr typename L::WordType LayoutMask<L, Fields...>::value;
+
+template<typename L, typename F, typename... Rest>
+constexpr typename L::WordType LayoutMask<L, F, Rest...>::value;
+
+}
+
+/**
+ * A memory mapped register holding the fields of the Layout L. Every member
+ * makes at most one bus read and one bus write, whatever the number of
+ * fields involved; members the Access policy doesn't allow fail to compile.
+ *
+ *     Register<Control> control(&UART0->CR);
+ *     control.set<Enable, BaudDivisor>(1, 26); // one read, one write
+ */
+template<typename L, typename Access = ReadWrite, typename Port = VolatilePort<typename L::WordType>>
+class Register {
+public:
+    typedef typename L::WordType WordType;
+
+    /**
+     * shadow is the value a WriteOnly register holds before the first write,
+     * normally its reset value; other policies ignore it.
+     */
+    explicit Register(Port port, WordType shadow = 0) : port_(port), shadow_(shadow) {}
+
+    /** The whole register: one bus read, or the shadow of a WriteOnly register. */
+    WordType read() const {
+        return std::is_same<Access, WriteOnly>::value ? shadow_ : port_.read();
+    }
+
+    template<typename F>
+    typename FieldValue<F, WordType>::type get() const {
+        return L::template get<F>(read());
+    }
+
+    /** Several fields from one bus read. */
+    template<typename... Fields>
+    std::tuple<typename FieldValue<Fields, WordType>::type...> getFields() const {
+        const WordType word = read();
+        return std::tuple<typename FieldValue<Fields, WordType>::type...>(
+            L::template get<Fields>(word)...);
+    }
+
+    /** Replace the whole register with one bus write. */
+    void write(WordType word) {
+        static_assert(!std::is_same<Access, ReadOnly>::value,
+            "a ReadOnly register can't be written");
+        shadow_ = word;
+        port_.write(word);
+    }
+
+    /**
+     * Write every field, in the order the fields are listed, with one bus
+     * write and no read. Unused bits are zero.
+     */
+    template<typename... Values>
+    void pack(const Values... values) {
+        write(L::pack(values...));
+    }
+
+    /**
+     * Set one or more fields, leaving the others alone: one bus read and one
+     * bus write, or just the write for a WriteOnly register or when the
+     * fields cover the whole register.
+     */
+    template<typename... SetFields, typename... Values>
+    void set(const Values... values) {
+        static_assert(!std::is_same<Access, WriteOneToClear>::value,
+            "a WriteOneToClear register must not be read-modify-written; use clear");
+        WordType word = detail::LayoutMask<L, SetFields...>::value
+            == static_cast<WordType>(~static_cast<WordType>(0)) ? 0 : read();
+        L::template set<SetFields...>(word, values...);
+        write(word);
+    }
+
+    /**
+     * Clear the fields Fields of a WriteOneToClear register by writing ones to
+     * them and zeros elsewhere: one bus write and no read.
+     */
+    template<typename... Fields>
+    void clear() {
+        static_assert(std::is_same<Access, WriteOneToClear>::value,
+            "clear is for WriteOneToClear registers; use set");
+        port_.write(detail::LayoutMask<L, Fields...>::value);
+    }
+
+    /**
+     * Read a WriteOneToClear register and clear exactly the bits of Fields
+     * that were set, so events arriving in between are not lost: one bus read
+     * and one bus write. Returns the value read.
+     */
+    template<typename... Fields>
+    WordType acknowledge() {
+        static_assert(std::is_same<Access, WriteOneToClear>::value,
+            "acknowledge is for WriteOneToClear registers");
+        const WordType word = port_.read();
+        port_.write(static_cast<WordType>(word & detail::LayoutMask<L, Fields...>::value));
+        return word;
+    }
+
+    Port& port() { return port_; }
+
+private:
+    Port port_;
+    WordType shadow_;
+};
+
+#endif
+
 }
 
 
@@ -0,0 +1,832 @@
+#ifndef BITS_BITSET_HPP
+#define BITS_BITSET_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * Bitset, a bitset whose size is set at run time, and FixedBitset<N>. Bit i
+  * is bit i % 64 of 64-bit word i / 64, the same numbering bits.hpp uses.
+  *
+  * Operations on whole sets run a word, or a SIMD vector of words, at a time.
+  * The kernels are chosen once, on first use, from the instruction sets the
+  * CPU supports: AVX-512 (with VPOPCNTDQ for counting), AVX2 or POPCNT. Fused
+  * operations such as andCount(a, b) combine and count in one pass without
+  * building the intermediate set.
+  *
+  * forEachSetBit, findNextSet, findNextClear and setBitIndexes scan the set
+  * bits of a bitset or of any array of 64-bit words.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+#include "cpu_features.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "bitset.hpp requires C++11"
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace bits {
+
+namespace detail {
+
+inline unsigned popcount64(uint64_t x) {
+#if defined(__POPCNT__) && (defined(__GNUC__) || defined(__clang__))
+    return static_cast<unsigned>(__builtin_popcountll(x));
+#else
+    // without POPCNT the builtin is a library call that is slower than this
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<unsigned>((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// The word-wise operations the kernels combine two sets with. First ignores
+// its second operand, for operations on a single set.
+struct OpFirst {
+    static uint64_t apply(uint64_t a, uint64_t) { return a; }
+#if defined(BITS_X86)
+    static BITS_TARGET("avx2") __m256i apply(__m256i a, __m256i) { return a; }
+    static BITS_TARGET("avx512f") __m512i apply(__m512i a, __m512i) { return a; }
+#endif
+};
+
+struct OpAnd {
+    static uint64_t apply(uint64_t a, uint64_t b) { return a & b; }
+#if defined(BITS_X86)
+    static BITS_TARGET("avx2") __m256i apply(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+    static BITS_TARGET("avx512f") __m512i apply(__m512i a, __m512i b) { return _mm512_and_si512(a, b); }
+#endif
+};
+
+struct OpOr {
+    static uint64_t apply(uint64_t a, uint64_t b) { return a | b; }
+#if defined(BITS_X86)
+    static BITS_TARGET("avx2") __m256i apply(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+    static BITS_TARGET("avx512f") __m512i apply(__m512i a, __m512i b) { return _mm512_or_si512(a, b); }
+#endif
+};
+
+struct OpXor {
+    static uint64_t apply(uint64_t a, uint64_t b) { return a ^ b; }
+#if defined(BITS_X86)
+    static BITS_TARGET("avx2") __m256i apply(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+    static BITS_TARGET("avx512f") __m512i apply(__m512i a, __m512i b) { return _mm512_xor_si512(a, b); }
+#endif
+};
+
+struct OpAndNot {
+    static uint64_t apply(uint64_t a, uint64_t b) { return a & ~b; }
+#if defined(BITS_X86)
+    static BITS_TARGET("avx2") __m256i apply(__m256i a, __m256i b) { return _mm256_andnot_si256(b, a); }
+    // a & ~b as one ternary logic op (0xF0 & ~0xCC); GCC 12's andnot
+    // intrinsic warns about the undefined vector it passes its builtin
+    static BITS_TARGET("avx512f") __m512i apply(__m512i a, __m512i b) { return _mm512_ternarylogic_epi64(a, b, b, 0x30); }
+#endif
+};
+
+template<typename Op>
+void combinePortable(uint64_t* dest, const uint64_t* a, const uint64_t* b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dest[i] = Op::apply(a[i], b[i]);
+    }
+}
+
+template<typename Op>
+size_t countPortable(const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        count += popcount64(Op::apply(a[i], b[i]));
+    }
+    return count;
+}
+
+template<typename Op>
+bool anyPortable(const uint64_t* a, const uint64_t* b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (Op::apply(a[i], b[i]) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#if defined(BITS_X86)
+
+template<typename Op>
+BITS_TARGET("popcnt") size_t countPopcnt(const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        count += static_cast<size_t>(_mm_popcnt_u64(Op::apply(a[i], b[i])));
+    }
+    return count;
+}
+
+template<typename Op>
+BITS_TARGET("avx2") void combineAvx2(uint64_t* dest, const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), Op::apply(va, vb));
+    }
+    combinePortable<Op>(dest + i, a + i, b + i, n - i);
+}
+
+/**
+ * The population count of each 64-bit lane: a nibble lookup with PSHUFB,
+ * summed per lane by PSADBW.
+ */
+inline BITS_TARGET("avx2") __m256i popcountLanesAvx2(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble));
+    const __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    return _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256());
+}
+
+template<typename Op>
+BITS_TARGET("avx2,popcnt") size_t countAvx2(const uint64_t* a, const uint64_t* b, size_t n) {
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        total = _mm256_add_epi64(total, popcountLanesAvx2(Op::apply(va, vb)));
+    }
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+    return static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3])
+        + countPopcnt<Op>(a + i, b + i, n - i);
+}
+
+template<typename Op>
+BITS_TARGET("avx2") bool anyAvx2(const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t i = 0;
+    // test 16 words at a time so the early exit doesn't limit throughput
+    for (; i + 16 <= n; i += 16) {
+        __m256i v = _mm256_setzero_si256();
+        for (size_t j = 0; j < 16; j += 4) {
+            const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + j));
+            const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + j));
+            v = _mm256_or_si256(v, Op::apply(va, vb));
+        }
+        if (!_mm256_testz_si256(v, v)) {
+            return true;
+        }
+    }
+    return anyPortable<Op>(a + i, b + i, n - i);
+}
+
+template<typename Op>
+BITS_TARGET("avx512f") void combineAvx512(uint64_t* dest, const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_si512(dest + i, Op::apply(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+    }
+    combinePortable<Op>(dest + i, a + i, b + i, n - i);
+}
+
+/**
+ * The sum of the 64-bit lanes of v. Reduced through memory, as GCC 12's
+ * _mm512_reduce_add_epi64 and _mm512_extracti64x4_epi64 pass an undefined
+ * vector to their builtins and warn about it being uninitialized.
+ */
+BITS_TARGET("avx512f") inline uint64_t addLanesAvx512(__m512i v) {
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+}
+
+template<typename Op>
+BITS_TARGET("avx512f,avx512vpopcntdq,popcnt") size_t countAvx512(const uint64_t* a, const uint64_t* b, size_t n) {
+    __m512i total = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512i v = Op::apply(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(v));
+    }
+    return static_cast<size_t>(addLanesAvx512(total))
+        + countPopcnt<Op>(a + i, b + i, n - i);
+}
+
+template<typename Op>
+BITS_TARGET("avx512f") bool anyAvx512(const uint64_t* a, const uint64_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512i v = _mm512_setzero_si512();
+        for (size_t j = 0; j < 32; j += 8) {
+            v = _mm512_or_si512(v, Op::apply(_mm512_loadu_si512(a + i + j), _mm512_loadu_si512(b + i + j)));
+        }
+        if (_mm512_test_epi64_mask(v, v) != 0) {
+            return true;
+        }
+    }
+    return anyPortable<Op>(a + i, b + i, n - i);
+}
+
+#endif
+
+/**
+ * The kernels for Op, picked once from the CPU's features.
+ */
+template<typename Op>
+struct BitsetKernels {
+    typedef void (*CombineFn)(uint64_t*, const uint64_t*, const uint64_t*, size_t);
+    typedef size_t (*CountFn)(const uint64_t*, const uint64_t*, size_t);
+    typedef bool (*AnyFn)(const uint64_t*, const uint64_t*, size_t);
+
+    static CombineFn combine() {
+        static const CombineFn fn = selectCombine();
+        return fn;
+    }
+
+    static CountFn count() {
+        static const CountFn fn = selectCount();
+        return fn;
+    }
+
+    static AnyFn any() {
+        static const AnyFn fn = selectAny();
+        return fn;
+    }
+
+private:
+    static CombineFn selectCombine() {
+#if defined(BITS_X86)
+        const CpuFeatures& cpu = cpuFeatures();
+        if (cpu.avx512f) {
+            return &combineAvx512<Op>;
+        }
+        if (cpu.avx2) {
+            return &combineAvx2<Op>;
+        }
+#endif
+        return &combinePortable<Op>;
+    }
+
+    static CountFn selectCount() {
+#if defined(BITS_X86)
+        const CpuFeatures& cpu = cpuFeatures();
+        if (cpu.avx512f && cpu.avx512vpopcntdq && cpu.popcnt) {
+            return &countAvx512<Op>;
+        }
+        if (cpu.avx2 && cpu.popcnt) {
+            return &countAvx2<Op>;
+        }
+        if (cpu.popcnt) {
+            return &countPopcnt<Op>;
+        }
+#endif
+        return &countPortable<Op>;
+    }
+
+    static AnyFn selectAny() {
+#if defined(BITS_X86)
+        const CpuFeatures& cpu = cpuFeatures();
+        if (cpu.avx512f) {
+            return &anyAvx512<Op>;
+        }
+        if (cpu.avx2) {
+            return &anyAvx2<Op>;
+        }
+#endif
+        return &anyPortable<Op>;
+    }
+};
+
+// Below this many words the call through a kernel pointer costs more than
+// it saves, so the portable loops run inline.
+constexpr size_t BITSET_KERNEL_WORDS = 16;
+
+template<typename Op>
+void combineWords(uint64_t* dest, const uint64_t* a, const uint64_t* b, size_t n) {
+    if (n < BITSET_KERNEL_WORDS) {
+        combinePortable<Op>(dest, a, b, n);
+    } else {
+        BitsetKernels<Op>::combine()(dest, a, b, n);
+    }
+}
+
+template<typename Op>
+size_t countWords(const uint64_t* a, const uint64_t* b, size_t n) {
+    return n < BITSET_KERNEL_WORDS ? countPortable<Op>(a, b, n)
+        : BitsetKernels<Op>::count()(a, b, n);
+}
+
+template<typename Op>
+bool anyWords(const uint64_t* a, const uint64_t* b, size_t n) {
+    return n < BITSET_KERNEL_WORDS ? anyPortable<Op>(a, b, n)
+        : BitsetKernels<Op>::any()(a, b, n);
+}
+
+constexpr size_t bitsetWords(size_t bits) {
+    return (bits + 63) / 64;
+}
+
+// The bits of the last word that are inside a set of size bits.
+constexpr uint64_t lastWordMask(size_t bits) {
+    return bits % 64 == 0 ? ~static_cast<uint64_t>(0)
+        : (static_cast<uint64_t>(1) << (bits % 64)) - 1;
+}
+
+inline unsigned countTrailingZeros64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<unsigned>(index);
+#else
+    return popcount64((x & (0 - x)) - 1);
+#endif
+}
+
+/**
+ * The positions of the set bits of each byte value, used to write eight
+ * indexes at a time.
+ */
+struct ByteSetBits {
+    unsigned char positions[256][8];
+    unsigned char counts[256];
+
+    ByteSetBits() {
+        for (unsigned b = 0; b < 256; ++b) {
+            unsigned count = 0;
+            for (unsigned bit = 0; bit < 8; ++bit) {
+                positions[b][bit] = 0;
+            }
+            for (unsigned bit = 0; bit < 8; ++bit) {
+                if (b & (1u << bit)) {
+                    positions[b][count++] = static_cast<unsigned char>(bit);
+                }
+            }
+            counts[b] = static_cast<unsigned char>(count);
+        }
+    }
+};
+
+inline const ByteSetBits& byteSetBits() {
+    static const ByteSetBits table;
+    return table;
+}
+
+inline uint32_t* setBitIndexesOfWord(uint64_t word, uint32_t base, uint32_t* out) {
+    while (word != 0) {
+        *out++ = base + countTrailingZeros64(word);
+        word &= word - 1;
+    }
+    return out;
+}
+
+// The decoders write whole vectors, up to 64 indexes past the current
+// position for each word, so they only take the vector path while there is
+// that much room before end, the end of the output.
+
+inline void setBitIndexesPortable(const uint64_t* words, size_t n, uint32_t* out, uint32_t*) {
+    for (size_t i = 0; i < n; ++i) {
+        out = setBitIndexesOfWord(words[i], static_cast<uint32_t>(i * 64), out);
+    }
+}
+
+#if defined(BITS_X86)
+
+// Words with this few set bits are decoded faster by the scalar loop.
+constexpr int SPARSE_WORD_BITS = 4;
+
+inline BITS_TARGET("avx2,popcnt") void setBitIndexesAvx2(const uint64_t* words, size_t n, uint32_t* out, uint32_t* end) {
+    const ByteSetBits& table = byteSetBits();
+    const __m256i eight = _mm256_set1_epi32(8);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t word = words[i];
+        if (word == 0) {
+            continue;
+        }
+        if (end - out < 64 || _mm_popcnt_u64(word) <= SPARSE_WORD_BITS) {
+            out = setBitIndexesOfWord(word, static_cast<uint32_t>(i * 64), out);
+            continue;
+        }
+        __m256i base = _mm256_set1_epi32(static_cast<int>(i * 64));
+        for (unsigned b = 0; b < 8; ++b, word >>= 8) {
+            const unsigned byte = static_cast<unsigned>(word & 0xFF);
+            const __m128i positions = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(table.positions[byte]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                _mm256_add_epi32(base, _mm256_cvtepu8_epi32(positions)));
+            out += table.counts[byte];
+            base = _mm256_add_epi32(base, eight);
+        }
+    }
+}
+
+inline BITS_TARGET("avx512f,popcnt") void setBitIndexesAvx512(const uint64_t* words, size_t n, uint32_t* out, uint32_t* end) {
+    const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i sixteen = _mm512_set1_epi32(16);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t word = words[i];
+        if (word == 0) {
+            continue;
+        }
+        if (end - out < 64 || _mm_popcnt_u64(word) <= SPARSE_WORD_BITS) {
+            out = setBitIndexesOfWord(word, static_cast<uint32_t>(i * 64), out);
+            continue;
+        }
+        __m512i indexes = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(i * 64)), lanes);
+        for (unsigned chunk = 0; chunk < 4; ++chunk, word >>= 16) {
+            const __mmask16 mask = static_cast<__mmask16>(word);
+            _mm512_storeu_si512(out, _mm512_maskz_compress_epi32(mask, indexes));
+            out += _mm_popcnt_u32(mask);
+            indexes = _mm512_add_epi32(indexes, sixteen);
+        }
+    }
+}
+
+#endif
+
+typedef void (*SetBitIndexesFn)(const uint64_t*, size_t, uint32_t*, uint32_t*);
+
+inline SetBitIndexesFn selectSetBitIndexes() {
+#if defined(BITS_X86)
+    const CpuFeatures& cpu = cpuFeatures();
+    if (cpu.avx512f && cpu.popcnt) {
+        return &setBitIndexesAvx512;
+    }
+    if (cpu.avx2 && cpu.popcnt) {
+        return &setBitIndexesAvx2;
+    }
+#endif
+    return &setBitIndexesPortable;
+}
+
+}
+
+/**
+ * Call fn(pos) for each set bit of word, lowest first: one TZCNT and one
+ * BLSR (clear lowest set bit) per set bit, whatever the number of clear bits.
+ */
+template<typename Fn>
+void forEachSetBit(uint64_t word, Fn fn) {
+    while (word != 0) {
+        fn(detail::countTrailingZeros64(word));
+        word &= word - 1;
+    }
+}
+
+/**
+ * Call fn(index) for each set bit of the n words at words, where bit i is
+ * bit i % 64 of word i / 64. Zero words cost one test each.
+ */
+template<typename Fn>
+void forEachSetBit(const uint64_t* words, size_t n, Fn fn) {
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t word = words[i];
+        while (word != 0) {
+            fn(i * 64 + detail::countTrailingZeros64(word));
+            word &= word - 1;
+        }
+    }
+}
+
+namespace detail {
+
+/**
+ * The first set bit, or clear bit when Clear, at or after from in the first
+ * size bits of the n words at words, or size. Bitsets pass their own word
+ * count so GCC can bound the reads without knowing size.
+ */
+template<bool Clear>
+inline size_t findNextBit(const uint64_t* words, size_t n, size_t size, size_t from) {
+    if (from >= size) {
+        return size;
+    }
+    uint64_t mask = ~static_cast<uint64_t>(0) << (from % 64);
+    for (size_t i = from / 64; i < n; ++i) {
+        const uint64_t word = (Clear ? ~words[i] : words[i]) & mask;
+        if (word != 0) {
+            const size_t found = i * 64 + countTrailingZeros64(word);
+            return found < size ? found : size;
+        }
+        mask = ~static_cast<uint64_t>(0);
+    }
+    return size;
+}
+
+}
+
+/**
+ * The index of the first set bit at or after from in the first size bits of
+ * words, or size if there is none.
+ */
+inline size_t findNextSet(const uint64_t* words, size_t size, size_t from) {
+    return detail::findNextBit<false>(words, detail::bitsetWords(size), size, from);
+}
+
+/**
+ * The index of the first clear bit at or after from in the first size bits
+ * of words, or size if there is none.
+ */
+inline size_t findNextClear(const uint64_t* words, size_t size, size_t from) {
+    return detail::findNextBit<true>(words, detail::bitsetWords(size), size, from);
+}
+
+/**
+ * Write the index of each set bit of the n words at words to out, in
+ * increasing order, and return how many were written. out needs room for
+ * one index per set bit and nothing more. Indexes are 32 bits, so n * 64
+ * must not exceed 2^32.
+ *
+ * The set bits are counted first, then decoded a byte at a time through a
+ * lookup table with AVX2, or 16 bits at a time with AVX-512 VPCOMPRESSD.
+ */
+inline size_t setBitIndexes(const uint64_t* words, size_t n, uint32_t* out) {
+    static const detail::SetBitIndexesFn kernel = detail::selectSetBitIndexes();
+    const size_t count = detail::countWords<detail::OpFirst>(words, words, n);
+    kernel(words, n, out, out + count);
+    return count;
+}
+
+namespace detail {
+
+/**
+ * The members Bitset and FixedBitset share, over the words returned by
+ * Derived's words() and wordCount(). Bits past size() are always zero, so
+ * whole-word operations never see them.
+ */
+template<typename Derived>
+class BitsetBase {
+public:
+    bool test(size_t i) const {
+        return ((words()[i / 64] >> (i % 64)) & 1) != 0;
+    }
+
+    bool operator[](size_t i) const { return test(i); }
+
+    Derived& set(size_t i) {
+        words()[i / 64] |= static_cast<uint64_t>(1) << (i % 64);
+        return self();
+    }
+
+    Derived& set(size_t i, bool value) {
+        uint64_t& word = words()[i / 64];
+        word = (word & ~(static_cast<uint64_t>(1) << (i % 64)))
+            | (static_cast<uint64_t>(value) << (i % 64));
+        return self();
+    }
+
+    Derived& reset(size_t i) {
+        words()[i / 64] &= ~(static_cast<uint64_t>(1) << (i % 64));
+        return self();
+    }
+
+    Derived& flip(size_t i) {
+        words()[i / 64] ^= static_cast<uint64_t>(1) << (i % 64);
+        return self();
+    }
+
+    /** Set every bit. */
+    Derived& set() {
+        const size_t n = wordCount();
+        if (n != 0) {
+            memset(words(), 0xFF, n * sizeof(uint64_t));
+            words()[n - 1] = lastWordMask(self().size());
+        }
+        return self();
+    }
+
+    /** Clear every bit. */
+    Derived& reset() {
+        memset(words(), 0, wordCount() * sizeof(uint64_t));
+        return self();
+    }
+
+    /** Flip every bit. */
+    Derived& flip() {
+        const size_t n = wordCount();
+        for (size_t i = 0; i < n; ++i) {
+            words()[i] = ~words()[i];
+        }
+        if (n != 0) {
+            words()[n - 1] &= lastWordMask(self().size());
+        }
+        return self();
+    }
+
+    /** The index of the first set bit, or size() if there is none. */
+    size_t findFirst() const {
+        return findNextBit<false>(words(), wordCount(), self().size(), 0);
+    }
+
+    /** The index of the first set bit at or after from, or size(). */
+    size_t findNext(size_t from) const {
+        return findNextBit<false>(words(), wordCount(), self().size(), from);
+    }
+
+    /** The index of the first clear bit at or after from, or size(). */
+    size_t findNextClear(size_t from) const {
+        return findNextBit<true>(words(), wordCount(), self().size(), from);
+    }
+
+    /** Call fn(index) for each set bit, in increasing order. */
+    template<typename Fn>
+    void forEachSetBit(Fn fn) const {
+        bits::forEachSetBit(words(), wordCount(), fn);
+    }
+
+    /**
+     * Write the index of each set bit to out, which needs room for count()
+     * indexes, and return how many were written.
+     */
+    size_t setBitIndexes(uint32_t* out) const {
+        return bits::setBitIndexes(words(), wordCount(), out);
+    }
+
+    /** The number of set bits. */
+    size_t count() const {
+        return countWords<OpFirst>(words(), words(), wordCount());
+    }
+
+    bool any() const {
+        return anyWords<OpFirst>(words(), words(), wordCount());
+    }
+
+    bool none() const { return !any(); }
+
+    bool all() const { return count() == self().size(); }
+
+    // The operands of the operators below must be the same size.
+
+    Derived& operator&=(const Derived& other) {
+        combineWords<OpAnd>(words(), words(), other.words(), wordCount());
+        return self();
+    }
+
+    Derived& operator|=(const Derived& other) {
+        combineWords<OpOr>(words(), words(), other.words(), wordCount());
+        return self();
+    }
+
+    Derived& operator^=(const Derived& other) {
+        combineWords<OpXor>(words(), words(), other.words(), wordCount());
+        return self();
+    }
+
+    /** Clear the bits that are set in other. */
+    Derived& andNot(const Derived& other) {
+        combineWords<OpAndNot>(words(), words(), other.words(), wordCount());
+        return self();
+    }
+
+    // a is returned by name rather than through the reference the compound
+    // assignment returns, so it is moved instead of copied
+    friend Derived operator&(Derived a, const Derived& b) {
+        a &= b;
+        return a;
+    }
+
+    friend Derived operator|(Derived a, const Derived& b) {
+        a |= b;
+        return a;
+    }
+
+    friend Derived operator^(Derived a, const Derived& b) {
+        a ^= b;
+        return a;
+    }
+
+    friend bool operator==(const Derived& a, const Derived& b) {
+        return a.size() == b.size()
+            && !anyWords<OpXor>(a.words(), b.words(), a.wordCount());
+    }
+
+    friend bool operator!=(const Derived& a, const Derived& b) { return !(a == b); }
+
+    /** |a & b|, without building a & b. */
+    friend size_t andCount(const Derived& a, const Derived& b) {
+        return countWords<OpAnd>(a.words(), b.words(), a.wordCount());
+    }
+
+    /** |a | b|, without building a | b. */
+    friend size_t orCount(const Derived& a, const Derived& b) {
+        return countWords<OpOr>(a.words(), b.words(), a.wordCount());
+    }
+
+    /** |a ^ b|, the Hamming distance, without building a ^ b. */
+    friend size_t xorCount(const Derived& a, const Derived& b) {
+        return countWords<OpXor>(a.words(), b.words(), a.wordCount());
+    }
+
+    /** |a & ~b|, without building a & ~b. */
+    friend size_t andNotCount(const Derived& a, const Derived& b) {
+        return countWords<OpAndNot>(a.words(), b.words(), a.wordCount());
+    }
+
+    /** Whether a and b have a bit in common; stops at the first one. */
+    friend bool intersects(const Derived& a, const Derived& b) {
+        return anyWords<OpAnd>(a.words(), b.words(), a.wordCount());
+    }
+
+private:
+    Derived& self() { return static_cast<Derived&>(*this); }
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+    uint64_t* words() { return self().data(); }
+    const uint64_t* words() const { return self().data(); }
+    size_t wordCount() const { return self().wordCount(); }
+};
+
+}
+
+/**
+ * A set of bits whose size is chosen at run time.
+ */
+class Bitset : public detail::BitsetBase<Bitset> {
+public:
+    Bitset() : size_(0) {}
+
+    explicit Bitset(size_t size, bool value = false)
+        : size_(size), words_(detail::bitsetWords(size), 0) {
+        if (value) {
+            set();
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    size_t wordCount() const { return words_.size(); }
+
+    /** The words holding the bits; bits past size() are zero. */
+    uint64_t* data() { return words_.data(); }
+    const uint64_t* data() const { return words_.data(); }
+
+    /** Change the size; new bits are value. */
+    void resize(size_t size, bool value = false) {
+        const size_t oldSize = size_;
+        words_.resize(detail::bitsetWords(size), value ? ~static_cast<uint64_t>(0) : 0);
+        size_ = size;
+        if (value && oldSize < size && oldSize % 64 != 0) {
+            words_[oldSize / 64] |= ~detail::lastWordMask(oldSize);
+        }
+        if (!words_.empty()) {
+            // keep the bits past the end zero
+            words_.back() &= detail::lastWordMask(size);
+        }
+    }
+
+private:
+    size_t size_;
+    std::vector<uint64_t> words_;
+};
+
+/**
+ * A set of N bits stored inline. Small sets use inline loops; sets of
+ * BITSET_KERNEL_WORDS words or more use the same kernels as Bitset.
+ */
+template<size_t N>
+class FixedBitset : public detail::BitsetBase<FixedBitset<N>> {
+public:
+    static constexpr size_t WORDS = detail::bitsetWords(N);
+
+    FixedBitset() : words_() {}
+
+    static constexpr size_t size() { return N; }
+
+    static constexpr size_t wordCount() { return WORDS; }
+
+    uint64_t* data() { return words_.data(); }
+    const uint64_t* data() const { return words_.data(); }
+
+private:
+    std::array<uint64_t, WORDS> words_;
+};
+
+template<size_t N>
+constexpr size_t FixedBitset<N>::WORDS;
+
+}
+
+#endif
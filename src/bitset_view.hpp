@@ -0,0 +1,308 @@
+#ifndef BITS_BITSET_VIEW_HPP
+#define BITS_BITSET_VIEW_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+ /**
+  * BitsetView, a read-only bitset queried in place in a serialized buffer,
+  * usually a memory-mapped file, so opening a large index costs page faults
+  * rather than parsing.
+  *
+  * The format is a 64-byte header followed by the arrays of a
+  * RankSelectBitVector: the bits, the rank entries, the counts per 2^32
+  * bits and the select samples. Integers are little-endian, and each array
+  * starts at a multiple of 64 bytes from the start of the buffer, so a
+  * page-aligned mapping gives cache-line aligned arrays. The header's
+  * version changes whenever the layout does, and parse rejects versions it
+  * does not know.
+  *
+  *     std::ofstream out("index.bits", std::ios::binary);
+  *     BitsetView::write(RankSelectBitVector(bits), out);
+  *     ...
+  *     const void* data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  *     BitsetView view;
+  *     if (BitsetView::parse(data, bytes, view)) { ... view.rank1(i) ... }
+  *
+  * Requires C++11 and a little-endian CPU to write or query the format.
+  */
+
+#include "bits.hpp"
+#include "bitset.hpp"
+#include "rank_select.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "bitset_view.hpp requires C++11"
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+namespace bits {
+
+/** The layout version BitsetView::write produces and parse accepts. */
+constexpr uint32_t BITSET_FILE_VERSION = 1;
+
+namespace detail {
+
+constexpr size_t BITSET_FILE_ALIGNMENT = 64;
+
+constexpr unsigned char BITSET_FILE_MAGIC[8] = { 'B', 'I', 'T', 'S', 'E', 'T', '\r', '\n' };
+
+/** The header at the start of the format; offsets are from the start of the buffer. */
+struct BitsetFileHeader {
+    unsigned char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint64_t size;
+    uint64_t count;
+    uint64_t wordsOffset;
+    uint64_t entriesOffset;
+    uint64_t upperOffset;
+    uint64_t samplesOffset;
+};
+
+static_assert(sizeof(BitsetFileHeader) == BITSET_FILE_ALIGNMENT,
+    "BitsetFileHeader must fill one 64-byte line");
+
+inline uint64_t alignFileOffset(uint64_t offset) {
+    return (offset + BITSET_FILE_ALIGNMENT - 1) / BITSET_FILE_ALIGNMENT * BITSET_FILE_ALIGNMENT;
+}
+
+/** Fill in the header for the arrays a, whose pointers are not read, and return the total bytes. */
+inline uint64_t bitsetFileLayout(const RankSelectBitVector::Arrays& a, BitsetFileHeader& header) {
+    memcpy(header.magic, BITSET_FILE_MAGIC, sizeof(header.magic));
+    header.version = BITSET_FILE_VERSION;
+    header.headerBytes = sizeof(BitsetFileHeader);
+    header.size = a.size;
+    header.count = a.count;
+    header.wordsOffset = sizeof(BitsetFileHeader);
+    header.entriesOffset = alignFileOffset(header.wordsOffset + a.wordCount() * sizeof(uint64_t));
+    header.upperOffset = alignFileOffset(header.entriesOffset + a.entryCount() * sizeof(uint64_t));
+    header.samplesOffset = alignFileOffset(header.upperOffset + a.upperCount() * sizeof(uint64_t));
+    return alignFileOffset(header.samplesOffset + a.selectSampleCount() * sizeof(uint32_t));
+}
+
+}
+
+/**
+ * A bitset with its rank/select index, read in place from the format
+ * described above. The view does not own the buffer, which must outlive it.
+ */
+class BitsetView {
+public:
+    BitsetView() : arrays_() {}
+
+    /** The bytes write produces for index. */
+    static size_t bytes(const RankSelectBitVector& index) {
+        detail::BitsetFileHeader header;
+        return static_cast<size_t>(detail::bitsetFileLayout(index.arrays(), header));
+    }
+
+    /**
+     * Serialize index to data. Returns false, writing nothing, if size is
+     * less than bytes(index) or the CPU is not little-endian.
+     */
+    static bool write(const RankSelectBitVector& index, void* data, size_t size) {
+#if defined(BITS_LITTLE_ENDIAN)
+        const RankSelectBitVector::Arrays a = index.arrays();
+        detail::BitsetFileHeader header;
+        const uint64_t total = detail::bitsetFileLayout(a, header);
+        if (size < total) {
+            return false;
+        }
+        unsigned char* const out = static_cast<unsigned char*>(data);
+        memset(out, 0, static_cast<size_t>(total));
+        memcpy(out, &header, sizeof(header));
+        memcpy(out + header.wordsOffset, a.words, a.wordCount() * sizeof(uint64_t));
+        memcpy(out + header.entriesOffset, a.entries, a.entryCount() * sizeof(uint64_t));
+        memcpy(out + header.upperOffset, a.upper, a.upperCount() * sizeof(uint64_t));
+        memcpy(out + header.samplesOffset, a.selectSamples, a.selectSampleCount() * sizeof(uint32_t));
+        return true;
+#else
+        (void)index;
+        (void)data;
+        (void)size;
+        return false;
+#endif
+    }
+
+    /**
+     * Serialize index to out, for writing a file without holding a second
+     * copy in memory. Returns false if the CPU is not little-endian or out
+     * failed.
+     */
+    static bool write(const RankSelectBitVector& index, std::ostream& out) {
+#if defined(BITS_LITTLE_ENDIAN)
+        const RankSelectBitVector::Arrays a = index.arrays();
+        detail::BitsetFileHeader header;
+        const uint64_t total = detail::bitsetFileLayout(a, header);
+        uint64_t written = 0;
+        const char* const arrays[] = {
+            reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(a.words),
+            reinterpret_cast<const char*>(a.entries), reinterpret_cast<const char*>(a.upper),
+            reinterpret_cast<const char*>(a.selectSamples) };
+        const uint64_t offsets[] = { 0, header.wordsOffset, header.entriesOffset,
+            header.upperOffset, header.samplesOffset, total };
+        const size_t lengths[] = { sizeof(header), a.wordCount() * sizeof(uint64_t),
+            a.entryCount() * sizeof(uint64_t), a.upperCount() * sizeof(uint64_t),
+            a.selectSampleCount() * sizeof(uint32_t) };
+        static const char zeros[detail::BITSET_FILE_ALIGNMENT] = {};
+        for (unsigned i = 0; i < 5; ++i) {
+            out.write(arrays[i], static_cast<std::streamsize>(lengths[i]));
+            written = offsets[i] + lengths[i];
+            // pad to the next array
+            out.write(zeros, static_cast<std::streamsize>(offsets[i + 1] - written));
+        }
+        return static_cast<bool>(out);
+#else
+        (void)index;
+        (void)out;
+        return false;
+#endif
+    }
+
+    /**
+     * Point out at the bitset serialized in data[0, size). Returns false if
+     * the header is not one write produces (wrong magic or unknown version),
+     * the arrays do not fit in size bytes, data is not 8-byte aligned or the
+     * CPU is not little-endian. Only the header is read; the arrays are
+     * touched by the queries.
+     */
+    static bool parse(const void* data, size_t size, BitsetView& out) {
+#if defined(BITS_LITTLE_ENDIAN)
+        if (data == nullptr || size < sizeof(detail::BitsetFileHeader)
+                || reinterpret_cast<uintptr_t>(data) % sizeof(uint64_t) != 0) {
+            return false;
+        }
+        detail::BitsetFileHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, detail::BITSET_FILE_MAGIC, sizeof(header.magic)) != 0
+                || header.version != BITSET_FILE_VERSION
+                || header.headerBytes != sizeof(header)
+                || header.count > header.size
+                || header.size > static_cast<uint64_t>(~static_cast<size_t>(0)) / 2) {
+            return false;
+        }
+        RankSelectBitVector::Arrays a = RankSelectBitVector::Arrays();
+        a.size = static_cast<size_t>(header.size);
+        a.count = static_cast<size_t>(header.count);
+        detail::BitsetFileHeader expected;
+        if (detail::bitsetFileLayout(a, expected) > size
+                || memcmp(&header, &expected, sizeof(header)) != 0) {
+            return false;
+        }
+        const unsigned char* const bytes = static_cast<const unsigned char*>(data);
+        a.words = reinterpret_cast<const uint64_t*>(bytes + header.wordsOffset);
+        a.entries = reinterpret_cast<const uint64_t*>(bytes + header.entriesOffset);
+        a.upper = reinterpret_cast<const uint64_t*>(bytes + header.upperOffset);
+        a.selectSamples = reinterpret_cast<const uint32_t*>(bytes + header.samplesOffset);
+        out.arrays_ = a;
+        return true;
+#else
+        (void)data;
+        (void)size;
+        (void)out;
+        return false;
+#endif
+    }
+
+    size_t size() const { return arrays_.size; }
+
+    /** The number of ones, stored in the header. */
+    size_t count() const { return arrays_.count; }
+
+    /** The words holding the first size() bits; bits past size() are zero. */
+    const uint64_t* data() const { return arrays_.words; }
+
+    size_t wordCount() const { return detail::bitsetWords(arrays_.size); }
+
+    bool test(size_t i) const {
+        return ((arrays_.words[i / 64] >> (i % 64)) & 1) != 0;
+    }
+
+    bool operator[](size_t i) const { return test(i); }
+
+    /** The ones in [0, i), for i <= size(). */
+    size_t rank1(size_t i) const { return RankSelectBitVector::rank1(arrays_, i); }
+
+    /** The zeros in [0, i), for i <= size(). */
+    size_t rank0(size_t i) const { return i - rank1(i); }
+
+    /** The position of the one with rank k (0-based), for k < count(). */
+    size_t select1(size_t k) const { return RankSelectBitVector::select1(arrays_, k); }
+
+    /** The first set bit at or after from, or size() if there is none. */
+    size_t findNext(size_t from) const { return findNextSet(arrays_.words, arrays_.size, from); }
+
+    template<typename Fn>
+    void forEachSetBit(Fn fn) const { bits::forEachSetBit(arrays_.words, wordCount(), fn); }
+
+    /** Write the indexes of the set bits to out, which needs room for count(). */
+    size_t setBitIndexes(uint32_t* out) const {
+        return bits::setBitIndexes(arrays_.words, wordCount(), out);
+    }
+
+    /** Copy the bits into a Bitset. */
+    Bitset toBitset() const {
+        Bitset bits(arrays_.size);
+        std::copy(arrays_.words, arrays_.words + wordCount(), bits.data());
+        return bits;
+    }
+
+    // The Bitset operands below must be the same size as the view.
+
+    friend Bitset& operator&=(Bitset& a, const BitsetView& b) {
+        detail::combineWords<detail::OpAnd>(a.data(), a.data(), b.data(), a.wordCount());
+        return a;
+    }
+
+    friend Bitset& operator|=(Bitset& a, const BitsetView& b) {
+        detail::combineWords<detail::OpOr>(a.data(), a.data(), b.data(), a.wordCount());
+        return a;
+    }
+
+    /** Clear the bits of a that are set in b. */
+    friend Bitset& andNot(Bitset& a, const BitsetView& b) {
+        detail::combineWords<detail::OpAndNot>(a.data(), a.data(), b.data(), a.wordCount());
+        return a;
+    }
+
+    /** |a & b|, without building a & b. */
+    friend size_t andCount(const BitsetView& a, const Bitset& b) {
+        return detail::countWords<detail::OpAnd>(a.data(), b.data(), b.wordCount());
+    }
+
+    /** |a | b|, without building a | b. */
+    friend size_t orCount(const BitsetView& a, const Bitset& b) {
+        return detail::countWords<detail::OpOr>(a.data(), b.data(), b.wordCount());
+    }
+
+private:
+    RankSelectBitVector::Arrays arrays_;
+};
+
+}
+
+#endif
@@ -0,0 +1,489 @@
+#ifndef BITS_BLOOM_HPP
+#define BITS_BLOOM_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+ /**
+  * Bloom filters that keep each key's bits close together so a lookup
+  * touches one cache line or one word instead of k scattered bits.
+  *
+  * BlockedBloomFilter splits the filter into 512-bit blocks, one cache line
+  * each. A key picks a block and sets one bit in each of the block's eight
+  * words, the bit chosen by multiplying the key's hash by a per-word odd
+  * constant (the split block layout). With AVX2 the eight bit positions are
+  * computed and tested with a handful of vector instructions.
+  *
+  * RegisterBloomFilter goes further and puts all k bits of a key in one
+  * 64-bit word, trading a higher false positive rate for a single load; with
+  * AVX2 four keys are hashed and probed at once through a gather.
+  *
+  * Keys are 64-bit integers or hashes; the filters mix them with the
+  * MurmurHash3 finalizer, so hash other key types to 64 bits first.
+  * containsMany looks up a batch of keys, prefetching their blocks before
+  * probing them so the cache misses overlap.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+#include "bitset.hpp"
+#include "cpu_features.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "bloom.hpp requires C++11"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bits {
+
+/**
+ * (1 - e^(-k n / m))^k, the false positive rate of a standard Bloom filter of
+ * m bits holding n keys with k hash functions.
+ */
+inline double bloomFalsePositiveRate(size_t keys, size_t bits, unsigned k) {
+    if (bits == 0) {
+        return 1;
+    }
+    return std::pow(1 - std::exp(-static_cast<double>(k) * keys / bits), static_cast<double>(k));
+}
+
+namespace detail {
+
+// Odd multipliers that pick a key's bit in each word of a block.
+constexpr uint32_t BLOOM_SALTS[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+constexpr size_t BLOOM_BLOCK_WORDS = 8;
+
+constexpr size_t BLOOM_BATCH = 32;
+
+/** The MurmurHash3 64-bit finalizer. */
+inline uint64_t bloomHash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/**
+ * The most blocks or words a filter has: bloomIndex maps 32 bits of the hash
+ * and the AVX2 kernel multiplies by a 32-bit count.
+ */
+constexpr size_t BLOOM_MAX_COUNT = 0xFFFFFFFFU;
+
+/** ceil(bits / unitBits), at least 1 and at most BLOOM_MAX_COUNT. */
+inline size_t bloomCount(double bits, double unitBits) {
+    const double count = std::ceil(bits / unitBits);
+    if (count < 1) {
+        return 1;
+    }
+    return count >= static_cast<double>(BLOOM_MAX_COUNT) ? BLOOM_MAX_COUNT : static_cast<size_t>(count);
+}
+
+/**
+ * The upper 32 bits of hash mapped onto [0, n) by a multiply and shift;
+ * n is at most BLOOM_MAX_COUNT.
+ */
+inline size_t bloomIndex(uint64_t hash, size_t n) {
+    return static_cast<size_t>(((hash >> 32) * n) >> 32);
+}
+
+/** The bit for salt i of the lower 32 bits of hash. */
+inline uint64_t bloomBit(uint64_t hash, unsigned i) {
+    return static_cast<uint64_t>(1) << ((static_cast<uint32_t>(hash) * BLOOM_SALTS[i]) >> 26);
+}
+
+inline uint64_t bloomMask(uint64_t hash, unsigned k) {
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < k; ++i) {
+        mask |= bloomBit(hash, i);
+    }
+    return mask;
+}
+
+inline void prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#elif defined(BITS_X86)
+    _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+    (void)p;
+#endif
+}
+
+/**
+ * The mean of rate(j) over the number of keys j in one block or word when n
+ * keys spread over count of them, which is Poisson distributed. Terms are
+ * computed in log space and summed around the mean, as e^-lambda alone
+ * underflows once lambda passes about 745.
+ */
+template<typename Rate>
+double poissonMean(size_t n, size_t count, Rate rate) {
+    if (count == 0) {
+        return 1;
+    }
+    const double lambda = static_cast<double>(n) / count;
+    if (lambda == 0) {
+        return rate(0);
+    }
+    const double spread = 10 * std::sqrt(lambda) + 20;
+    const double logLambda = std::log(lambda);
+    double sum = 0;
+    for (double j = std::max(0.0, std::floor(lambda - spread)); j <= lambda + spread; ++j) {
+        sum += std::exp(j * logLambda - lambda - std::lgamma(j + 1)) * rate(j);
+    }
+    // the truncated weights can sum a rounding error past 1
+    return std::min(sum, 1.0);
+}
+
+/**
+ * Look up n hashes in blocks, setting out[i] to whether hash i's bits are
+ * all set. Returns the number found.
+ */
+inline size_t blockedContainsPortable(const uint64_t* blocks, size_t blockCount,
+    const uint64_t* hashes, size_t n, bool* out) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t* block = blocks + bloomIndex(hashes[i], blockCount) * BLOOM_BLOCK_WORDS;
+        bool all = true;
+        for (unsigned w = 0; w < BLOOM_BLOCK_WORDS; ++w) {
+            const uint64_t bit = bloomBit(hashes[i], w);
+            all = all && (block[w] & bit) == bit;
+        }
+        out[i] = all;
+        found += all;
+    }
+    return found;
+}
+
+inline size_t registerContainsPortable(const uint64_t* words, size_t wordCount, unsigned k,
+    const uint64_t* hashes, size_t n, bool* out) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t mask = bloomMask(hashes[i], k);
+        out[i] = (words[bloomIndex(hashes[i], wordCount)] & mask) == mask;
+        found += out[i];
+    }
+    return found;
+}
+
+#if defined(BITS_X86)
+
+/**
+ * The eight words of hash's block mask: words 0-3 in lo, 4-7 in hi. The
+ * multiplies by the salts run in parallel and a variable shift turns each
+ * 6-bit product into a bit.
+ */
+BITS_TARGET("avx2") inline void blockMasksAvx2(uint64_t hash, __m256i& lo, __m256i& hi) {
+    const __m256i salts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(BLOOM_SALTS));
+    const __m256i products = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(hash)), salts);
+    const __m256i shifts = _mm256_srli_epi32(products, 26);
+    const __m256i one = _mm256_set1_epi64x(1);
+    lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(shifts)));
+    hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(shifts, 1)));
+}
+
+BITS_TARGET("avx2") inline size_t blockedContainsAvx2(const uint64_t* blocks, size_t blockCount,
+    const uint64_t* hashes, size_t n, bool* out) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t* block = blocks + bloomIndex(hashes[i], blockCount) * BLOOM_BLOCK_WORDS;
+        __m256i lo, hi;
+        blockMasksAvx2(hashes[i], lo, hi);
+        // testc is 1 when every bit of the mask is set in the block
+        const int all = _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(block)), lo)
+            & _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(block + 4)), hi);
+        out[i] = all != 0;
+        found += static_cast<size_t>(all);
+    }
+    return found;
+}
+
+/**
+ * Four hashes at a time: the word indexes and k-bit masks are computed in
+ * 64-bit lanes and the four words fetched with one gather.
+ */
+BITS_TARGET("avx2") inline size_t registerContainsAvx2(const uint64_t* words, size_t wordCount,
+    unsigned k, const uint64_t* hashes, size_t n, bool* out) {
+    const __m256i count = _mm256_set1_epi64x(static_cast<long long>(wordCount));
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i low6 = _mm256_set1_epi64x(63);
+    size_t found = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hashes + i));
+        const __m256i index = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(h, 32), count), 32);
+        __m256i mask = _mm256_setzero_si256();
+        for (unsigned s = 0; s < k; ++s) {
+            // bits 26-31 of the low 32 bits of the product
+            const __m256i product = _mm256_mul_epu32(h, _mm256_set1_epi64x(BLOOM_SALTS[s]));
+            const __m256i shift = _mm256_and_si256(_mm256_srli_epi64(product, 26), low6);
+            mask = _mm256_or_si256(mask, _mm256_sllv_epi64(one, shift));
+        }
+        const __m256i word = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(words), index, 8);
+        const __m256i hit = _mm256_cmpeq_epi64(_mm256_and_si256(word, mask), mask);
+        const unsigned bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(hit)));
+        for (unsigned j = 0; j < 4; ++j) {
+            out[i + j] = ((bits >> j) & 1) != 0;
+        }
+        found += popcount64(bits);
+    }
+    return found + registerContainsPortable(words, wordCount, k, hashes + i, n - i, out + i);
+}
+
+#endif
+
+typedef size_t (*BlockedContainsFn)(const uint64_t*, size_t, const uint64_t*, size_t, bool*);
+
+typedef size_t (*RegisterContainsFn)(const uint64_t*, size_t, unsigned, const uint64_t*, size_t, bool*);
+
+inline BlockedContainsFn selectBlockedContains() {
+#if defined(BITS_X86)
+    if (cpuFeatures().avx2) {
+        return &blockedContainsAvx2;
+    }
+#endif
+    return &blockedContainsPortable;
+}
+
+inline RegisterContainsFn selectRegisterContains() {
+#if defined(BITS_X86)
+    if (cpuFeatures().avx2) {
+        return &registerContainsAvx2;
+    }
+#endif
+    return &registerContainsPortable;
+}
+
+}
+
+/**
+ * A Bloom filter of 512-bit blocks with 8 bits per key, one in each word of
+ * the key's block. Blocks are aligned to 64 bytes.
+ */
+class BlockedBloomFilter {
+public:
+    /**
+     * A filter sized for keys keys at bitsPerKey bits each, at least one
+     * block and at most 2^32 - 1.
+     */
+    explicit BlockedBloomFilter(size_t keys, double bitsPerKey = 10)
+        : blockCount_(detail::bloomCount(keys * bitsPerKey, 512)),
+          keys_(0), words_(blockCount_ * detail::BLOOM_BLOCK_WORDS + ALIGN_WORDS, 0) {}
+
+    BlockedBloomFilter(const BlockedBloomFilter& other)
+        : blockCount_(other.blockCount_), keys_(other.keys_), words_(other.words_.size(), 0) {
+        // the copy's blocks may start at a different offset into words_
+        std::copy(other.blocks(), other.blocks() + wordCount(), blocks());
+    }
+
+    BlockedBloomFilter(BlockedBloomFilter&&) = default;
+
+    BlockedBloomFilter& operator=(const BlockedBloomFilter& other) {
+        return *this = BlockedBloomFilter(other);
+    }
+
+    BlockedBloomFilter& operator=(BlockedBloomFilter&&) = default;
+
+    void add(uint64_t key) {
+        const uint64_t hash = detail::bloomHash(key);
+        uint64_t* block = blocks() + detail::bloomIndex(hash, blockCount_) * detail::BLOOM_BLOCK_WORDS;
+        for (unsigned w = 0; w < detail::BLOOM_BLOCK_WORDS; ++w) {
+            block[w] |= detail::bloomBit(hash, w);
+        }
+        ++keys_;
+    }
+
+    /** Whether key may have been added; false means it certainly was not. */
+    bool contains(uint64_t key) const {
+        const uint64_t hash = detail::bloomHash(key);
+        bool found;
+        return kernel()(blocks(), blockCount_, &hash, 1, &found) != 0;
+    }
+
+    /**
+     * Set out[i] to contains(keys[i]) for i < n and return how many are
+     * true.
+     */
+    size_t containsMany(const uint64_t* keys, size_t n, bool* out) const {
+        const uint64_t* data = blocks();
+        const detail::BlockedContainsFn probe = kernel();
+        uint64_t hashes[detail::BLOOM_BATCH];
+        size_t found = 0;
+        for (size_t i = 0; i < n; i += detail::BLOOM_BATCH) {
+            const size_t batch = std::min(n - i, detail::BLOOM_BATCH);
+            for (size_t j = 0; j < batch; ++j) {
+                hashes[j] = detail::bloomHash(keys[i + j]);
+                detail::prefetch(data + detail::bloomIndex(hashes[j], blockCount_) * detail::BLOOM_BLOCK_WORDS);
+            }
+            found += probe(data, blockCount_, hashes, batch, out + i);
+        }
+        return found;
+    }
+
+    /** Remove every key. */
+    void clear() {
+        std::fill(words_.begin(), words_.end(), 0);
+        keys_ = 0;
+    }
+
+    /** The number of add calls since construction or clear. */
+    size_t keys() const { return keys_; }
+
+    /** The number of bits in the filter. */
+    size_t bits() const { return wordCount() * 64; }
+
+    /** Bytes of storage, including the alignment padding. */
+    size_t memoryBytes() const { return words_.size() * sizeof(uint64_t); }
+
+    /**
+     * The expected false positive rate with keys() distinct keys: a block
+     * with j keys has each word's bit set with probability 1 - (63/64)^j,
+     * averaged over the Poisson distribution of keys per block.
+     */
+    double falsePositiveRate() const {
+        return detail::poissonMean(keys_, blockCount_, [](double j) {
+            return std::pow(1 - std::pow(63.0 / 64, j),
+                static_cast<double>(detail::BLOOM_BLOCK_WORDS));
+        });
+    }
+
+private:
+    static constexpr size_t ALIGN_WORDS = 64 / sizeof(uint64_t) - 1;
+
+    static detail::BlockedContainsFn kernel() {
+        static const detail::BlockedContainsFn kernel = detail::selectBlockedContains();
+        return kernel;
+    }
+
+    size_t wordCount() const { return blockCount_ * detail::BLOOM_BLOCK_WORDS; }
+
+    const uint64_t* blocks() const {
+        const uintptr_t address = reinterpret_cast<uintptr_t>(words_.data());
+        return words_.data() + (64 - address % 64) % 64 / sizeof(uint64_t);
+    }
+
+    uint64_t* blocks() { return const_cast<uint64_t*>(static_cast<const BlockedBloomFilter&>(*this).blocks()); }
+
+    size_t blockCount_;
+    size_t keys_;
+    std::vector<uint64_t> words_;
+};
+
+/**
+ * A Bloom filter that puts all k bits of a key in one 64-bit word,
+ * 1 <= k <= 8.
+ */
+class RegisterBloomFilter {
+public:
+    /**
+     * A filter sized for keys keys at bitsPerKey bits each. k defaults to
+     * 0.35 * bitsPerKey + 1.25 rounded, at most 8, which tracks the measured
+     * best k (4 at 8 bits per key, 5 at 10 and 12, 7 at 16); that is lower
+     * than a standard filter's bitsPerKey * ln 2 because the bits share a
+     * word. The filter has at most 2^32 - 1 words.
+     */
+    explicit RegisterBloomFilter(size_t keys, double bitsPerKey = 10, unsigned k = 0)
+        : k_(k != 0 ? std::min(k, 8u)
+              : std::max(1u, std::min(8u, static_cast<unsigned>(bitsPerKey * 0.35 + 1.75)))),
+          keys_(0), words_(detail::bloomCount(keys * bitsPerKey, 64), 0) {}
+
+    void add(uint64_t key) {
+        const uint64_t hash = detail::bloomHash(key);
+        words_[detail::bloomIndex(hash, words_.size())] |= detail::bloomMask(hash, k_);
+        ++keys_;
+    }
+
+    /** Whether key may have been added; false means it certainly was not. */
+    bool contains(uint64_t key) const {
+        const uint64_t hash = detail::bloomHash(key);
+        const uint64_t mask = detail::bloomMask(hash, k_);
+        return (words_[detail::bloomIndex(hash, words_.size())] & mask) == mask;
+    }
+
+    /**
+     * Set out[i] to contains(keys[i]) for i < n and return how many are
+     * true.
+     */
+    size_t containsMany(const uint64_t* keys, size_t n, bool* out) const {
+        static const detail::RegisterContainsFn probe = detail::selectRegisterContains();
+        uint64_t hashes[detail::BLOOM_BATCH];
+        size_t found = 0;
+        for (size_t i = 0; i < n; i += detail::BLOOM_BATCH) {
+            const size_t batch = std::min(n - i, detail::BLOOM_BATCH);
+            for (size_t j = 0; j < batch; ++j) {
+                hashes[j] = detail::bloomHash(keys[i + j]);
+                detail::prefetch(&words_[detail::bloomIndex(hashes[j], words_.size())]);
+            }
+            found += probe(words_.data(), words_.size(), k_, hashes, batch, out + i);
+        }
+        return found;
+    }
+
+    /** Remove every key. */
+    void clear() {
+        std::fill(words_.begin(), words_.end(), 0);
+        keys_ = 0;
+    }
+
+    /** The number of add calls since construction or clear. */
+    size_t keys() const { return keys_; }
+
+    /** The number of bits per key. */
+    unsigned hashes() const { return k_; }
+
+    /** The number of bits in the filter. */
+    size_t bits() const { return words_.size() * 64; }
+
+    size_t memoryBytes() const { return words_.size() * sizeof(uint64_t); }
+
+    /**
+     * The expected false positive rate with keys() distinct keys, treating
+     * the k bits of each key as independent: a word with j keys has each
+     * bit set with probability 1 - (63/64)^(k j), averaged over the Poisson
+     * distribution of keys per word.
+     */
+    double falsePositiveRate() const {
+        const double k = k_;
+        return detail::poissonMean(keys_, words_.size(), [k](double j) {
+            return std::pow(1 - std::pow(63.0 / 64, k * j), k);
+        });
+    }
+
+private:
+    unsigned k_;
+    size_t keys_;
+    std::vector<uint64_t> words_;
+};
+
+}
+
+#endif
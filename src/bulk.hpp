@@ -0,0 +1,718 @@
+#ifndef BITS_BULK_HPP
+#define BITS_BULK_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * Field access over whole arrays of packed words. Each function applies the
+  * matching bits.hpp function to every element; the kernel used is chosen
+  * once, on first use, from the instruction sets the CPU supports.
+  *
+  * SIMD kernels handle 32 and 64-bit words with outputs of the same size, and
+  * 64-bit words with 32-bit outputs. Other combinations, including 128-bit
+  * words, use a portable loop.
+  */
+
+#include "bits.hpp"
+#include "cpu_features.hpp"
+#include <stddef.h>
+#include <limits>
+
+namespace bits {
+
+namespace detail {
+
+template<typename T, typename Out>
+void getUbitsBulkPortable(const T* in, size_t n, Out* out, unsigned width, unsigned lsb) {
+    const T mask = (static_cast<T>(1) << width) - 1;
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<Out>((in[i] >> lsb) & mask);
+    }
+}
+
+template<typename T, typename Out>
+void getSbitsBulkPortable(const T* in, size_t n, Out* out, unsigned width, unsigned lsb) {
+    const T mask = (static_cast<T>(1) << width) - 1;
+    const T minValue = static_cast<T>(1) << (width - 1);
+    for (size_t i = 0; i < n; ++i) {
+        const T field = (in[i] >> lsb) & mask;
+        out[i] = static_cast<Out>((field ^ minValue) - minValue);
+    }
+}
+
+template<typename T, typename ValueType>
+void setBitsBulkPortable(T* dest, const ValueType* values, size_t n, unsigned width, unsigned lsb) {
+    const T mask = ((static_cast<T>(1) << width) - 1) << lsb;
+    for (size_t i = 0; i < n; ++i) {
+        dest[i] = (mask & (static_cast<T>(values[i]) << lsb)) | (dest[i] & ~mask);
+    }
+}
+
+template<typename T>
+void fillBitsPortable(T* dest, size_t n, T mask, T field) {
+    for (size_t i = 0; i < n; ++i) {
+        dest[i] = field | (dest[i] & ~mask);
+    }
+}
+
+/**
+ * Whether converting a ValueType to a wider word sign extends it. KNOWN is
+ * false when that can't be determined (enums before C++11), in which case
+ * only same-size values get SIMD kernels.
+ */
+template<typename ValueType>
+struct ValueSignedness {
+#ifdef BITS_HAS_CXX11
+    static const bool KNOWN = true;
+    static const bool SIGNED =
+        std::numeric_limits<typename FieldRepresentation<ValueType, void>::type>::is_signed;
+#else
+    static const bool KNOWN = std::numeric_limits<ValueType>::is_specialized;
+    static const bool SIGNED = std::numeric_limits<ValueType>::is_signed;
+#endif
+};
+
+#if defined(BITS_X86)
+
+/**
+ * Per instruction set lane operations for inSize-byte words producing
+ * outSize-byte results, so one kernel per instruction set serves every
+ * supported word/output combination. store() narrows 64-bit lanes to 32 bits
+ * when outSize is 4.
+ */
+template<unsigned inSize, unsigned outSize>
+struct SseLanes;
+
+template<>
+struct SseLanes<4, 4> {
+    static const size_t COUNT = 4;
+    static BITS_TARGET("sse4.2") __m128i set1(uint64_t v) { return _mm_set1_epi32(static_cast<int>(v)); }
+    static BITS_TARGET("sse4.2") __m128i srl(__m128i v, __m128i count) { return _mm_srl_epi32(v, count); }
+    static BITS_TARGET("sse4.2") __m128i sll(__m128i v, __m128i count) { return _mm_sll_epi32(v, count); }
+    static BITS_TARGET("sse4.2") __m128i sub(__m128i a, __m128i b) { return _mm_sub_epi32(a, b); }
+    static BITS_TARGET("sse4.2") void store(void* p, __m128i v) { _mm_storeu_si128(static_cast<__m128i*>(p), v); }
+};
+
+template<>
+struct SseLanes<8, 8> {
+    static const size_t COUNT = 2;
+    static BITS_TARGET("sse4.2") __m128i set1(uint64_t v) { return _mm_set1_epi64x(static_cast<int64_t>(v)); }
+    static BITS_TARGET("sse4.2") __m128i srl(__m128i v, __m128i count) { return _mm_srl_epi64(v, count); }
+    static BITS_TARGET("sse4.2") __m128i sll(__m128i v, __m128i count) { return _mm_sll_epi64(v, count); }
+    static BITS_TARGET("sse4.2") __m128i sub(__m128i a, __m128i b) { return _mm_sub_epi64(a, b); }
+    static BITS_TARGET("sse4.2") void store(void* p, __m128i v) { _mm_storeu_si128(static_cast<__m128i*>(p), v); }
+};
+
+template<>
+struct SseLanes<8, 4> : SseLanes<8, 8> {
+    static BITS_TARGET("sse4.2") void store(void* p, __m128i v) {
+        _mm_storel_epi64(static_cast<__m128i*>(p), _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+};
+
+template<unsigned inSize, unsigned outSize>
+struct Avx2Lanes;
+
+template<>
+struct Avx2Lanes<4, 4> {
+    static const size_t COUNT = 8;
+    static BITS_TARGET("avx2") __m256i set1(uint64_t v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+    static BITS_TARGET("avx2") __m256i srl(__m256i v, __m128i count) { return _mm256_srl_epi32(v, count); }
+    static BITS_TARGET("avx2") __m256i sll(__m256i v, __m128i count) { return _mm256_sll_epi32(v, count); }
+    static BITS_TARGET("avx2") __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi32(a, b); }
+    static BITS_TARGET("avx2") void store(void* p, __m256i v) { _mm256_storeu_si256(static_cast<__m256i*>(p), v); }
+};
+
+template<>
+struct Avx2Lanes<8, 8> {
+    static const size_t COUNT = 4;
+    static BITS_TARGET("avx2") __m256i set1(uint64_t v) { return _mm256_set1_epi64x(static_cast<int64_t>(v)); }
+    static BITS_TARGET("avx2") __m256i srl(__m256i v, __m128i count) { return _mm256_srl_epi64(v, count); }
+    static BITS_TARGET("avx2") __m256i sll(__m256i v, __m128i count) { return _mm256_sll_epi64(v, count); }
+    static BITS_TARGET("avx2") __m256i sub(__m256i a, __m256i b) { return _mm256_sub_epi64(a, b); }
+    static BITS_TARGET("avx2") void store(void* p, __m256i v) { _mm256_storeu_si256(static_cast<__m256i*>(p), v); }
+};
+
+template<>
+struct Avx2Lanes<8, 4> : Avx2Lanes<8, 8> {
+    static BITS_TARGET("avx2") void store(void* p, __m256i v) {
+        const __m256i evens = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+        _mm_storeu_si128(static_cast<__m128i*>(p),
+            _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, evens)));
+    }
+};
+
+// The zero-masked shifts and conversions are the same instructions as the
+// unmasked ones; GCC 12's unmasked intrinsics pass their builtins an
+// undefined vector and warn about it being uninitialized. For the same
+// reason d & ~mask is written as one ternary logic op (0xF0 & ~0xCC)
+// rather than _mm512_andnot_si512.
+template<unsigned inSize, unsigned outSize>
+struct Avx512Lanes;
+
+template<>
+struct Avx512Lanes<4, 4> {
+    static const size_t COUNT = 16;
+    static BITS_TARGET("avx512f") __m512i set1(uint64_t v) { return _mm512_set1_epi32(static_cast<int>(v)); }
+    static BITS_TARGET("avx512f") __m512i srl(__m512i v, __m128i count) { return _mm512_maskz_srl_epi32(0xFFFF, v, count); }
+    static BITS_TARGET("avx512f") __m512i sll(__m512i v, __m128i count) { return _mm512_maskz_sll_epi32(0xFFFF, v, count); }
+    static BITS_TARGET("avx512f") __m512i sub(__m512i a, __m512i b) { return _mm512_sub_epi32(a, b); }
+    static BITS_TARGET("avx512f") void store(void* p, __m512i v) { _mm512_storeu_si512(p, v); }
+};
+
+template<>
+struct Avx512Lanes<8, 8> {
+    static const size_t COUNT = 8;
+    static BITS_TARGET("avx512f") __m512i set1(uint64_t v) { return _mm512_set1_epi64(static_cast<int64_t>(v)); }
+    static BITS_TARGET("avx512f") __m512i srl(__m512i v, __m128i count) { return _mm512_maskz_srl_epi64(0xFF, v, count); }
+    static BITS_TARGET("avx512f") __m512i sll(__m512i v, __m128i count) { return _mm512_maskz_sll_epi64(0xFF, v, count); }
+    static BITS_TARGET("avx512f") __m512i sub(__m512i a, __m512i b) { return _mm512_sub_epi64(a, b); }
+    static BITS_TARGET("avx512f") void store(void* p, __m512i v) { _mm512_storeu_si512(p, v); }
+};
+
+template<>
+struct Avx512Lanes<8, 4> : Avx512Lanes<8, 8> {
+    static BITS_TARGET("avx512f") void store(void* p, __m512i v) {
+        _mm256_storeu_si256(static_cast<__m256i*>(p), _mm512_maskz_cvtepi64_epi32(0xFF, v));
+    }
+};
+
+/**
+ * Load values for set kernels as word-sized lanes, widening 32-bit values
+ * to 64-bit words with the same sign or zero extension static_cast does.
+ */
+template<unsigned wordSize, unsigned valueSize, bool isSigned>
+struct SseValues {
+    static BITS_TARGET("sse4.2") __m128i load(const void* p) {
+        return _mm_loadu_si128(static_cast<const __m128i*>(p));
+    }
+};
+
+template<>
+struct SseValues<8, 4, true> {
+    static BITS_TARGET("sse4.2") __m128i load(const void* p) {
+        return _mm_cvtepi32_epi64(_mm_loadl_epi64(static_cast<const __m128i*>(p)));
+    }
+};
+
+template<>
+struct SseValues<8, 4, false> {
+    static BITS_TARGET("sse4.2") __m128i load(const void* p) {
+        return _mm_cvtepu32_epi64(_mm_loadl_epi64(static_cast<const __m128i*>(p)));
+    }
+};
+
+template<unsigned wordSize, unsigned valueSize, bool isSigned>
+struct Avx2Values {
+    static BITS_TARGET("avx2") __m256i load(const void* p) {
+        return _mm256_loadu_si256(static_cast<const __m256i*>(p));
+    }
+};
+
+template<>
+struct Avx2Values<8, 4, true> {
+    static BITS_TARGET("avx2") __m256i load(const void* p) {
+        return _mm256_cvtepi32_epi64(_mm_loadu_si128(static_cast<const __m128i*>(p)));
+    }
+};
+
+template<>
+struct Avx2Values<8, 4, false> {
+    static BITS_TARGET("avx2") __m256i load(const void* p) {
+        return _mm256_cvtepu32_epi64(_mm_loadu_si128(static_cast<const __m128i*>(p)));
+    }
+};
+
+template<unsigned wordSize, unsigned valueSize, bool isSigned>
+struct Avx512Values {
+    static BITS_TARGET("avx512f") __m512i load(const void* p) {
+        return _mm512_loadu_si512(p);
+    }
+};
+
+template<>
+struct Avx512Values<8, 4, true> {
+    static BITS_TARGET("avx512f") __m512i load(const void* p) {
+        return _mm512_maskz_cvtepi32_epi64(0xFF, _mm256_loadu_si256(static_cast<const __m256i*>(p)));
+    }
+};
+
+template<>
+struct Avx512Values<8, 4, false> {
+    static BITS_TARGET("avx512f") __m512i load(const void* p) {
+        return _mm512_maskz_cvtepu32_epi64(0xFF, _mm256_loadu_si256(static_cast<const __m256i*>(p)));
+    }
+};
+
+template<typename T, typename Out>
+BITS_TARGET("sse4.2") void getUbitsBulkSse42(const T* in, size_t n, Out* out, unsigned width, unsigned lsb) {
+    typedef SseLanes<sizeof(T), sizeof(Out)> Lanes;
+    const __m128i mask = Lanes::set1((static_cast<T>(1) << width) - 1);
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(lsb));
+    size_t i = 0;
+    for (; i + Lanes::COUNT <= n; i += Lanes::COUNT) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        Lanes::store(out + i, _mm_and_si128(Lanes::srl(v, count), mask));
+    }
+    getUbitsBulkPortable(in + i, n - i, out + i, width, lsb);
+}
+
+template<typename T, typename Out>
+BITS_TARGET("sse4.2") void getSbitsBulkSse42(const T* in, size_t n, Out* out, unsigned width, unsigned lsb) {
+    typedef SseLanes<sizeof(T), sizeof(Out)> Lanes;
+    const __m128i mask = Lanes::set1((static_cast<T>(1) << width) - 1);
+    const __m128i minValue = Lanes::set1(static_cast<T>(1) << (width - 1));
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(lsb));
+    size_t i = 0;
+    for (; i + Lanes::COUNT <= n; i += Lanes::COUNT) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        v = _mm_and_si128(Lanes::srl(v, count), mask);
+        Lanes::store(out + i, Lanes::sub(_mm_xor_si128(v, minValue), minValue));
+    }
+    getSbitsBulkPortable(in + i, n - i, out + i, width, lsb);
+}
+
+template<typename T, typename Out>
+BITS_TARGET("avx2") void getUbitsBulkAvx2(const T* in, size_t n, Out* out, unsigned width, unsigned lsb) {
+    typedef Avx2Lanes<sizeof(T), sizeof(Out)> Lanes;
+    const __m256i mask = Lanes::set1((static_cast<T>(1) << width) - 1);
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(lsb));
+    size_t i = 0;
+    for (; i + Lanes::COUNT <= n; i += Lanes::COUNT) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        Lanes::store(out + i, _mm256_and_si256(Lanes::srl(v, count), mask));
+    }
+    getUbitsBulkPortable(in + i, n - i, out + i, width, lsb);
+}
+
+template<typename T, typename Out>
+BITS_TARGET("avx2") void getSbitsBulkAvx2(const T* in, size_t n, Out* out, unsigned width, unsigned lsb) {
+    typedef Avx2Lanes<sizeof(T), sizeof(Out)> Lanes;
+    const __m256i mask = Lanes::set1((static_cast<T>(1) << width) - 1);
+    const __m256i minValue = Lanes::set1(static_cast<T>(1) << (width - 1));
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(lsb));
+    size_t i = 0;
+    for (; i + Lanes::COUNT <= n; i += Lanes::COUNT) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        v = _mm256_and_si256(Lanes::srl(v, count), mask);
+        Lanes::store(out + i, Lanes::sub(_mm256_xor_si256(v, minValue), minValue));
+    }
+    getSbitsBulkPortable(in + i, n - i, out + i, width, lsb);
+}
+
+template<typename T, typename Out>
+BITS_TARGET("avx512f") void getUbitsBulkAvx512(const T* in, size_t n, Out* out, unsigned width, unsigned lsb) {
+    typedef Avx512Lanes<sizeof(T), sizeof(Out)> Lanes;
+    const __m512i mask = Lanes::set1((static_cast<T>(1) << width) - 1);
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(lsb));
+    size_t i = 0;
+    for (; i + Lanes::COUNT <= n; i += Lanes::COUNT) {
+        const __m512i v = _mm512_loadu_si512(in + i);
+        Lanes::store(out + i, _mm512_and_si512(Lanes::srl(v, count), mask));
+    }
+    getUbitsBulkPortable(in + i, n - i, out + i, width, lsb);
+}
+
+template<typename T, typename Out>
+BITS_TARGET("avx512f") void getSbitsBulkAvx512(const T* in, size_t n, Out* out, unsigned width, unsigned lsb) {
+    typedef Avx512Lanes<sizeof(T), sizeof(Out)> Lanes;
+    const __m512i mask = Lanes::set1((static_cast<T>(1) << width) - 1);
+    const __m512i minValue = Lanes::set1(static_cast<T>(1) << (width - 1));
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(lsb));
+    size_t i = 0;
+    for (; i + Lanes::COUNT <= n; i += Lanes::COUNT) {
+        __m512i v = _mm512_loadu_si512(in + i);
+        v = _mm512_and_si512(Lanes::srl(v, count), mask);
+        Lanes::store(out + i, Lanes::sub(_mm512_xor_si512(v, minValue), minValue));
+    }
+    getSbitsBulkPortable(in + i, n - i, out + i, width, lsb);
+}
+
+template<typename T, typename ValueType>
+BITS_TARGET("sse4.2") void setBitsBulkSse42(T* dest, const ValueType* values, size_t n, unsigned width, unsigned lsb) {
+    typedef SseLanes<sizeof(T), sizeof(T)> Lanes;
+    typedef SseValues<sizeof(T), sizeof(ValueType), ValueSignedness<ValueType>::SIGNED> Values;
+    const __m128i mask = Lanes::set1(((static_cast<T>(1) << width) - 1) << lsb);
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(lsb));
+    size_t i = 0;
+    for (; i + Lanes::COUNT <= n; i += Lanes::COUNT) {
+        const __m128i field = _mm_and_si128(Lanes::sll(Values::load(values + i), count), mask);
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+        Lanes::store(dest + i, _mm_or_si128(_mm_andnot_si128(mask, d), field));
+    }
+    setBitsBulkPortable(dest + i, values + i, n - i, width, lsb);
+}
+
+template<typename T, typename ValueType>
+BITS_TARGET("avx2") void setBitsBulkAvx2(T* dest, const ValueType* values, size_t n, unsigned width, unsigned lsb) {
+    typedef Avx2Lanes<sizeof(T), sizeof(T)> Lanes;
+    typedef Avx2Values<sizeof(T), sizeof(ValueType), ValueSignedness<ValueType>::SIGNED> Values;
+    const __m256i mask = Lanes::set1(((static_cast<T>(1) << width) - 1) << lsb);
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(lsb));
+    size_t i = 0;
+    for (; i + Lanes::COUNT <= n; i += Lanes::COUNT) {
+        const __m256i field = _mm256_and_si256(Lanes::sll(Values::load(values + i), count), mask);
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dest + i));
+        Lanes::store(dest + i, _mm256_or_si256(_mm256_andnot_si256(mask, d), field));
+    }
+    setBitsBulkPortable(dest + i, values + i, n - i, width, lsb);
+}
+
+template<typename T, typename ValueType>
+BITS_TARGET("avx512f") void setBitsBulkAvx512(T* dest, const ValueType* values, size_t n, unsigned width, unsigned lsb) {
+    typedef Avx512Lanes<sizeof(T), sizeof(T)> Lanes;
+    typedef Avx512Values<sizeof(T), sizeof(ValueType), ValueSignedness<ValueType>::SIGNED> Values;
+    const __m512i mask = Lanes::set1(((static_cast<T>(1) << width) - 1) << lsb);
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(lsb));
+    size_t i = 0;
+    for (; i + Lanes::COUNT <= n; i += Lanes::COUNT) {
+        const __m512i field = _mm512_and_si512(Lanes::sll(Values::load(values + i), count), mask);
+        const __m512i d = _mm512_loadu_si512(dest + i);
+        Lanes::store(dest + i, _mm512_or_si512(_mm512_ternarylogic_epi64(d, mask, mask, 0x30), field));
+    }
+    setBitsBulkPortable(dest + i, values + i, n - i, width, lsb);
+}
+
+/**
+ * fillBits kernels work on any word size up to 64 bits: mask and field are
+ * repeated to fill 64 bits, and the bitwise operations don't care about lane
+ * size.
+ */
+template<typename T>
+uint64_t repeatTo64(T value) {
+    uint64_t pattern = value;
+    for (unsigned bits = sizeof(T) * BITS_IN_BYTE; bits < 64; bits *= 2) {
+        pattern |= pattern << bits;
+    }
+    return pattern;
+}
+
+template<typename T>
+BITS_TARGET("sse4.2") void fillBitsSse42(T* dest, size_t n, T mask, T field) {
+    const size_t COUNT = sizeof(__m128i) / sizeof(T);
+    const __m128i maskVec = _mm_set1_epi64x(static_cast<int64_t>(repeatTo64(mask)));
+    const __m128i fieldVec = _mm_set1_epi64x(static_cast<int64_t>(repeatTo64(field)));
+    size_t i = 0;
+    for (; i + COUNT <= n; i += COUNT) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+            _mm_or_si128(_mm_andnot_si128(maskVec, d), fieldVec));
+    }
+    fillBitsPortable(dest + i, n - i, mask, field);
+}
+
+template<typename T>
+BITS_TARGET("avx2") void fillBitsAvx2(T* dest, size_t n, T mask, T field) {
+    const size_t COUNT = sizeof(__m256i) / sizeof(T);
+    const __m256i maskVec = _mm256_set1_epi64x(static_cast<int64_t>(repeatTo64(mask)));
+    const __m256i fieldVec = _mm256_set1_epi64x(static_cast<int64_t>(repeatTo64(field)));
+    size_t i = 0;
+    for (; i + COUNT <= n; i += COUNT) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dest + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+            _mm256_or_si256(_mm256_andnot_si256(maskVec, d), fieldVec));
+    }
+    fillBitsPortable(dest + i, n - i, mask, field);
+}
+
+template<typename T>
+BITS_TARGET("avx512f") void fillBitsAvx512(T* dest, size_t n, T mask, T field) {
+    const size_t COUNT = sizeof(__m512i) / sizeof(T);
+    const __m512i maskVec = _mm512_set1_epi64(static_cast<int64_t>(repeatTo64(mask)));
+    const __m512i fieldVec = _mm512_set1_epi64(static_cast<int64_t>(repeatTo64(field)));
+    size_t i = 0;
+    for (; i + COUNT <= n; i += COUNT) {
+        const __m512i d = _mm512_loadu_si512(dest + i);
+        _mm512_storeu_si512(dest + i, _mm512_or_si512(_mm512_ternarylogic_epi64(d, maskVec, maskVec, 0x30), fieldVec));
+    }
+    fillBitsPortable(dest + i, n - i, mask, field);
+}
+
+#endif
+
+/**
+ * Picks the widest kernel the CPU supports for a word/output combination.
+ * Combinations without SIMD kernels always get the portable loop.
+ *
+ * BMI2 (SHRX/BZHI) is used by the single-word run-time functions in bits.hpp
+ * when the compiler targets it, but it is not a bulk kernel here: a scalar
+ * BMI2 loop is slower than the vectorized shift and mask.
+ */
+template<typename T, typename Out,
+    bool simd = sizeof(T) >= 4 && sizeof(T) <= 8
+        && (sizeof(Out) == sizeof(T) || (sizeof(T) == 8 && sizeof(Out) == 4))>
+struct BulkKernels {
+    typedef void (*GetFn)(const T*, size_t, Out*, unsigned, unsigned);
+
+    static GetFn selectGetUbits() { return &getUbitsBulkPortable<T, Out>; }
+    static GetFn selectGetSbits() { return &getSbitsBulkPortable<T, Out>; }
+};
+
+template<typename T, typename Out>
+struct BulkKernels<T, Out, true> {
+    typedef void (*GetFn)(const T*, size_t, Out*, unsigned, unsigned);
+
+    static GetFn selectGetUbits() {
+#if defined(BITS_X86)
+        const CpuFeatures& cpu = cpuFeatures();
+        if (cpu.avx512f) {
+            return &getUbitsBulkAvx512<T, Out>;
+        }
+        if (cpu.avx2) {
+            return &getUbitsBulkAvx2<T, Out>;
+        }
+        if (cpu.sse42) {
+            return &getUbitsBulkSse42<T, Out>;
+        }
+#endif
+        return &getUbitsBulkPortable<T, Out>;
+    }
+
+    static GetFn selectGetSbits() {
+#if defined(BITS_X86)
+        const CpuFeatures& cpu = cpuFeatures();
+        if (cpu.avx512f) {
+            return &getSbitsBulkAvx512<T, Out>;
+        }
+        if (cpu.avx2) {
+            return &getSbitsBulkAvx2<T, Out>;
+        }
+        if (cpu.sse42) {
+            return &getSbitsBulkSse42<T, Out>;
+        }
+#endif
+        return &getSbitsBulkPortable<T, Out>;
+    }
+};
+
+
+/**
+ * Set kernels exist for values the same size as the word, and for 32-bit
+ * values stored in 64-bit words when their signedness is known.
+ */
+template<typename T, typename ValueType,
+    bool simd = sizeof(T) >= 4 && sizeof(T) <= 8
+        && (sizeof(ValueType) == sizeof(T)
+            || (sizeof(T) == 8 && sizeof(ValueType) == 4 && ValueSignedness<ValueType>::KNOWN))>
+struct SetBulkKernels {
+    typedef void (*SetFn)(T*, const ValueType*, size_t, unsigned, unsigned);
+
+    static SetFn selectSetBits() { return &setBitsBulkPortable<T, ValueType>; }
+};
+
+template<typename T, typename ValueType>
+struct SetBulkKernels<T, ValueType, true> {
+    typedef void (*SetFn)(T*, const ValueType*, size_t, unsigned, unsigned);
+
+    static SetFn selectSetBits() {
+#if defined(BITS_X86)
+        const CpuFeatures& cpu = cpuFeatures();
+        if (cpu.avx512f) {
+            return &setBitsBulkAvx512<T, ValueType>;
+        }
+        if (cpu.avx2) {
+            return &setBitsBulkAvx2<T, ValueType>;
+        }
+        if (cpu.sse42) {
+            return &setBitsBulkSse42<T, ValueType>;
+        }
+#endif
+        return &setBitsBulkPortable<T, ValueType>;
+    }
+};
+
+/**
+ * Fill kernels exist for words of up to 64 bits, the size their mask and
+ * field patterns are repeated to.
+ */
+template<typename T, bool simd = sizeof(T) <= 8>
+struct FillKernels {
+    typedef void (*FillFn)(T*, size_t, T, T);
+
+    static FillFn selectFillBits() { return &fillBitsPortable<T>; }
+};
+
+template<typename T>
+struct FillKernels<T, true> {
+    typedef void (*FillFn)(T*, size_t, T, T);
+
+    static FillFn selectFillBits() {
+#if defined(BITS_X86)
+        const CpuFeatures& cpu = cpuFeatures();
+        if (cpu.avx512f) {
+            return &fillBitsAvx512<T>;
+        }
+        if (cpu.avx2) {
+            return &fillBitsAvx2<T>;
+        }
+        if (cpu.sse42) {
+            return &fillBitsSse42<T>;
+        }
+#endif
+        return &fillBitsPortable<T>;
+    }
+};
+
+}
+
+/**
+ * out[i] = getUbits(in[i], width, lsb) for i in [0, n), converted to Out.
+ */
+template<typename T, typename Out>
+void getUbitsBulk(const T* in, size_t n, Out* out, unsigned width, unsigned lsb) {
+    static_assert(detail::IsUnsignedWord<T>::value,
+        "T must be an unsigned integer type");
+
+    static_assert(detail::IsUnsignedWord<Out>::value || detail::IsSignedValue<Out>::value,
+        "Out must be an integer type");
+
+    static const typename detail::BulkKernels<T, Out>::GetFn kernel =
+        detail::BulkKernels<T, Out>::selectGetUbits();
+    kernel(in, n, out, width, lsb);
+}
+
+/**
+ * out[i] = getSbits<ValueType>(in[i], width, lsb) for i in [0, n).
+ */
+template<typename ValueType, typename SrcType>
+void getSbitsBulk(const SrcType* in, size_t n, ValueType* out, unsigned width, unsigned lsb) {
+    static_assert(detail::IsUnsignedWord<SrcType>::value,
+        "SrcType must be an unsigned integer type");
+
+    static_assert(detail::IsSignedValue<ValueType>::value,
+        "ValueType must be a signed integer type");
+
+    static const typename detail::BulkKernels<SrcType, ValueType>::GetFn kernel =
+        detail::BulkKernels<SrcType, ValueType>::selectGetSbits();
+    kernel(in, n, out, width, lsb);
+}
+
+/**
+ * out[i] = getUbits<width, lsb>(in[i]) for i in [0, n), converted to Out,
+ * which must be wide enough to hold the field.
+ */
+template<unsigned width, unsigned lsb, typename T, typename Out>
+void getUbitsBulk(const T* in, size_t n, Out* out) {
+    static_assert(width > 0,
+        "width must be > 0");
+
+    static_assert(width < sizeof(T) * BITS_IN_BYTE,
+        "width must be < than sizeof T * BITS_IN_BYTE");
+
+    static_assert(sizeof(T) * BITS_IN_BYTE >= width + lsb,
+        "sizeof T * BITS_IN_BYTE must be >= width + lsb");
+
+    static_assert(sizeof(Out) * BITS_IN_BYTE >= width,
+        "sizeof Out * BITS_IN_BYTE must be >= width");
+
+    getUbitsBulk(in, n, out, width, lsb);
+}
+
+/**
+ * out[i] = getSbits<width, lsb, ValueType>(in[i]) for i in [0, n).
+ */
+template<unsigned width, unsigned lsb, typename SrcType, typename ValueType>
+void getSbitsBulk(const SrcType* in, size_t n, ValueType* out) {
+    static_assert(width > 0,
+        "width must be > 0");
+
+    static_assert(width < sizeof(SrcType) * BITS_IN_BYTE,
+        "width must be < than sizeof SrcType * BITS_IN_BYTE");
+
+    static_assert(sizeof(SrcType) * BITS_IN_BYTE >= width + lsb,
+        "sizeof SrcType * BITS_IN_BYTE must be >= width + lsb");
+
+    static_assert(sizeof(ValueType) * BITS_IN_BYTE >= width,
+        "sizeof ValueType * BITS_IN_BYTE must be >= width");
+
+    getSbitsBulk(in, n, out, width, lsb);
+}
+
+/**
+ * setBits(dest[i], width, lsb, values[i]) for i in [0, n).
+ */
+template<typename DestType, typename ValueType>
+void setBitsBulk(DestType* dest, const ValueType* values, size_t n, unsigned width, unsigned lsb) {
+    static_assert(detail::IsUnsignedWord<DestType>::value,
+        "DestType must be an unsigned integer type");
+
+    static_assert(detail::IsFieldValue<ValueType>::value,
+        "ValueType must be an integer or enum type");
+
+    static const typename detail::SetBulkKernels<DestType, ValueType>::SetFn kernel =
+        detail::SetBulkKernels<DestType, ValueType>::selectSetBits();
+    kernel(dest, values, n, width, lsb);
+}
+
+/**
+ * setBits<width, lsb>(dest[i], values[i]) for i in [0, n).
+ */
+template<unsigned width, unsigned lsb, typename DestType, typename ValueType>
+void setBitsBulk(DestType* dest, const ValueType* values, size_t n) {
+    static_assert(width > 0,
+        "width must be > 0");
+
+    static_assert(width < sizeof(DestType) * BITS_IN_BYTE,
+        "width must be < than sizeof DestType * BITS_IN_BYTE");
+
+    static_assert(sizeof(DestType) * BITS_IN_BYTE >= width + lsb,
+        "sizeof DestType * BITS_IN_BYTE must be >= width + lsb");
+
+    setBitsBulk(dest, values, n, width, lsb);
+}
+
+/**
+ * setBits(dest[i], width, lsb, value) for i in [0, n).
+ */
+template<typename DestType, typename ValueType>
+void fillBits(DestType* dest, size_t n, unsigned width, unsigned lsb, const ValueType value) {
+    static_assert(detail::IsUnsignedWord<DestType>::value,
+        "DestType must be an unsigned integer type");
+
+    static_assert(detail::IsFieldValue<ValueType>::value,
+        "ValueType must be an integer or enum type");
+
+    static const typename detail::FillKernels<DestType>::FillFn kernel =
+        detail::FillKernels<DestType>::selectFillBits();
+    const DestType mask = static_cast<DestType>(((static_cast<DestType>(1) << width) - 1) << lsb);
+    kernel(dest, n, mask, static_cast<DestType>(mask & (static_cast<DestType>(value) << lsb)));
+}
+
+/**
+ * setBits<width, lsb>(dest[i], value) for i in [0, n).
+ */
+template<unsigned width, unsigned lsb, typename DestType, typename ValueType>
+void fillBits(DestType* dest, size_t n, const ValueType value) {
+    static_assert(width > 0,
+        "width must be > 0");
+
+    static_assert(width < sizeof(DestType) * BITS_IN_BYTE,
+        "width must be < than sizeof DestType * BITS_IN_BYTE");
+
+    static_assert(sizeof(DestType) * BITS_IN_BYTE >= width + lsb,
+        "sizeof DestType * BITS_IN_BYTE must be >= width + lsb");
+
+    fillBits(dest, n, width, lsb, value);
+}
+
+}
+
+#endif
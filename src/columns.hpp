@@ -0,0 +1,139 @@
+#ifndef BITS_COLUMNS_HPP
+#define BITS_COLUMNS_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * Conversion between arrays of packed records described by a Layout and one
+  * array (column) per field.
+  *
+  * Unpacking works on blocks of records small enough to stay in L1. Each
+  * field of a block is extracted by the SIMD kernels in bulk.hpp, so the
+  * records are read from memory once however many fields they have. Packing
+  * builds each record in a register from all its fields and stores it once.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+#include "bulk.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "columns.hpp requires C++11"
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+
+namespace bits {
+
+namespace detail {
+
+// Records per block: 4 KB of 64-bit records, leaving L1 room for the columns.
+constexpr size_t COLUMN_BLOCK = 512;
+
+template<typename F, typename Word, typename Column,
+    bool isEnum = std::is_enum<Column>::value,
+    bool isSigned = std::is_signed<typename FieldRepresentation<typename F::ValueType, Word>::type>::value>
+struct ColumnField {
+    // unsigned field into an integer column
+    static void unpack(const Word* records, size_t n, Column* column) {
+        getUbitsBulk<F::WIDTH, F::LSB>(records, n, column);
+    }
+};
+
+template<typename F, typename Word, typename Column>
+struct ColumnField<F, Word, Column, false, true> {
+    static_assert(std::is_signed<Column>::value,
+        "a signed field needs a signed column");
+
+    static void unpack(const Word* records, size_t n, Column* column) {
+        getSbitsBulk<F::WIDTH, F::LSB>(records, n, column);
+    }
+};
+
+template<typename F, typename Word, typename Column, bool isSigned>
+struct ColumnField<F, Word, Column, true, isSigned> {
+    // enum columns can't be handed to the integer kernels
+    static void unpack(const Word* records, size_t n, Column* column) {
+        for (size_t i = 0; i < n; ++i) {
+            column[i] = static_cast<Column>(getField<F>(records[i]));
+        }
+    }
+};
+
+template<typename Word, typename FieldsTuple>
+struct ColumnCodec;
+
+template<typename Word, typename... Fields>
+struct ColumnCodec<Word, std::tuple<Fields...>> {
+    template<typename... Columns>
+    static void unpack(const Word* records, size_t n, Columns*... columns) {
+        int expand[] = { 0,
+            (ColumnField<Fields, Word, Columns>::unpack(records, n, columns), 0)... };
+        (void)expand;
+    }
+
+    template<typename... Columns>
+    static void pack(Word* records, size_t n, const Columns*... columns) {
+        for (size_t i = 0; i < n; ++i) {
+            records[i] = FieldPacker<Word, Fields...>::pack(columns[i]...);
+        }
+    }
+};
+
+}
+
+/**
+ * Decode n records into one column per field of L, in the order the fields
+ * are listed. Signed fields are sign extended as getSbits does and need
+ * signed columns; columns may be wider than their fields.
+ */
+template<typename L, typename... Columns>
+void unpackColumns(const typename L::WordType* records, size_t n, Columns*... columns) {
+    static_assert(sizeof...(Columns) == L::FIELD_COUNT,
+        "unpackColumns needs one column per field");
+
+    typedef detail::ColumnCodec<typename L::WordType, typename L::FieldsType> Codec;
+    for (size_t begin = 0; begin < n; begin += detail::COLUMN_BLOCK) {
+        const size_t count = std::min(detail::COLUMN_BLOCK, n - begin);
+        Codec::unpack(records + begin, count, (columns + begin)...);
+    }
+}
+
+/**
+ * Encode one column per field of L into n records; the inverse of
+ * unpackColumns. Values are truncated to their fields as setBits does and
+ * bits outside every field are zero. Each record is assembled in a register
+ * and stored once, without reading the old value.
+ */
+template<typename L, typename... Columns>
+void packColumns(typename L::WordType* records, size_t n, const Columns*... columns) {
+    static_assert(sizeof...(Columns) == L::FIELD_COUNT,
+        "packColumns needs one column per field");
+
+    detail::ColumnCodec<typename L::WordType, typename L::FieldsType>::pack(records, n, columns...);
+}
+
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef BITS_CPU_FEATURES_HPP
+#define BITS_CPU_FEATURES_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * Run-time CPU feature detection used to pick instruction set specific
+  * kernels once, the first time they are needed.
+  *
+  * Kernels for a specific instruction set are marked with BITS_TARGET so they
+  * can be compiled without enabling that instruction set for the whole
+  * program. BITS_X86 is only defined when such kernels can be built.
+  */
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #if defined(__GNUC__) || defined(__clang__)
+        #define BITS_X86 1
+        #define BITS_TARGET(isa) __attribute__((target(isa)))
+        #include <immintrin.h>
+    #elif defined(_MSC_VER)
+        #define BITS_X86 1
+        #define BITS_TARGET(isa)
+        #include <intrin.h>
+        #include <immintrin.h>
+    #endif
+#endif
+
+namespace bits {
+
+/**
+ * Instruction set extensions the running CPU and operating system support.
+ */
+struct CpuFeatures {
+    bool popcnt;
+    bool sse42;
+    bool bmi1;
+    bool bmi2;
+    bool avx2;
+    bool avx512f;
+    bool avx512bw;
+    bool avx512vl;
+    bool avx512vpopcntdq;
+};
+
+namespace detail {
+
+inline CpuFeatures detectCpuFeatures() {
+    CpuFeatures f = CpuFeatures();
+#if defined(BITS_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    f.popcnt   = __builtin_cpu_supports("popcnt") != 0;
+    f.sse42    = __builtin_cpu_supports("sse4.2") != 0;
+    f.bmi1     = __builtin_cpu_supports("bmi") != 0;
+    f.bmi2     = __builtin_cpu_supports("bmi2") != 0;
+    f.avx2     = __builtin_cpu_supports("avx2") != 0;
+    f.avx512f  = __builtin_cpu_supports("avx512f") != 0;
+    f.avx512bw = __builtin_cpu_supports("avx512bw") != 0;
+    f.avx512vl = __builtin_cpu_supports("avx512vl") != 0;
+    f.avx512vpopcntdq = __builtin_cpu_supports("avx512vpopcntdq") != 0;
+#elif defined(BITS_X86) && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    const int maxLeaf = regs[0];
+    __cpuid(regs, 1);
+    f.popcnt = (regs[2] & (1 << 23)) != 0;
+    f.sse42  = (regs[2] & (1 << 20)) != 0;
+    // AVX state must be enabled by the OS as well as supported by the CPU
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    const bool ymmState = (xcr0 & 0x6) == 0x6;
+    const bool zmmState = (xcr0 & 0xE6) == 0xE6;
+    if (maxLeaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        f.bmi1     = (regs[1] & (1 << 3)) != 0;
+        f.bmi2     = (regs[1] & (1 << 8)) != 0;
+        f.avx2     = ymmState && (regs[1] & (1 << 5)) != 0;
+        f.avx512f  = zmmState && (regs[1] & (1 << 16)) != 0;
+        f.avx512bw = zmmState && (regs[1] & (1 << 30)) != 0;
+        f.avx512vl = zmmState && (regs[1] & (1 << 31)) != 0;
+        f.avx512vpopcntdq = zmmState && (regs[2] & (1 << 14)) != 0;
+    }
+#endif
+    return f;
+}
+
+}
+
+/**
+ * The features of the CPU the program is running on. Detection runs once;
+ * later calls return the cached result.
+ */
+inline const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = detail::detectCpuFeatures();
+    return features;
+}
+
+}
+
+#endif
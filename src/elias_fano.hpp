@@ -0,0 +1,301 @@
+#ifndef BITS_ELIAS_FANO_HPP
+#define BITS_ELIAS_FANO_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+ /**
+  * EliasFanoSequence, a compressed non-decreasing sequence of integers such
+  * as a posting list or the offsets array of a CSR graph.
+  *
+  * For n values below u, each value keeps its low L = floor(log2(u / n))
+  * bits in a packed array of L-bit fields. The high bits are stored in
+  * unary: value i sets bit (value >> L) + i of an upper bit vector of about
+  * 2n bits. That is at most 2 + L bits per value, within 2 bits of the
+  * information-theoretic bound log2(u choose n) / n.
+  *
+  * Positions of every 256th one and every 256th zero of the upper bits are
+  * sampled, so access and nextGEQ scan a few words from a sample; this adds
+  * about half a bit per value.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+#include "rank_select.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "elias_fano.hpp requires C++11"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace bits {
+
+namespace detail {
+
+inline unsigned floorLog2(uint64_t x) {
+    unsigned log = 0;
+    while (x >>= 1) {
+        ++log;
+    }
+    return log;
+}
+
+}
+
+/**
+ * An immutable non-decreasing sequence of 64-bit unsigned integers in
+ * Elias-Fano form, with random access, successor search and iteration.
+ */
+class EliasFanoSequence {
+public:
+    /** The upper bits have a sample at every multiple of this many ones and zeros. */
+    static constexpr size_t SAMPLE = 256;
+
+    /**
+     * A forward iterator over the values. Each step finds the next one in
+     * the upper bits and reads one packed low field.
+     */
+    class Iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef uint64_t value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const uint64_t* pointer;
+        typedef uint64_t reference;
+
+        Iterator() : sequence_(nullptr), index_(0), wordIndex_(0), word_(0), value_(0) {}
+
+        uint64_t operator*() const { return value_; }
+
+        /** The position of the current value in the sequence. */
+        size_t index() const { return index_; }
+
+        Iterator& operator++() {
+            if (++index_ < sequence_->size_) {
+                advance();
+            }
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const Iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+
+    private:
+        friend class EliasFanoSequence;
+
+        /** Start at value index, whose one is the first at or after position. */
+        Iterator(const EliasFanoSequence* sequence, size_t index, size_t position)
+            : sequence_(sequence), index_(index), wordIndex_(position / 64), word_(0), value_(0) {
+            if (index < sequence->size_) {
+                word_ = sequence->upper_[wordIndex_] & (~static_cast<uint64_t>(0) << (position % 64));
+                advance();
+            }
+        }
+
+        void advance() {
+            while (word_ == 0) {
+                word_ = sequence_->upper_[++wordIndex_];
+            }
+            const size_t position = wordIndex_ * 64 + detail::countTrailingZeros64(word_);
+            word_ &= word_ - 1;
+            value_ = ((position - index_) << sequence_->lowBits_) | sequence_->low(index_);
+        }
+
+        const EliasFanoSequence* sequence_;
+        size_t index_;
+        size_t wordIndex_;
+        uint64_t word_;     // the ones of upper_[wordIndex_] not visited yet
+        uint64_t value_;
+    };
+
+    typedef Iterator const_iterator;
+
+    EliasFanoSequence() : size_(0), last_(0), lowBits_(0), lowMask_(0) {
+        init(static_cast<const uint64_t*>(nullptr));
+    }
+
+    /**
+     * Encode values[0, n), which must be non-decreasing. T is any unsigned
+     * integer type.
+     */
+    template<typename T>
+    EliasFanoSequence(const T* values, size_t n)
+        : size_(n), last_(n == 0 ? 0 : static_cast<uint64_t>(values[n - 1])), lowBits_(0), lowMask_(0) {
+        static_assert(std::is_integral<T>::value && std::is_unsigned<T>::value,
+            "T must be an unsigned integer type");
+        init(values);
+    }
+
+    template<typename T>
+    explicit EliasFanoSequence(const std::vector<T>& values)
+        : EliasFanoSequence(values.data(), values.size()) {}
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    /** The largest value, or 0 if the sequence is empty. */
+    uint64_t back() const { return last_; }
+
+    /** The number of low bits kept per value in the packed array. */
+    unsigned lowBits() const { return lowBits_; }
+
+    /** The value at index i, for i < size(). */
+    uint64_t access(size_t i) const {
+        const size_t position = selectOne(i);
+        return ((position - i) << lowBits_) | low(i);
+    }
+
+    uint64_t operator[](size_t i) const { return access(i); }
+
+    /**
+     * An iterator at the first value >= x, or end() if every value is
+     * smaller. The zero samples lead to the bucket of values sharing x's
+     * high bits, which is scanned from its start.
+     */
+    Iterator lowerBound(uint64_t x) const {
+        if (size_ == 0 || x > last_) {
+            return end();
+        }
+        Iterator it = bucketBegin(x >> lowBits_);
+        while (*it < x) {
+            ++it;
+        }
+        return it;
+    }
+
+    /** The index of the first value >= x, or size() if every value is smaller. */
+    size_t nextGEQ(uint64_t x) const { return lowerBound(x).index(); }
+
+    Iterator begin() const { return Iterator(this, 0, 0); }
+
+    Iterator end() const { return Iterator(this, size_, 0); }
+
+    /** An iterator at index i, for i <= size(). */
+    Iterator iteratorAt(size_t i) const {
+        return i < size_ ? Iterator(this, i, selectOne(i)) : end();
+    }
+
+    /** Bytes used by the low bits, upper bits and samples. */
+    size_t memoryBytes() const {
+        return (low_.size() + upper_.size() + oneSamples_.size() + zeroSamples_.size())
+            * sizeof(uint64_t);
+    }
+
+private:
+    template<typename T>
+    void init(const T* values) {
+        if (size_ != 0) {
+            // L = floor(log2(u / n)) for the universe u = last_ + 1
+            const uint64_t ratio = last_ == ~static_cast<uint64_t>(0) ? last_ / size_ : (last_ + 1) / size_;
+            lowBits_ = ratio > 1 ? detail::floorLog2(ratio) : 0;
+            lowMask_ = lowBits_ == 0 ? 0 : ~static_cast<uint64_t>(0) >> (64 - lowBits_);
+        }
+        const uint64_t buckets = size_ == 0 ? 0 : (last_ >> lowBits_) + 1;
+        // one padding word past the end lets low() use readPaddedBits and
+        // the upper scans stop on zero bits rather than a bound
+        low_.assign((size_ * lowBits_ + 63) / 64 + 1, 0);
+        upper_.assign((size_ + buckets + 63) / 64 + 1, 0);
+        oneSamples_.reserve(size_ / SAMPLE + 1);
+        zeroSamples_.reserve(buckets / SAMPLE + 1);
+
+        uint64_t nextBucket = 0;
+        for (size_t i = 0; i < size_; ++i) {
+            const uint64_t value = static_cast<uint64_t>(values[i]);
+            const uint64_t high = value >> lowBits_;
+            // the sampled buckets up to this one start where value i goes
+            for (; nextBucket <= high; nextBucket += SAMPLE) {
+                zeroSamples_.push_back(nextBucket + i);
+            }
+            const size_t position = high + i;
+            upper_[position / 64] |= static_cast<uint64_t>(1) << (position % 64);
+            if (i % SAMPLE == 0) {
+                oneSamples_.push_back(position);
+            }
+            if (lowBits_ != 0) {
+                detail::writeBitsAt(low_.data(), i * lowBits_, lowBits_, value);
+            }
+        }
+    }
+
+    /** The low bits of value i. */
+    uint64_t low(size_t i) const {
+        // with L == 0 there is only the padding word, so nothing to read
+        return lowBits_ == 0 ? 0 : detail::readPaddedBits(low_.data(), i * lowBits_, lowMask_);
+    }
+
+    /** The position of one number i in the upper bits. */
+    size_t selectOne(size_t i) const {
+        size_t position = oneSamples_[i / SAMPLE];
+        size_t wordIndex = position / 64;
+        uint64_t word = upper_[wordIndex] & (~static_cast<uint64_t>(0) << (position % 64));
+        unsigned remaining = static_cast<unsigned>(i % SAMPLE);
+        for (unsigned ones = detail::popcount64(word); remaining >= ones; ones = detail::popcount64(word)) {
+            remaining -= ones;
+            word = upper_[++wordIndex];
+        }
+        return wordIndex * 64 + detail::selectInWord(word, remaining);
+    }
+
+    /** An iterator at the first value whose high bits are >= bucket. */
+    Iterator bucketBegin(uint64_t bucket) const {
+        size_t position = zeroSamples_[bucket / SAMPLE];
+        unsigned remaining = static_cast<unsigned>(bucket % SAMPLE);
+        if (remaining != 0) {
+            // step past the zeros ending the buckets before this one
+            --remaining;
+            size_t wordIndex = position / 64;
+            uint64_t word = ~upper_[wordIndex] & (~static_cast<uint64_t>(0) << (position % 64));
+            for (unsigned zeros = detail::popcount64(word); remaining >= zeros; zeros = detail::popcount64(word)) {
+                remaining -= zeros;
+                word = ~upper_[++wordIndex];
+            }
+            position = wordIndex * 64 + detail::selectInWord(word, remaining) + 1;
+        }
+        // the ones before position belong to the values in earlier buckets
+        return Iterator(this, position - bucket, position);
+    }
+
+    size_t size_;
+    uint64_t last_;
+    unsigned lowBits_;
+    uint64_t lowMask_;
+    std::vector<uint64_t> low_;
+    std::vector<uint64_t> upper_;
+    std::vector<uint64_t> oneSamples_;
+    std::vector<uint64_t> zeroSamples_;
+};
+
+}
+
+#endif
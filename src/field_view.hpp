@@ -0,0 +1,216 @@
+#ifndef BITS_FIELD_VIEW_HPP
+#define BITS_FIELD_VIEW_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * Views that read and write the fields of a Layout in place in a byte
+  * buffer, such as a received packet or a memory mapped file, without copying
+  * the record into an aligned word first.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "field_view.hpp requires C++11"
+#endif
+
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+
+namespace bits {
+
+/**
+ * Byte orders of a record in a buffer. LittleEndian stores the least
+ * significant byte of the word first, BigEndian (network order) the most
+ * significant byte first.
+ */
+struct LittleEndian {};
+struct BigEndian {};
+
+namespace detail {
+
+template<typename ByteOrder>
+struct RecordBytes;
+
+template<>
+struct RecordBytes<LittleEndian> {
+    // byte i of the record is byte i of the word
+    static constexpr size_t wordByte(size_t i, size_t) { return i; }
+
+    // a word loaded from the record on a little-endian host
+    template<typename Word>
+    static Word fromHost(Word word, size_t bytes) {
+        return bytes == sizeof(Word) ? word
+            : static_cast<Word>(word & ((static_cast<Word>(1) << (bytes * BITS_IN_BYTE)) - 1));
+    }
+
+    // the word to store the record from on a little-endian host
+    template<typename Word>
+    static Word toHost(Word word, size_t) { return word; }
+};
+
+template<>
+struct RecordBytes<BigEndian> {
+    // byte 0 of the record is the most significant byte of the word
+    static constexpr size_t wordByte(size_t i, size_t bytes) { return bytes - 1 - i; }
+
+    template<typename Word>
+    static Word fromHost(Word word, size_t bytes) {
+        return static_cast<Word>(byteSwap(word) >> ((sizeof(Word) - bytes) * BITS_IN_BYTE));
+    }
+
+    template<typename Word>
+    static Word toHost(Word word, size_t bytes) {
+        return byteSwap(static_cast<Word>(word << ((sizeof(Word) - bytes) * BITS_IN_BYTE)));
+    }
+};
+
+}
+
+/**
+ * A read-only view of a record of L stored in bytes bytes at data, in
+ * ByteOrder. bytes may be less than the size of the Layout's word, e.g. 6 for
+ * a 48-bit record in a uint64_t Layout, as long as every field fits.
+ *
+ * The record is read with unaligned loads of its bytes (fixed-size memcpy,
+ * which compilers turn into plain loads), after which any number of fields
+ * are extracted with the Layout's constant masks. A record shorter than its
+ * word takes more than one load unless padded is true, which promises that
+ * the sizeof(Word) bytes at data are readable, e.g. because the buffer has
+ * padding at its end; the whole word is then loaded in one go and the bytes
+ * past the record discarded.
+ */
+template<typename L, typename ByteOrder = LittleEndian,
+    size_t bytes = sizeof(typename L::WordType), bool padded = false>
+class ConstFieldView {
+public:
+    typedef typename L::WordType WordType;
+
+    static_assert(bytes > 0 && bytes <= sizeof(WordType),
+        "bytes must be > 0 and <= sizeof(WordType)");
+
+    static_assert(bytes == sizeof(WordType)
+        || (L::MASK >> (bytes * BITS_IN_BYTE % (sizeof(WordType) * BITS_IN_BYTE))) == 0,
+        "every field must fit in bytes");
+
+    /** The size of one record, for stepping through an array of them. */
+    static constexpr size_t BYTES = bytes;
+
+    explicit ConstFieldView(const void* data) : data_(static_cast<const unsigned char*>(data)) {}
+
+    const unsigned char* data() const { return data_; }
+
+    /** The whole record as a word. */
+    WordType word() const {
+        WordType word = 0;
+#if defined(BITS_LITTLE_ENDIAN)
+        // an unaligned load, of the whole word if padded
+        memcpy(&word, data_, padded ? sizeof(word) : bytes);
+        return detail::RecordBytes<ByteOrder>::fromHost(word, bytes);
+#else
+        for (size_t i = 0; i < bytes; ++i) {
+            word |= static_cast<WordType>(data_[i])
+                << (detail::RecordBytes<ByteOrder>::wordByte(i, bytes) * BITS_IN_BYTE);
+        }
+        return word;
+#endif
+    }
+
+    template<typename F>
+    typename FieldValue<F, WordType>::type get() const {
+        return L::template get<F>(word());
+    }
+
+    /** Several fields from one load. */
+    template<typename... Fields>
+    std::tuple<typename FieldValue<Fields, WordType>::type...> getFields() const {
+        return bits::getFields<Fields...>(word());
+    }
+
+    typename L::ValuesType unpack() const {
+        return L::unpack(word());
+    }
+
+private:
+    const unsigned char* data_;
+};
+
+template<typename L, typename ByteOrder, size_t bytes, bool padded>
+constexpr size_t ConstFieldView<L, ByteOrder, bytes, padded>::BYTES;
+
+/**
+ * A view that can also write the record. Writes store exactly the record's
+ * bytes; padding is never written, even when padded is true.
+ */
+template<typename L, typename ByteOrder = LittleEndian,
+    size_t bytes = sizeof(typename L::WordType), bool padded = false>
+class FieldView : public ConstFieldView<L, ByteOrder, bytes, padded> {
+public:
+    typedef typename L::WordType WordType;
+
+    explicit FieldView(void* data)
+        : ConstFieldView<L, ByteOrder, bytes, padded>(data), data_(static_cast<unsigned char*>(data)) {}
+
+    unsigned char* data() const { return data_; }
+
+    /** Replace the whole record. */
+    void setWord(WordType word) const {
+#if defined(BITS_LITTLE_ENDIAN)
+        word = detail::RecordBytes<ByteOrder>::toHost(word, bytes);
+        memcpy(data_, &word, bytes); // an unaligned store
+#else
+        for (size_t i = 0; i < bytes; ++i) {
+            data_[i] = static_cast<unsigned char>(
+                word >> (detail::RecordBytes<ByteOrder>::wordByte(i, bytes) * BITS_IN_BYTE));
+        }
+#endif
+    }
+
+    /**
+     * Set one or more fields with a single read-modify-write of the record.
+     */
+    template<typename... SetFields, typename... Values>
+    void set(const Values... values) const {
+        WordType word = this->word();
+        L::template set<SetFields...>(word, values...);
+        setWord(word);
+    }
+
+    /**
+     * Write every field, in the order the fields are listed, without reading
+     * the record. Unused bits are zero.
+     */
+    template<typename... Values>
+    void pack(const Values... values) const {
+        setWord(L::pack(values...));
+    }
+
+private:
+    unsigned char* data_;
+};
+
+}
+
+#endif
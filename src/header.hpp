@@ -0,0 +1,195 @@
+#ifndef BITS_HEADER_HPP
+#define BITS_HEADER_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * Declarative layouts for headers that span several words, such as IPv4,
+  * UDP or VXLAN headers. A header is a list of HeaderWords, each a word at a
+  * byte offset holding Fields bound to members of a plain struct:
+  *
+  *     struct Udp { uint16_t srcPort, dstPort, length, checksum; };
+  *     typedef Field<16, 48> SrcPort;
+  *     typedef Field<16, 32> DstPort;
+  *     typedef Field<16, 16> Length;
+  *     typedef Field<16, 0> Checksum;
+  *     typedef Header<Udp, BigEndian,
+  *         HeaderWord<0, uint64_t,
+  *             BITS_BIND(SrcPort, &Udp::srcPort),
+  *             BITS_BIND(DstPort, &Udp::dstPort),
+  *             BITS_BIND(Length, &Udp::length),
+  *             BITS_BIND(Checksum, &Udp::checksum)>> UdpHeader;
+  *
+  *     Udp udp;
+  *     if (UdpHeader::parse(packet, size, udp)) { ... }
+  *
+  * parse checks the size once, loads each word once and extracts every field
+  * of that word from the register with the masks and shifts of its Layout;
+  * the whole parser is expanded inline from the description.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+#include "field_view.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "header.hpp requires C++11"
+#endif
+
+#include <cstddef>
+
+namespace bits {
+
+/**
+ * Binds the field F to the member of a struct it is parsed into. Member is
+ * the type of the pointer to member; BITS_BIND spells both for you. F can't
+ * contain a comma inside the macro, so name it with a typedef.
+ */
+template<typename F, typename Member, Member member>
+struct Bind;
+
+template<typename F, typename Struct, typename T, T Struct::*member>
+struct Bind<F, T Struct::*, member> {
+    typedef F FieldType;
+    typedef Struct StructType;
+
+    template<typename Word>
+    static void read(const Word& word, Struct& out) {
+        out.*member = static_cast<T>(getField<F>(word));
+    }
+
+    template<typename Word>
+    static typename FieldValue<F, Word>::type value(const Struct& in) {
+        return static_cast<typename FieldValue<F, Word>::type>(in.*member);
+    }
+};
+
+#define BITS_BIND(F, member) ::bits::Bind<F, decltype(member), member>
+
+/**
+ * A word of Word's size at byte offset of a header, holding the fields of
+ * Binds. The fields are checked like those of a Layout: they must fit in
+ * Word and must not overlap. A field as wide as a 32-bit word, such as an
+ * IPv4 address, goes in a 64-bit word together with its neighbour.
+ */
+template<size_t offset, typename Word, typename... Binds>
+struct HeaderWord {
+    typedef Layout<Word, typename Binds::FieldType...> LayoutType;
+
+    static constexpr size_t OFFSET = offset;
+    static constexpr size_t END = offset + sizeof(Word);
+
+    template<typename ByteOrder, typename Struct>
+    static void parse(const unsigned char* data, Struct& out) {
+        const Word word = ConstFieldView<LayoutType, ByteOrder>(data + offset).word();
+        int expand[] = { 0, (Binds::read(word, out), 0)... };
+        (void)expand;
+    }
+
+    template<typename ByteOrder, typename Struct>
+    static void write(const Struct& in, unsigned char* data) {
+        FieldView<LayoutType, ByteOrder>(data + offset).pack(
+            Binds::template value<Word>(in)...);
+    }
+};
+
+template<size_t offset, typename Word, typename... Binds>
+constexpr size_t HeaderWord<offset, Word, Binds...>::OFFSET;
+
+template<size_t offset, typename Word, typename... Binds>
+constexpr size_t HeaderWord<offset, Word, Binds...>::END;
+
+namespace detail {
+
+template<typename... Words>
+struct HeaderEnd : std::integral_constant<size_t, 0> {};
+
+template<typename W, typename... Rest>
+struct HeaderEnd<W, Rest...>
+    : std::integral_constant<size_t,
+        (W::END > HeaderEnd<Rest...>::value ? W::END : HeaderEnd<Rest...>::value)> {};
+
+template<typename... Words>
+struct HeaderWordsOverlap : std::false_type {};
+
+template<typename W, typename... Rest>
+struct HeaderWordsOverlap<W, Rest...>
+    : std::integral_constant<bool,
+        !All<(W::END <= Rest::OFFSET || Rest::END <= W::OFFSET)...>::value
+        || HeaderWordsOverlap<Rest...>::value> {};
+
+}
+
+/**
+ * A header of Struct made of the HeaderWords Words, stored in ByteOrder
+ * (BigEndian for network headers). The words must not overlap; bytes that
+ * belong to no word are skipped when parsing and left alone when writing.
+ */
+template<typename Struct, typename ByteOrder, typename... Words>
+struct Header {
+    static_assert(!detail::HeaderWordsOverlap<Words...>::value,
+        "the words of a Header must not overlap");
+
+    /** The number of bytes parse and write need. */
+    static constexpr size_t BYTES = detail::HeaderEnd<Words...>::value;
+
+    /**
+     * Fill out from the header at data, which is size bytes long. Returns
+     * false, leaving out untouched, if size is less than BYTES.
+     */
+    static bool parse(const void* data, size_t size, Struct& out) {
+        if (size < BYTES) {
+            return false;
+        }
+        parseUnchecked(data, out);
+        return true;
+    }
+
+    /** parse for a caller that has already checked there are BYTES bytes. */
+    static void parseUnchecked(const void* data, Struct& out) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        int expand[] = { 0, (Words::template parse<ByteOrder>(bytes, out), 0)... };
+        (void)expand;
+    }
+
+    /**
+     * Write in to data, which is size bytes long. Values are truncated to
+     * their fields as setBits does. Returns false, writing nothing, if size
+     * is less than BYTES.
+     */
+    static bool write(const Struct& in, void* data, size_t size) {
+        if (size < BYTES) {
+            return false;
+        }
+        unsigned char* bytes = static_cast<unsigned char*>(data);
+        int expand[] = { 0, (Words::template write<ByteOrder>(in, bytes), 0)... };
+        (void)expand;
+        return true;
+    }
+};
+
+template<typename Struct, typename ByteOrder, typename... Words>
+constexpr size_t Header<Struct, ByteOrder, Words...>::BYTES;
+
+}
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef BITS_PACKED_VECTOR_HPP
+#define BITS_PACKED_VECTOR_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * PackedVector stores integers of width bits back to back in 64-bit words,
+  * so element i occupies bits [i * width, (i + 1) * width) of the array
+  * (little-endian bit order, as in bits.hpp). Elements may straddle two words.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+#include "cpu_features.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "packed_vector.hpp requires C++11"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+namespace bits {
+
+namespace detail {
+
+/**
+ * Unpack n elements of width bits starting at element first of data.
+ */
+template<unsigned width, typename ValueType>
+void unpackPortable(const uint64_t* data, size_t first, size_t n, ValueType* out) {
+    static constexpr uint64_t MASK = (static_cast<uint64_t>(1) << width) - 1;
+    static constexpr uint64_t MIN_VALUE = static_cast<uint64_t>(1) << (width - 1);
+    size_t bit = first * width;
+    for (size_t i = 0; i < n; ++i, bit += width) {
+        const uint64_t raw = readPaddedBits(data, bit, MASK);
+        if (std::is_signed<ValueType>::value) {
+            out[i] = static_cast<ValueType>((raw ^ MIN_VALUE) - MIN_VALUE);
+        } else {
+            out[i] = static_cast<ValueType>(raw);
+        }
+    }
+}
+
+#if defined(BITS_X86)
+
+/**
+ * Unpack groups of 8 elements starting at element first, which must be a
+ * multiple of 8 so each group starts on a byte boundary. Each 128-bit lane
+ * holds 4 elements; PSHUFB moves the 4 bytes covering an element into its
+ * 32-bit slot and a variable shift and mask finish the extraction. Requires
+ * width <= 25 so an element plus its bit offset fits in 4 bytes. Returns the
+ * number of elements unpacked, a multiple of 8.
+ */
+template<unsigned width, typename ValueType>
+BITS_TARGET("avx2") size_t unpackAvx2(const uint64_t* data, size_t first, size_t n, ValueType* out) {
+    static_assert(width <= 25, "the AVX2 unpack kernel needs width <= 25");
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data) + first * width / 8;
+    // the second lane's elements start at bit 4 * width of the group
+    const unsigned LANE1_BYTE = 4 * width / 8;
+    const unsigned LANE1_BIT = 4 * width % 8;
+
+    alignas(32) unsigned char shuffle[32];
+    alignas(32) uint32_t shifts[8];
+    for (unsigned lane = 0; lane < 2; ++lane) {
+        for (unsigned j = 0; j < 4; ++j) {
+            const unsigned bit = j * width + lane * LANE1_BIT;
+            for (unsigned b = 0; b < 4; ++b) {
+                shuffle[lane * 16 + j * 4 + b] = static_cast<unsigned char>(bit / 8 + b);
+            }
+            shifts[lane * 4 + j] = bit % 8;
+        }
+    }
+    const __m256i shuffleVec = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffle));
+    const __m256i shiftVec = _mm256_load_si256(reinterpret_cast<const __m256i*>(shifts));
+    const __m256i mask = _mm256_set1_epi32(static_cast<int>((static_cast<uint64_t>(1) << width) - 1));
+    const __m256i minValue = _mm256_set1_epi32(static_cast<int>(1u << (width - 1)));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8, bytes += width) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + LANE1_BYTE));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        v = _mm256_shuffle_epi8(v, shuffleVec);
+        v = _mm256_and_si256(_mm256_srlv_epi32(v, shiftVec), mask);
+        if (std::is_signed<ValueType>::value) {
+            v = _mm256_sub_epi32(_mm256_xor_si256(v, minValue), minValue);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+    }
+    return i;
+}
+
+template<unsigned width, typename ValueType, bool supported = (width <= 25)>
+struct PackedAvx2Kernel {
+    static size_t (*get())(const uint64_t*, size_t, size_t, ValueType*) { return nullptr; }
+};
+
+template<unsigned width, typename ValueType>
+struct PackedAvx2Kernel<width, ValueType, true> {
+    static size_t (*get())(const uint64_t*, size_t, size_t, ValueType*) {
+        return &unpackAvx2<width, ValueType>;
+    }
+};
+
+#endif
+
+}
+
+/**
+ * A vector of integers of width bits, 1 <= width <= 32. Signed elements are
+ * sign extended on the way out the same way getSbits does; values written
+ * are truncated to width bits the same way setBits does.
+ */
+template<unsigned width, bool Signed = false>
+class PackedVector {
+    static_assert(width > 0 && width <= 32,
+        "width must be > 0 and <= 32");
+
+public:
+    typedef typename std::conditional<Signed, int32_t, uint32_t>::type ValueType;
+
+    static constexpr unsigned WIDTH = width;
+
+    PackedVector() : size_(0), words_(PADDING_WORDS, 0) {}
+
+    explicit PackedVector(size_t n, ValueType value = 0) : PackedVector() {
+        resize(n, value);
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    /** Bytes of element storage, including the padding words. */
+    size_t memoryBytes() const { return words_.size() * sizeof(uint64_t); }
+
+    /** The packed words, for serialization. */
+    const uint64_t* data() const { return words_.data(); }
+
+    void reserve(size_t n) { words_.reserve(wordsFor(n)); }
+
+    void clear() {
+        words_.assign(PADDING_WORDS, 0);
+        size_ = 0;
+    }
+
+    void resize(size_t n, ValueType value = 0) {
+        const size_t oldSize = size_;
+        if (n < oldSize) {
+            // keep the bits past the end zero so later growth starts clean
+            setRange(n, oldSize, 0);
+        }
+        words_.resize(wordsFor(n), 0);
+        size_ = n;
+        if (n > oldSize && value != 0) {
+            setRange(oldSize, n, value);
+        }
+    }
+
+    ValueType operator[](size_t i) const { return get(i); }
+
+    ValueType get(size_t i) const {
+        ValueType value;
+        detail::unpackPortable<width>(words_.data(), i, 1, &value);
+        return value;
+    }
+
+    void set(size_t i, ValueType value) {
+        const size_t bit = i * width;
+        const size_t word = bit / 64;
+        const unsigned offset = bit % 64;
+        const uint64_t field = static_cast<uint64_t>(value) & MASK;
+        words_[word] = (words_[word] & ~(MASK << offset)) | (field << offset);
+        if (offset + width > 64) {
+            const unsigned spill = 64 - offset;
+            words_[word + 1] = (words_[word + 1] & ~(MASK >> spill)) | (field >> spill);
+        }
+    }
+
+    void push_back(ValueType value) {
+        if (wordsFor(size_ + 1) > words_.size()) {
+            words_.push_back(0);
+        }
+        set(size_++, value);
+    }
+
+    /**
+     * Copy elements [begin, end) to out. Uses an AVX2 kernel when the CPU
+     * has it and width <= 25.
+     */
+    void unpack(size_t begin, size_t end, ValueType* out) const {
+        size_t n = end - begin;
+        // the vector kernel needs groups starting on byte boundaries
+        const size_t head = std::min(n, (8 - begin % 8) % 8);
+        detail::unpackPortable<width>(words_.data(), begin, head, out);
+        begin += head;
+        out += head;
+        n -= head;
+        static const UnpackFn kernel = selectUnpack();
+        if (kernel != nullptr) {
+            const size_t done = kernel(words_.data(), begin, n, out);
+            begin += done;
+            out += done;
+            n -= done;
+        }
+        detail::unpackPortable<width>(words_.data(), begin, n, out);
+    }
+
+    /**
+     * Overwrite elements [begin, begin + n) with in[0, n). The elements must
+     * already exist. Values are written through a 64-bit accumulator, so each
+     * word is stored once.
+     */
+    void pack(size_t begin, const ValueType* in, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        const size_t bit = begin * width;
+        size_t word = bit / 64;
+        unsigned offset = bit % 64;
+        const unsigned endOffset = (begin + n) * width % 64;
+
+        uint64_t acc = words_[word] & lowMask(offset);
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t field = static_cast<uint64_t>(in[i]) & MASK;
+            acc |= field << offset;
+            offset += width;
+            if (offset >= 64) {
+                words_[word++] = acc;
+                offset -= 64;
+                // the bits of field that did not fit; 0 when offset == 0
+                acc = field >> (width - offset);
+            }
+        }
+        if (endOffset != 0) {
+            words_[word] = acc | (words_[word] & ~lowMask(endOffset));
+        }
+    }
+
+    /** Append in[0, n). */
+    void append(const ValueType* in, size_t n) {
+        const size_t begin = size_;
+        resize(size_ + n);
+        pack(begin, in, n);
+    }
+
+private:
+    typedef size_t (*UnpackFn)(const uint64_t*, size_t, size_t, ValueType*);
+
+    static constexpr uint64_t MASK = (static_cast<uint64_t>(1) << width) - 1;
+
+    // Two zero words past the last element let reads of an element's second
+    // word and the 16-byte vector loads run off the end safely.
+    static constexpr size_t PADDING_WORDS = 2;
+
+    static size_t wordsFor(size_t n) {
+        return (n * width + 63) / 64 + PADDING_WORDS;
+    }
+
+    static uint64_t lowMask(unsigned bits) {
+        return bits == 0 ? 0 : ~static_cast<uint64_t>(0) >> (64 - bits);
+    }
+
+    static UnpackFn selectUnpack() {
+#if defined(BITS_X86)
+        const UnpackFn avx2 = detail::PackedAvx2Kernel<width, ValueType>::get();
+        if (avx2 != nullptr && cpuFeatures().avx2) {
+            return avx2;
+        }
+#endif
+        return nullptr;
+    }
+
+    void setRange(size_t begin, size_t end, ValueType value) {
+        for (size_t i = begin; i < end; ++i) {
+            set(i, value);
+        }
+    }
+
+    size_t size_;
+    std::vector<uint64_t> words_;
+};
+
+template<unsigned width, bool Signed>
+constexpr unsigned PackedVector<width, Signed>::WIDTH;
+
+}
+
+#endif
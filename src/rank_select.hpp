@@ -0,0 +1,370 @@
+#ifndef BITS_RANK_SELECT_HPP
+#define BITS_RANK_SELECT_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+ /**
+  * RankSelectBitVector, a bit vector with rank (ones before a position) and
+  * select (position of the k-th one) queries for succinct data structures.
+  *
+  * The index uses one 64-bit RankEntry per 2048-bit block. The entry
+  * interleaves the block's cumulative count with the counts of its first
+  * three 512-bit sub-blocks, so a rank touches one entry and at most one
+  * 64-byte line of bits. A 64-bit count per 2^32 bits lets vectors grow past
+  * 32-bit counts, and select starts from the block of every 8192nd one. The
+  * index takes under 3.6% on top of the bits.
+  *
+  * Select within a word uses PDEP when the compiler targets BMI2 (as
+  * bits.hpp does) and a broadword byte search otherwise.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+#include "bitset.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "rank_select.hpp requires C++11"
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace bits {
+
+namespace detail {
+
+/**
+ * The position of the one with rank r (0-based) in word, which must have
+ * more than r ones.
+ */
+inline unsigned selectInWord(uint64_t word, unsigned r) {
+#if defined(__BMI2__)
+    return countTrailingZeros64(_pdep_u64(static_cast<uint64_t>(1) << r, word));
+#else
+    const uint64_t ONES = 0x0101010101010101ULL;
+    const uint64_t HIGHS = 0x8080808080808080ULL;
+    // byte i of s is the number of ones in bytes 0 to i
+    uint64_t s = word - ((word >> 1) & 0x5555555555555555ULL);
+    s = (s & 0x3333333333333333ULL) + ((s >> 2) & 0x3333333333333333ULL);
+    s = ((s + (s >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * ONES;
+    // the bytes entirely before the one have a cumulative count <= r; the
+    // subtraction never borrows because both sides are at most 64
+    const unsigned byte = popcount64((((r * ONES) | HIGHS) - s) & HIGHS);
+    const unsigned before = byte == 0 ? 0 : static_cast<unsigned>((s >> (byte * 8 - 8)) & 0xFF);
+    return byte * 8 + byteSetBits().positions[(word >> (byte * 8)) & 0xFF][r - before];
+#endif
+}
+
+}
+
+/**
+ * An immutable bit vector with constant-time rank1 and fast select1.
+ * Construction copies the bits and builds the index, using several threads
+ * for large inputs.
+ */
+class RankSelectBitVector {
+public:
+    /** Bits per block, each with a RankEntry. */
+    static constexpr size_t BLOCK_BITS = 2048;
+
+    /** Bits per sub-block; a block has four. */
+    static constexpr size_t SUB_BLOCK_BITS = 512;
+
+    /** select1 starts from the block holding the one of each multiple of this rank. */
+    static constexpr size_t SELECT_SAMPLE = 8192;
+
+    typedef Field<32, 0> Cumulative;  // ones before the block in its 2^32-bit span
+    typedef Field<10, 32> SubBlock0;  // ones in each of the first three sub-blocks
+    typedef Field<10, 42> SubBlock1;
+    typedef Field<10, 52> SubBlock2;
+    typedef Layout<uint64_t, Cumulative, SubBlock0, SubBlock1, SubBlock2> RankEntry;
+
+    /**
+     * The bits and index arrays rank1 and select1 read. A RankSelectBitVector
+     * owns its arrays; a BitsetView points at arrays in a mapped file.
+     */
+    struct Arrays {
+        size_t size;
+        size_t count;
+        const uint64_t* words;
+        const uint64_t* entries;
+        const uint64_t* upper;
+        const uint32_t* selectSamples;
+
+        /** The words, padded with zeros to whole blocks plus one. */
+        size_t wordCount() const { return (blocks() + 1) * WORDS_PER_BLOCK; }
+
+        /** One entry per block and one past the last. */
+        size_t entryCount() const { return blocks() + 1; }
+
+        size_t upperCount() const { return blocks() / UPPER_BLOCKS + 1; }
+
+        size_t selectSampleCount() const { return (count + SELECT_SAMPLE - 1) / SELECT_SAMPLE + 1; }
+
+        size_t blocks() const { return (size + BLOCK_BITS - 1) / BLOCK_BITS; }
+    };
+
+    RankSelectBitVector() : size_(0), count_(0) {}
+
+    /**
+     * Index the first size bits of words. threads is the most threads to
+     * build with; 0 means one per core. Small inputs use one thread.
+     */
+    RankSelectBitVector(const uint64_t* words, size_t size, unsigned threads = 0)
+        : size_(size), count_(0) {
+        const size_t blocks = (size + BLOCK_BITS - 1) / BLOCK_BITS;
+        // a block of zeros past the end lets rank1(size()) read a whole block
+        words_.reserve((blocks + 1) * WORDS_PER_BLOCK);
+        words_.assign(words, words + detail::bitsetWords(size));
+        words_.resize((blocks + 1) * WORDS_PER_BLOCK, 0);
+        if (size % 64 != 0) {
+            words_[size / 64] &= detail::lastWordMask(size);
+        }
+        build(blocks, threads);
+    }
+
+    explicit RankSelectBitVector(const Bitset& bits, unsigned threads = 0)
+        : RankSelectBitVector(bits.data(), bits.size(), threads) {}
+
+    size_t size() const { return size_; }
+
+    /** The number of ones. */
+    size_t count() const { return count_; }
+
+    bool operator[](size_t i) const {
+        return ((words_[i / 64] >> (i % 64)) & 1) != 0;
+    }
+
+    /** The ones in [0, i), for i <= size(). */
+    size_t rank1(size_t i) const { return rank1(arrays(), i); }
+
+    /** The zeros in [0, i), for i <= size(). */
+    size_t rank0(size_t i) const { return i - rank1(i); }
+
+    /** The position of the one with rank k (0-based), for k < count(). */
+    size_t select1(size_t k) const { return select1(arrays(), k); }
+
+    /** The words holding the bits, padded with zeros to whole blocks plus one. */
+    const uint64_t* data() const { return words_.data(); }
+
+    /** The bits and index, for serialization. */
+    Arrays arrays() const {
+        const Arrays a = { size_, count_, words_.data(), entries_.data(), upper_.data(), selectSamples_.data() };
+        return a;
+    }
+
+    /** rank1 over the arrays of an index. */
+    static size_t rank1(const Arrays& a, size_t i) {
+        const size_t block = i / BLOCK_BITS;
+        const uint64_t entry = a.entries[block];
+        size_t rank = blockRank(a, block, entry);
+        const size_t sub = i / SUB_BLOCK_BITS % 4;
+        // the sub-block counts before sub, without branches
+        rank += getField<SubBlock0>(entry) & (0 - static_cast<uint64_t>(sub > 0));
+        rank += getField<SubBlock1>(entry) & (0 - static_cast<uint64_t>(sub > 1));
+        rank += getField<SubBlock2>(entry) & (0 - static_cast<uint64_t>(sub > 2));
+        const uint64_t* word = &a.words[i / SUB_BLOCK_BITS * WORDS_PER_SUB_BLOCK];
+        const uint64_t* const last = &a.words[i / 64];
+        for (; word != last; ++word) {
+            rank += detail::popcount64(*word);
+        }
+        // for i == size() at the end of a block this reads the entry and the
+        // block of zeros past the end
+        if (i % 64 != 0) {
+            rank += detail::popcount64(*last & ((static_cast<uint64_t>(1) << (i % 64)) - 1));
+        }
+        return rank;
+    }
+
+    /** select1 over the arrays of an index. */
+    static size_t select1(const Arrays& a, size_t k) {
+        // the last block whose rank is <= k, between the samples around k:
+        // halve long ranges, then scan entries in order, which the hardware
+        // prefetcher follows better than a binary search
+        size_t low = a.selectSamples[k / SELECT_SAMPLE];
+        size_t high = a.selectSamples[k / SELECT_SAMPLE + 1];
+        while (high - low > 64) {
+            const size_t middle = low + (high - low) / 2;
+            if (blockRank(a, middle, a.entries[middle]) <= k) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        while (low + 1 < a.entryCount() && blockRank(a, low + 1, a.entries[low + 1]) <= k) {
+            ++low;
+        }
+
+        const uint64_t entry = a.entries[low];
+        size_t remaining = k - blockRank(a, low, entry);
+        size_t wordIndex = low * WORDS_PER_BLOCK;
+        const size_t subCounts[3] = {
+            static_cast<size_t>(getField<SubBlock0>(entry)),
+            static_cast<size_t>(getField<SubBlock1>(entry)),
+            static_cast<size_t>(getField<SubBlock2>(entry)) };
+        for (unsigned sub = 0; sub < 3 && remaining >= subCounts[sub]; ++sub) {
+            remaining -= subCounts[sub];
+            wordIndex += WORDS_PER_SUB_BLOCK;
+        }
+        for (;; ++wordIndex) {
+            const unsigned ones = detail::popcount64(a.words[wordIndex]);
+            if (remaining < ones) {
+                break;
+            }
+            remaining -= ones;
+        }
+        return wordIndex * 64 + detail::selectInWord(a.words[wordIndex], static_cast<unsigned>(remaining));
+    }
+
+    /** Bytes used by the index, not counting the bits themselves. */
+    size_t indexBytes() const {
+        return entries_.size() * sizeof(uint64_t) + upper_.size() * sizeof(uint64_t)
+            + selectSamples_.size() * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr size_t WORDS_PER_BLOCK = BLOCK_BITS / 64;
+    static constexpr size_t WORDS_PER_SUB_BLOCK = SUB_BLOCK_BITS / 64;
+
+    // Blocks per 2^32-bit span, each of which has a 64-bit count in upper_.
+    static constexpr size_t UPPER_BLOCKS = (static_cast<size_t>(1) << 32) / BLOCK_BITS;
+
+    // Inputs smaller than this are indexed by one thread.
+    static constexpr size_t PARALLEL_BLOCKS = 1 << 12;
+
+    static size_t blockRank(const Arrays& a, size_t block, uint64_t entry) {
+        return static_cast<size_t>(a.upper[block / UPPER_BLOCKS] + getField<Cumulative>(entry));
+    }
+
+    /**
+     * Build the index in ranges of blocks. Each 2^32-bit span boundary also
+     * starts a range, so every range lies in one span. The first pass counts
+     * each range's ones; the second fills its entries and select samples
+     * from the range's starting rank.
+     */
+    void build(size_t blocks, unsigned threads) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (blocks < PARALLEL_BLOCKS) {
+            threads = 1;
+        }
+
+        std::vector<size_t> starts;
+        const size_t step = (blocks + threads - 1) / threads;
+        for (size_t begin = 0; begin < blocks; ) {
+            starts.push_back(begin);
+            begin = std::min(begin + step, (begin / UPPER_BLOCKS + 1) * UPPER_BLOCKS);
+        }
+        starts.push_back(blocks);
+        const size_t ranges = starts.size() - 1;
+
+        std::vector<size_t> rangeOnes(ranges);
+        runRanges(ranges, threads, [&](size_t r) {
+            const uint64_t* words = &words_[starts[r] * WORDS_PER_BLOCK];
+            rangeOnes[r] = detail::countWords<detail::OpFirst>(words, words,
+                (starts[r + 1] - starts[r]) * WORDS_PER_BLOCK);
+        });
+
+        std::vector<size_t> rangeRanks(ranges);
+        upper_.assign(blocks / UPPER_BLOCKS + 1, 0);
+        for (size_t r = 0; r < ranges; ++r) {
+            rangeRanks[r] = count_;
+            if (starts[r] % UPPER_BLOCKS == 0) {
+                upper_[starts[r] / UPPER_BLOCKS] = count_;
+            }
+            count_ += rangeOnes[r];
+        }
+        if (blocks % UPPER_BLOCKS == 0) {
+            upper_.back() = count_;
+        }
+
+        // one entry past the last block, for rank1(size())
+        entries_.assign(blocks + 1, 0);
+        const size_t samples = (count_ + SELECT_SAMPLE - 1) / SELECT_SAMPLE;
+        selectSamples_.assign(samples + 1, static_cast<uint32_t>(blocks == 0 ? 0 : blocks - 1));
+        // sub-blocks are too small for countWords to use its kernel, so
+        // call the kernel directly
+        const detail::BitsetKernels<detail::OpFirst>::CountFn countOnes =
+            detail::BitsetKernels<detail::OpFirst>::count();
+        runRanges(ranges, threads, [&](size_t r) {
+            size_t rank = rangeRanks[r];
+            for (size_t block = starts[r]; block < starts[r + 1]; ++block) {
+                const uint64_t* words = &words_[block * WORDS_PER_BLOCK];
+                size_t subOnes[4];
+                for (unsigned sub = 0; sub < 4; ++sub) {
+                    const uint64_t* subWords = words + sub * WORDS_PER_SUB_BLOCK;
+                    subOnes[sub] = countOnes(subWords, subWords, WORDS_PER_SUB_BLOCK);
+                }
+                entries_[block] = RankEntry::pack(rank - upper_[block / UPPER_BLOCKS],
+                    subOnes[0], subOnes[1], subOnes[2]);
+                const size_t next = rank + subOnes[0] + subOnes[1] + subOnes[2] + subOnes[3];
+                // the samples whose one is in this block
+                for (size_t s = (rank + SELECT_SAMPLE - 1) / SELECT_SAMPLE; s * SELECT_SAMPLE < next; ++s) {
+                    selectSamples_[s] = static_cast<uint32_t>(block);
+                }
+                rank = next;
+            }
+        });
+        entries_[blocks] = RankEntry::pack(count_ - upper_[blocks / UPPER_BLOCKS], 0, 0, 0);
+    }
+
+    /**
+     * Call fn for each range on at most threadCount threads; thread t takes
+     * ranges t, t + threadCount, and so on.
+     */
+    template<typename Fn>
+    static void runRanges(size_t ranges, unsigned threadCount, Fn fn) {
+        const size_t workers = std::min<size_t>(threadCount, ranges);
+        if (workers <= 1) {
+            for (size_t r = 0; r < ranges; ++r) {
+                fn(r);
+            }
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < workers; ++t) {
+            threads.push_back(std::thread([&fn, ranges, workers, t]() {
+                for (size_t r = t; r < ranges; r += workers) {
+                    fn(r);
+                }
+            }));
+        }
+        for (size_t t = 0; t < threads.size(); ++t) {
+            threads[t].join();
+        }
+    }
+
+    size_t size_;
+    size_t count_;
+    std::vector<uint64_t> words_;
+    std::vector<uint64_t> upper_;
+    std::vector<uint64_t> entries_;
+    std::vector<uint32_t> selectSamples_;
+};
+
+}
+
+#endif
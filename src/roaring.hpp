@@ -0,0 +1,943 @@
+#ifndef BITS_ROARING_HPP
+#define BITS_ROARING_HPP
+
+/* Copyright (C) 2018 Alan Grover
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+ /**
+  * RoaringBitmap, a compressed set of 32-bit integers for sets that are too
+  * sparse, or too large, for a plain Bitset.
+  *
+  * The values are split into 64K chunks by their high 16 bits. Each chunk
+  * that has values gets a container, picked by its contents: a sorted array
+  * of up to 4096 16-bit values, a 1024-word bitmap, or, after runOptimize(),
+  * a list of runs when that is smaller. Every container caches its
+  * cardinality, so count() only adds one number per chunk.
+  *
+  * Bitmap containers are combined with the Bitset kernels (AVX-512, AVX2 or
+  * POPCNT); array containers are intersected and subtracted with SSE4.2
+  * PCMPESTRM, which compares eight values against eight others at once.
+  *
+  * Requires C++11.
+  */
+
+#include "bits.hpp"
+#include "bitset.hpp"
+#include "cpu_features.hpp"
+
+#ifndef BITS_HAS_CXX11
+    #error "roaring.hpp requires C++11"
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace bits {
+
+namespace detail {
+
+// A chunk with more values than this is stored as a bitmap.
+constexpr uint32_t ROARING_ARRAY_MAX = 4096;
+
+constexpr size_t ROARING_BITMAP_WORDS = 1024;
+
+// The array kernels store whole vectors, so their output needs this many
+// values of room past the result.
+constexpr size_t ROARING_ARRAY_PADDING = 8;
+
+/**
+ * The values of one 64K chunk. An ARRAY keeps its sorted values in values,
+ * a RUN keeps pairs of start and length - 1 in values, and a BITMAP keeps
+ * 1024 words in words.
+ */
+struct RoaringContainer {
+    enum Type { ARRAY, BITMAP, RUN };
+
+    Type type;
+    uint32_t cardinality;
+    std::vector<uint16_t> values;
+    std::vector<uint64_t> words;
+
+    RoaringContainer() : type(ARRAY), cardinality(0) {}
+};
+
+/** Set bits [begin, end) of words, for begin < end <= 65536. */
+inline void setWordRange(uint64_t* words, uint32_t begin, uint32_t end) {
+    const size_t first = begin / 64;
+    const size_t last = (end - 1) / 64;
+    const uint64_t firstMask = ~static_cast<uint64_t>(0) << (begin % 64);
+    const uint64_t lastMask = ~static_cast<uint64_t>(0) >> (63 - (end - 1) % 64);
+    if (first == last) {
+        words[first] |= firstMask & lastMask;
+        return;
+    }
+    words[first] |= firstMask;
+    for (size_t i = first + 1; i < last; ++i) {
+        words[i] = ~static_cast<uint64_t>(0);
+    }
+    words[last] |= lastMask;
+}
+
+inline bool containerTest(const RoaringContainer& c, uint16_t value) {
+    if (c.type == RoaringContainer::ARRAY) {
+        return std::binary_search(c.values.begin(), c.values.end(), value);
+    }
+    if (c.type == RoaringContainer::BITMAP) {
+        return ((c.words[value / 64] >> (value % 64)) & 1) != 0;
+    }
+    // the number of runs starting at or before value
+    size_t low = 0;
+    size_t high = c.values.size() / 2;
+    while (low < high) {
+        const size_t middle = (low + high) / 2;
+        if (c.values[2 * middle] <= value) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low > 0 && value - c.values[2 * low - 2] <= c.values[2 * low - 1];
+}
+
+inline void toBitmap(RoaringContainer& c) {
+    if (c.type == RoaringContainer::BITMAP) {
+        return;
+    }
+    c.words.assign(ROARING_BITMAP_WORDS, 0);
+    if (c.type == RoaringContainer::ARRAY) {
+        for (size_t i = 0; i < c.values.size(); ++i) {
+            c.words[c.values[i] / 64] |= static_cast<uint64_t>(1) << (c.values[i] % 64);
+        }
+    } else {
+        for (size_t r = 0; r < c.values.size(); r += 2) {
+            setWordRange(c.words.data(), c.values[r], c.values[r] + c.values[r + 1] + 1u);
+        }
+    }
+    std::vector<uint16_t>().swap(c.values);
+    c.type = RoaringContainer::BITMAP;
+}
+
+inline void toArray(RoaringContainer& c) {
+    if (c.type == RoaringContainer::ARRAY) {
+        return;
+    }
+    std::vector<uint16_t> values(c.cardinality);
+    size_t n = 0;
+    if (c.type == RoaringContainer::BITMAP) {
+        for (size_t i = 0; i < ROARING_BITMAP_WORDS; ++i) {
+            for (uint64_t word = c.words[i]; word != 0; word &= word - 1) {
+                values[n++] = static_cast<uint16_t>(i * 64 + countTrailingZeros64(word));
+            }
+        }
+        std::vector<uint64_t>().swap(c.words);
+    } else {
+        for (size_t r = 0; r < c.values.size(); r += 2) {
+            for (uint32_t v = c.values[r]; v <= c.values[r] + c.values[r + 1]; ++v) {
+                values[n++] = static_cast<uint16_t>(v);
+            }
+        }
+    }
+    c.values.swap(values);
+    c.type = RoaringContainer::ARRAY;
+}
+
+/** Turn a RUN container into whichever of ARRAY or BITMAP fits its size. */
+inline void materialize(RoaringContainer& c) {
+    if (c.type == RoaringContainer::RUN) {
+        if (c.cardinality > ROARING_ARRAY_MAX) {
+            toBitmap(c);
+        } else {
+            toArray(c);
+        }
+    }
+}
+
+/** c, or a copy of it in scratch without runs. */
+inline const RoaringContainer& materialized(const RoaringContainer& c, RoaringContainer& scratch) {
+    if (c.type != RoaringContainer::RUN) {
+        return c;
+    }
+    scratch = c;
+    materialize(scratch);
+    return scratch;
+}
+
+/** Switch between ARRAY and BITMAP after the cardinality crossed the limit. */
+inline void normalize(RoaringContainer& c) {
+    if (c.type == RoaringContainer::BITMAP && c.cardinality <= ROARING_ARRAY_MAX) {
+        toArray(c);
+    } else if (c.type == RoaringContainer::ARRAY && c.cardinality > ROARING_ARRAY_MAX) {
+        toBitmap(c);
+    }
+}
+
+inline size_t countRuns(const RoaringContainer& c) {
+    if (c.type == RoaringContainer::RUN) {
+        return c.values.size() / 2;
+    }
+    size_t runs = 0;
+    if (c.type == RoaringContainer::ARRAY) {
+        for (size_t i = 0; i < c.values.size(); ++i) {
+            runs += i == 0 || c.values[i] != c.values[i - 1] + 1;
+        }
+        return runs;
+    }
+    // a run starts at each set bit whose lower neighbour is clear
+    uint64_t carry = 0;
+    for (size_t i = 0; i < ROARING_BITMAP_WORDS; ++i) {
+        const uint64_t word = c.words[i];
+        runs += popcount64(word & ~((word << 1) | carry));
+        carry = word >> 63;
+    }
+    return runs;
+}
+
+inline void toRuns(RoaringContainer& c) {
+    if (c.type == RoaringContainer::RUN) {
+        return;
+    }
+    std::vector<uint16_t> runs;
+    runs.reserve(2 * countRuns(c));
+    if (c.type == RoaringContainer::ARRAY) {
+        for (size_t i = 0; i < c.values.size(); ) {
+            size_t j = i + 1;
+            while (j < c.values.size() && c.values[j] == c.values[j - 1] + 1) {
+                ++j;
+            }
+            runs.push_back(c.values[i]);
+            runs.push_back(static_cast<uint16_t>(j - i - 1));
+            i = j;
+        }
+    } else {
+        size_t i = 0;
+        uint64_t word = c.words[0];
+        for (;;) {
+            while (word == 0 && i + 1 < ROARING_BITMAP_WORDS) {
+                word = c.words[++i];
+            }
+            if (word == 0) {
+                break;
+            }
+            const size_t start = i * 64 + countTrailingZeros64(word);
+            // fill the bits below the run so the run ends at the first zero
+            uint64_t filled = word | (word - 1);
+            while (filled == ~static_cast<uint64_t>(0) && i + 1 < ROARING_BITMAP_WORDS) {
+                filled = c.words[++i];
+            }
+            const size_t end = filled == ~static_cast<uint64_t>(0) ? (i + 1) * 64
+                : i * 64 + countTrailingZeros64(~filled);
+            runs.push_back(static_cast<uint16_t>(start));
+            runs.push_back(static_cast<uint16_t>(end - start - 1));
+            if (filled == ~static_cast<uint64_t>(0)) {
+                break;
+            }
+            // clear the run and the filled bits below it
+            word = filled & (filled + 1);
+        }
+        std::vector<uint64_t>().swap(c.words);
+    }
+    c.values.swap(runs);
+    c.type = RoaringContainer::RUN;
+}
+
+/** Store c as runs if that is smaller than an array or bitmap, and not otherwise. */
+inline void runOptimize(RoaringContainer& c) {
+    const size_t runBytes = 4 * countRuns(c);
+    const size_t plainBytes = c.cardinality <= ROARING_ARRAY_MAX ? 2 * c.cardinality
+        : ROARING_BITMAP_WORDS * sizeof(uint64_t);
+    if (runBytes < plainBytes) {
+        toRuns(c);
+    } else {
+        materialize(c);
+    }
+}
+
+// Sorted arrays of distinct values: out gets the values in both, or in a but
+// not b, and the count is returned. out needs ROARING_ARRAY_PADDING values of
+// room past the result; out may be null to only count.
+
+inline size_t intersectArraysPortable(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            if (out != nullptr) {
+                out[n] = a[i];
+            }
+            ++n;
+            ++i;
+            ++j;
+        }
+    }
+    return n;
+}
+
+inline size_t differenceArraysPortable(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) {
+    size_t j = 0;
+    size_t n = 0;
+    for (size_t i = 0; i < na; ++i) {
+        while (j < nb && b[j] < a[i]) {
+            ++j;
+        }
+        if (j == nb || b[j] != a[i]) {
+            if (out != nullptr) {
+                out[n] = a[i];
+            }
+            ++n;
+        }
+    }
+    return n;
+}
+
+#if defined(BITS_X86)
+
+/**
+ * PSHUFB controls that move the 16-bit lanes selected by an 8-bit mask to
+ * the front of a vector.
+ */
+struct CompactLanes16 {
+    unsigned char shuffle[256][16];
+
+    CompactLanes16() {
+        const ByteSetBits& bits = byteSetBits();
+        for (unsigned mask = 0; mask < 256; ++mask) {
+            for (unsigned b = 0; b < 16; ++b) {
+                shuffle[mask][b] = 0x80;
+            }
+            for (unsigned k = 0; k < bits.counts[mask]; ++k) {
+                shuffle[mask][2 * k] = static_cast<unsigned char>(2 * bits.positions[mask][k]);
+                shuffle[mask][2 * k + 1] = static_cast<unsigned char>(2 * bits.positions[mask][k] + 1);
+            }
+        }
+    }
+};
+
+inline const CompactLanes16& compactLanes16() {
+    static const CompactLanes16 table;
+    return table;
+}
+
+constexpr int ROARING_CMPESTR_MODE = _SIDD_UWORD_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+
+/**
+ * Compare blocks of eight values of a and b; PCMPESTRM marks the values of
+ * one block found anywhere in the other. The block with the smaller last
+ * value moves on, both when the last values are equal, so every pair of
+ * overlapping blocks is compared once and matches come out in order.
+ */
+inline BITS_TARGET("sse4.2,popcnt") size_t intersectArraysSse42(
+        const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) {
+    const CompactLanes16& table = compactLanes16();
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    while (i + 8 <= na && j + 8 <= nb) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        // bit k is set if b[j + k] is in the block of a
+        const unsigned found = static_cast<unsigned>(_mm_cvtsi128_si32(
+            _mm_cmpestrm(va, 8, vb, 8, ROARING_CMPESTR_MODE))) & 0xFF;
+        if (out != nullptr) {
+            const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.shuffle[found]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n), _mm_shuffle_epi8(vb, shuffle));
+        }
+        n += _mm_popcnt_u32(found);
+        const uint16_t lastA = a[i + 7];
+        const uint16_t lastB = b[j + 7];
+        i += lastA <= lastB ? 8 : 0;
+        j += lastB <= lastA ? 8 : 0;
+    }
+    return n + intersectArraysPortable(a + i, na - i, b + j, nb - j, out == nullptr ? nullptr : out + n);
+}
+
+/**
+ * The same block walk as intersectArraysSse42. A block of a collects the
+ * values found in each block of b it overlaps and is written, less those,
+ * when it moves on.
+ */
+inline BITS_TARGET("sse4.2,popcnt") size_t differenceArraysSse42(
+        const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) {
+    const CompactLanes16& table = compactLanes16();
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    unsigned found = 0;
+    while (i + 8 <= na && j + 8 <= nb) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        // bit k is set if a[i + k] is in the block of b
+        found |= static_cast<unsigned>(_mm_cvtsi128_si32(
+            _mm_cmpestrm(vb, 8, va, 8, ROARING_CMPESTR_MODE))) & 0xFF;
+        const uint16_t lastA = a[i + 7];
+        const uint16_t lastB = b[j + 7];
+        if (lastA <= lastB) {
+            const unsigned keep = ~found & 0xFF;
+            if (out != nullptr) {
+                const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.shuffle[keep]));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n), _mm_shuffle_epi8(va, shuffle));
+            }
+            n += _mm_popcnt_u32(keep);
+            i += 8;
+            found = 0;
+        }
+        j += lastB <= lastA ? 8 : 0;
+    }
+    // the rest of a against the rest of b, skipping what the current block
+    // of a already found in earlier blocks of b
+    const size_t block = i;
+    for (; i < na; ++i) {
+        if (i - block < 8 && ((found >> (i - block)) & 1) != 0) {
+            continue;
+        }
+        while (j < nb && b[j] < a[i]) {
+            ++j;
+        }
+        if (j == nb || b[j] != a[i]) {
+            if (out != nullptr) {
+                out[n] = a[i];
+            }
+            ++n;
+        }
+    }
+    return n;
+}
+
+#endif
+
+typedef size_t (*ArrayOpFn)(const uint16_t*, size_t, const uint16_t*, size_t, uint16_t*);
+
+inline ArrayOpFn selectIntersectArrays() {
+#if defined(BITS_X86)
+    if (cpuFeatures().sse42 && cpuFeatures().popcnt) {
+        return &intersectArraysSse42;
+    }
+#endif
+    return &intersectArraysPortable;
+}
+
+inline ArrayOpFn selectDifferenceArrays() {
+#if defined(BITS_X86)
+    if (cpuFeatures().sse42 && cpuFeatures().popcnt) {
+        return &differenceArraysSse42;
+    }
+#endif
+    return &differenceArraysPortable;
+}
+
+inline size_t intersectArrays(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) {
+    static const ArrayOpFn kernel = selectIntersectArrays();
+    return kernel(a, na, b, nb, out);
+}
+
+inline size_t differenceArrays(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, uint16_t* out) {
+    static const ArrayOpFn kernel = selectDifferenceArrays();
+    return kernel(a, na, b, nb, out);
+}
+
+inline bool wordsTest(const std::vector<uint64_t>& words, uint16_t value) {
+    return ((words[value / 64] >> (value % 64)) & 1) != 0;
+}
+
+/** Keep the values of array container c that are (keep = true) or are not in words. */
+inline void filterArray(RoaringContainer& c, const std::vector<uint64_t>& words, bool keep) {
+    size_t n = 0;
+    for (size_t i = 0; i < c.values.size(); ++i) {
+        c.values[n] = c.values[i];
+        n += wordsTest(words, c.values[i]) == keep;
+    }
+    c.values.resize(n);
+    c.cardinality = static_cast<uint32_t>(n);
+}
+
+inline void recount(RoaringContainer& c) {
+    c.cardinality = static_cast<uint32_t>(countWords<OpFirst>(c.words.data(), c.words.data(), ROARING_BITMAP_WORDS));
+}
+
+inline void andContainers(RoaringContainer& a, const RoaringContainer& b) {
+    RoaringContainer scratch;
+    const RoaringContainer& other = materialized(b, scratch);
+    materialize(a);
+    if (a.type == RoaringContainer::ARRAY && other.type == RoaringContainer::ARRAY) {
+        std::vector<uint16_t> values(std::min(a.values.size(), other.values.size()) + ROARING_ARRAY_PADDING);
+        values.resize(intersectArrays(a.values.data(), a.values.size(),
+            other.values.data(), other.values.size(), values.data()));
+        a.values.swap(values);
+        a.cardinality = static_cast<uint32_t>(a.values.size());
+    } else if (a.type == RoaringContainer::ARRAY) {
+        filterArray(a, other.words, true);
+    } else if (other.type == RoaringContainer::ARRAY) {
+        RoaringContainer result;
+        result.values = other.values;
+        filterArray(result, a.words, true);
+        a = std::move(result);
+    } else {
+        combineWords<OpAnd>(a.words.data(), a.words.data(), other.words.data(), ROARING_BITMAP_WORDS);
+        recount(a);
+        normalize(a);
+    }
+}
+
+inline void orContainers(RoaringContainer& a, const RoaringContainer& b) {
+    RoaringContainer scratch;
+    const RoaringContainer& other = materialized(b, scratch);
+    materialize(a);
+    if (a.type == RoaringContainer::ARRAY && other.type == RoaringContainer::ARRAY
+            && a.cardinality + other.cardinality <= ROARING_ARRAY_MAX) {
+        std::vector<uint16_t> values(a.values.size() + other.values.size());
+        values.erase(std::set_union(a.values.begin(), a.values.end(),
+            other.values.begin(), other.values.end(), values.begin()), values.end());
+        a.values.swap(values);
+        a.cardinality = static_cast<uint32_t>(a.values.size());
+        return;
+    }
+    if (a.type == RoaringContainer::ARRAY && other.type == RoaringContainer::BITMAP) {
+        RoaringContainer result = other;
+        std::swap(a, result);
+        // result now holds the array to add
+        for (size_t i = 0; i < result.values.size(); ++i) {
+            const uint16_t value = result.values[i];
+            a.cardinality += !wordsTest(a.words, value);
+            a.words[value / 64] |= static_cast<uint64_t>(1) << (value % 64);
+        }
+        return;
+    }
+    toBitmap(a);
+    if (other.type == RoaringContainer::ARRAY) {
+        for (size_t i = 0; i < other.values.size(); ++i) {
+            const uint16_t value = other.values[i];
+            a.cardinality += !wordsTest(a.words, value);
+            a.words[value / 64] |= static_cast<uint64_t>(1) << (value % 64);
+        }
+    } else {
+        combineWords<OpOr>(a.words.data(), a.words.data(), other.words.data(), ROARING_BITMAP_WORDS);
+        recount(a);
+    }
+    // two arrays with many values in common
+    normalize(a);
+}
+
+inline void andNotContainers(RoaringContainer& a, const RoaringContainer& b) {
+    RoaringContainer scratch;
+    const RoaringContainer& other = materialized(b, scratch);
+    materialize(a);
+    if (a.type == RoaringContainer::ARRAY && other.type == RoaringContainer::ARRAY) {
+        std::vector<uint16_t> values(a.values.size() + ROARING_ARRAY_PADDING);
+        values.resize(differenceArrays(a.values.data(), a.values.size(),
+            other.values.data(), other.values.size(), values.data()));
+        a.values.swap(values);
+        a.cardinality = static_cast<uint32_t>(a.values.size());
+    } else if (a.type == RoaringContainer::ARRAY) {
+        filterArray(a, other.words, false);
+    } else if (other.type == RoaringContainer::ARRAY) {
+        for (size_t i = 0; i < other.values.size(); ++i) {
+            const uint16_t value = other.values[i];
+            a.cardinality -= wordsTest(a.words, value);
+            a.words[value / 64] &= ~(static_cast<uint64_t>(1) << (value % 64));
+        }
+        normalize(a);
+    } else {
+        combineWords<OpAndNot>(a.words.data(), a.words.data(), other.words.data(), ROARING_BITMAP_WORDS);
+        recount(a);
+        normalize(a);
+    }
+}
+
+inline size_t andCountContainers(const RoaringContainer& a, const RoaringContainer& b) {
+    RoaringContainer scratchA;
+    RoaringContainer scratchB;
+    const RoaringContainer& x = materialized(a, scratchA);
+    const RoaringContainer& y = materialized(b, scratchB);
+    if (x.type == RoaringContainer::ARRAY && y.type == RoaringContainer::ARRAY) {
+        return intersectArrays(x.values.data(), x.values.size(), y.values.data(), y.values.size(), nullptr);
+    }
+    if (x.type == RoaringContainer::BITMAP && y.type == RoaringContainer::BITMAP) {
+        return countWords<OpAnd>(x.words.data(), y.words.data(), ROARING_BITMAP_WORDS);
+    }
+    const RoaringContainer& array = x.type == RoaringContainer::ARRAY ? x : y;
+    const RoaringContainer& bitmap = x.type == RoaringContainer::ARRAY ? y : x;
+    size_t n = 0;
+    for (size_t i = 0; i < array.values.size(); ++i) {
+        n += wordsTest(bitmap.words, array.values[i]);
+    }
+    return n;
+}
+
+inline bool containersEqual(const RoaringContainer& a, const RoaringContainer& b) {
+    if (a.cardinality != b.cardinality) {
+        return false;
+    }
+    if (a.type == b.type) {
+        // each type has one form for a given set of values
+        return a.type == RoaringContainer::BITMAP ? a.words == b.words : a.values == b.values;
+    }
+    return andCountContainers(a, b) == a.cardinality;
+}
+
+}
+
+/**
+ * A compressed set of 32-bit integers, with the member names of Bitset: bit
+ * i is set if i is in the set.
+ */
+class RoaringBitmap {
+public:
+    RoaringBitmap() {}
+
+    /** The set bits of the first size bits of words. */
+    RoaringBitmap(const uint64_t* words, size_t size) {
+        const size_t chunkBits = detail::ROARING_BITMAP_WORDS * 64;
+        for (size_t begin = 0; begin < size; begin += chunkBits) {
+            const size_t bits = std::min(chunkBits, size - begin);
+            const uint64_t* chunk = words + begin / 64;
+            const size_t n = detail::bitsetWords(bits);
+            if (!detail::anyWords<detail::OpFirst>(chunk, chunk, n)) {
+                continue;
+            }
+            detail::RoaringContainer c;
+            c.type = detail::RoaringContainer::BITMAP;
+            c.words.assign(detail::ROARING_BITMAP_WORDS, 0);
+            std::copy(chunk, chunk + n, c.words.begin());
+            c.words[n - 1] &= detail::lastWordMask(bits);
+            detail::recount(c);
+            if (c.cardinality == 0) {
+                continue;
+            }
+            detail::normalize(c);
+            keys_.push_back(static_cast<uint16_t>(begin >> 16));
+            containers_.push_back(std::move(c));
+        }
+    }
+
+    explicit RoaringBitmap(const Bitset& bits) : RoaringBitmap(bits.data(), bits.size()) {}
+
+    bool test(uint32_t i) const {
+        const size_t k = findKey(static_cast<uint16_t>(i >> 16));
+        return k < keys_.size() && keys_[k] == (i >> 16)
+            && detail::containerTest(containers_[k], static_cast<uint16_t>(i));
+    }
+
+    bool operator[](uint32_t i) const { return test(i); }
+
+    RoaringBitmap& set(uint32_t i) {
+        detail::RoaringContainer& c = container(static_cast<uint16_t>(i >> 16));
+        const uint16_t value = static_cast<uint16_t>(i);
+        detail::materialize(c);
+        if (c.type == detail::RoaringContainer::ARRAY) {
+            const std::vector<uint16_t>::iterator it = std::lower_bound(c.values.begin(), c.values.end(), value);
+            if (it == c.values.end() || *it != value) {
+                c.values.insert(it, value);
+                ++c.cardinality;
+                detail::normalize(c);
+            }
+        } else {
+            c.cardinality += !detail::wordsTest(c.words, value);
+            c.words[value / 64] |= static_cast<uint64_t>(1) << (value % 64);
+        }
+        return *this;
+    }
+
+    RoaringBitmap& reset(uint32_t i) {
+        const size_t k = findKey(static_cast<uint16_t>(i >> 16));
+        if (k == keys_.size() || keys_[k] != (i >> 16)) {
+            return *this;
+        }
+        detail::RoaringContainer& c = containers_[k];
+        const uint16_t value = static_cast<uint16_t>(i);
+        detail::materialize(c);
+        if (c.type == detail::RoaringContainer::ARRAY) {
+            const std::vector<uint16_t>::iterator it = std::lower_bound(c.values.begin(), c.values.end(), value);
+            if (it != c.values.end() && *it == value) {
+                c.values.erase(it);
+                --c.cardinality;
+            }
+        } else {
+            c.cardinality -= detail::wordsTest(c.words, value);
+            c.words[value / 64] &= ~(static_cast<uint64_t>(1) << (value % 64));
+            detail::normalize(c);
+        }
+        if (c.cardinality == 0) {
+            erase(k);
+        }
+        return *this;
+    }
+
+    /** Set the bits in [begin, end), for end <= 2^32. */
+    RoaringBitmap& setRange(uint64_t begin, uint64_t end) {
+        while (begin < end) {
+            const uint16_t key = static_cast<uint16_t>(begin >> 16);
+            const uint64_t chunkEnd = std::min(end, (static_cast<uint64_t>(key) + 1) << 16);
+            detail::RoaringContainer& c = container(key);
+            detail::toBitmap(c);
+            detail::setWordRange(c.words.data(), static_cast<uint32_t>(begin & 0xFFFF),
+                static_cast<uint32_t>(chunkEnd - (static_cast<uint64_t>(key) << 16)));
+            detail::recount(c);
+            detail::normalize(c);
+            begin = chunkEnd;
+        }
+        return *this;
+    }
+
+    /** The number of set bits. */
+    size_t count() const {
+        size_t n = 0;
+        for (size_t k = 0; k < containers_.size(); ++k) {
+            n += containers_[k].cardinality;
+        }
+        return n;
+    }
+
+    bool any() const { return !containers_.empty(); }
+
+    bool none() const { return containers_.empty(); }
+
+    /**
+     * Store each chunk as runs where that takes less memory than an array or
+     * bitmap. Runs are kept until the chunk is modified.
+     */
+    RoaringBitmap& runOptimize() {
+        for (size_t k = 0; k < containers_.size(); ++k) {
+            detail::runOptimize(containers_[k]);
+        }
+        return *this;
+    }
+
+    /** Bytes of keys and container contents. */
+    size_t memoryBytes() const {
+        size_t bytes = keys_.size() * sizeof(uint16_t);
+        for (size_t k = 0; k < containers_.size(); ++k) {
+            bytes += containers_[k].values.size() * sizeof(uint16_t)
+                + containers_[k].words.size() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    /** Call fn(i) for each set bit i, in increasing order. */
+    template<typename Fn>
+    void forEachSetBit(Fn fn) const {
+        for (size_t k = 0; k < containers_.size(); ++k) {
+            const detail::RoaringContainer& c = containers_[k];
+            const uint32_t base = static_cast<uint32_t>(keys_[k]) << 16;
+            if (c.type == detail::RoaringContainer::ARRAY) {
+                for (size_t i = 0; i < c.values.size(); ++i) {
+                    fn(base | c.values[i]);
+                }
+            } else if (c.type == detail::RoaringContainer::BITMAP) {
+                bits::forEachSetBit(c.words.data(), detail::ROARING_BITMAP_WORDS, [&](size_t i) {
+                    fn(base | static_cast<uint32_t>(i));
+                });
+            } else {
+                for (size_t r = 0; r < c.values.size(); r += 2) {
+                    for (uint32_t v = c.values[r]; v <= c.values[r] + c.values[r + 1]; ++v) {
+                        fn(base | v);
+                    }
+                }
+            }
+        }
+    }
+
+    /** Write the set bits to out in increasing order; out needs room for count(). */
+    size_t setBitIndexes(uint32_t* out) const {
+        uint32_t* const begin = out;
+        for (size_t k = 0; k < containers_.size(); ++k) {
+            const detail::RoaringContainer& c = containers_[k];
+            const uint32_t base = static_cast<uint32_t>(keys_[k]) << 16;
+            if (c.type == detail::RoaringContainer::BITMAP) {
+                bits::setBitIndexes(c.words.data(), detail::ROARING_BITMAP_WORDS, out);
+                for (uint32_t i = 0; i < c.cardinality; ++i) {
+                    out[i] |= base;
+                }
+                out += c.cardinality;
+            } else if (c.type == detail::RoaringContainer::ARRAY) {
+                for (size_t i = 0; i < c.values.size(); ++i) {
+                    *out++ = base | c.values[i];
+                }
+            } else {
+                for (size_t r = 0; r < c.values.size(); r += 2) {
+                    for (uint32_t v = c.values[r]; v <= c.values[r] + c.values[r + 1]; ++v) {
+                        *out++ = base | v;
+                    }
+                }
+            }
+        }
+        return static_cast<size_t>(out - begin);
+    }
+
+    RoaringBitmap& operator&=(const RoaringBitmap& other) {
+        size_t n = 0;
+        size_t j = 0;
+        for (size_t k = 0; k < keys_.size(); ++k) {
+            while (j < other.keys_.size() && other.keys_[j] < keys_[k]) {
+                ++j;
+            }
+            if (j == other.keys_.size() || other.keys_[j] != keys_[k]) {
+                continue;
+            }
+            detail::andContainers(containers_[k], other.containers_[j]);
+            if (containers_[k].cardinality != 0) {
+                keep(n++, k);
+            }
+        }
+        truncate(n);
+        return *this;
+    }
+
+    RoaringBitmap& operator|=(const RoaringBitmap& other) {
+        std::vector<uint16_t> keys;
+        std::vector<detail::RoaringContainer> containers;
+        keys.reserve(keys_.size() + other.keys_.size());
+        containers.reserve(keys_.size() + other.keys_.size());
+        size_t k = 0;
+        size_t j = 0;
+        while (k < keys_.size() || j < other.keys_.size()) {
+            if (j == other.keys_.size() || (k < keys_.size() && keys_[k] < other.keys_[j])) {
+                keys.push_back(keys_[k]);
+                containers.push_back(std::move(containers_[k++]));
+            } else if (k == keys_.size() || other.keys_[j] < keys_[k]) {
+                keys.push_back(other.keys_[j]);
+                containers.push_back(other.containers_[j++]);
+            } else {
+                detail::orContainers(containers_[k], other.containers_[j++]);
+                keys.push_back(keys_[k]);
+                containers.push_back(std::move(containers_[k++]));
+            }
+        }
+        keys_.swap(keys);
+        containers_.swap(containers);
+        return *this;
+    }
+
+    /** Clear the bits that are set in other. */
+    RoaringBitmap& andNot(const RoaringBitmap& other) {
+        size_t n = 0;
+        size_t j = 0;
+        for (size_t k = 0; k < keys_.size(); ++k) {
+            while (j < other.keys_.size() && other.keys_[j] < keys_[k]) {
+                ++j;
+            }
+            if (j < other.keys_.size() && other.keys_[j] == keys_[k]) {
+                detail::andNotContainers(containers_[k], other.containers_[j]);
+            }
+            if (containers_[k].cardinality != 0) {
+                keep(n++, k);
+            }
+        }
+        truncate(n);
+        return *this;
+    }
+
+    friend RoaringBitmap operator&(RoaringBitmap a, const RoaringBitmap& b) {
+        a &= b;
+        return a;
+    }
+
+    friend RoaringBitmap operator|(RoaringBitmap a, const RoaringBitmap& b) {
+        a |= b;
+        return a;
+    }
+
+    friend bool operator==(const RoaringBitmap& a, const RoaringBitmap& b) {
+        if (a.keys_ != b.keys_) {
+            return false;
+        }
+        for (size_t k = 0; k < a.containers_.size(); ++k) {
+            if (!detail::containersEqual(a.containers_[k], b.containers_[k])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    friend bool operator!=(const RoaringBitmap& a, const RoaringBitmap& b) { return !(a == b); }
+
+    /** |a & b|, without building a & b. */
+    friend size_t andCount(const RoaringBitmap& a, const RoaringBitmap& b) {
+        size_t n = 0;
+        size_t j = 0;
+        for (size_t k = 0; k < a.keys_.size(); ++k) {
+            while (j < b.keys_.size() && b.keys_[j] < a.keys_[k]) {
+                ++j;
+            }
+            if (j < b.keys_.size() && b.keys_[j] == a.keys_[k]) {
+                n += detail::andCountContainers(a.containers_[k], b.containers_[j]);
+            }
+        }
+        return n;
+    }
+
+    /** |a | b|, without building a | b. */
+    friend size_t orCount(const RoaringBitmap& a, const RoaringBitmap& b) {
+        return a.count() + b.count() - andCount(a, b);
+    }
+
+    /** |a & ~b|, without building a & ~b. */
+    friend size_t andNotCount(const RoaringBitmap& a, const RoaringBitmap& b) {
+        return a.count() - andCount(a, b);
+    }
+
+private:
+    /** The index of the first key >= key. */
+    size_t findKey(uint16_t key) const {
+        return static_cast<size_t>(std::lower_bound(keys_.begin(), keys_.end(), key) - keys_.begin());
+    }
+
+    /** The container for key, added empty if there is none. */
+    detail::RoaringContainer& container(uint16_t key) {
+        const size_t k = findKey(key);
+        if (k == keys_.size() || keys_[k] != key) {
+            keys_.insert(keys_.begin() + static_cast<std::ptrdiff_t>(k), key);
+            containers_.insert(containers_.begin() + static_cast<std::ptrdiff_t>(k), detail::RoaringContainer());
+        }
+        return containers_[k];
+    }
+
+    void erase(size_t k) {
+        keys_.erase(keys_.begin() + static_cast<std::ptrdiff_t>(k));
+        containers_.erase(containers_.begin() + static_cast<std::ptrdiff_t>(k));
+    }
+
+    /** Move chunk k to position n, for n <= k. */
+    void keep(size_t n, size_t k) {
+        if (n != k) {
+            keys_[n] = keys_[k];
+            containers_[n] = std::move(containers_[k]);
+        }
+    }
+
+    void truncate(size_t n) {
+        keys_.resize(n);
+        containers_.resize(n);
+    }
+
+    std::vector<uint16_t> keys_;
+    std::vector<detail::RoaringContainer> containers_;
+};
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include "doctest.h"
+#include "atomic_bits.hpp"
+#include <cinttypes>
+#include <thread>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+typedef Field<32, 0> RefCount;
+typedef Field<8, 32> State;
+typedef Field<24, 40, int32_t> Epoch;
+
+}
+
+TEST_CASE("Atomic bit and field updates.") {
+    std::atomic<uint64_t> word(0);
+    REQUIRE_FALSE(atomicSetBit<63>(word));
+    REQUIRE(atomicSetBit<63>(word));
+    REQUIRE(word.load() == 0x8000000000000000ULL);
+
+    REQUIRE(atomicSetBits<24, 40>(word, -2) == 0x8000000000000000ULL);
+    REQUIRE(atomicGetSbits<24, 40, int32_t>(word) == -2);
+    REQUIRE(atomicGetUbits<24, 40>(word) == 0xFFFFFE);
+    REQUIRE(atomicClearBit<63>(word, std::memory_order_acq_rel));
+    REQUIRE_FALSE(atomicClearBit<63>(word));
+    REQUIRE(word.load() == 0x7FFFFE0000000000ULL);
+}
+
+TEST_CASE("compareExchangeFields compares only the given fields.") {
+    std::atomic<uint64_t> word(Layout<uint64_t, RefCount, State, Epoch>::pack(7, 1, -5));
+
+    std::tuple<uint64_t, int32_t> expected(1, -5);
+    REQUIRE(compareExchangeFields<State, Epoch>(word, expected, std::make_tuple(uint64_t(2), -4)));
+    REQUIRE(getField<RefCount>(word.load()) == 7);
+    REQUIRE(getField<State>(word.load()) == 2);
+    REQUIRE(getField<Epoch>(word.load()) == -4);
+
+    // a stale expectation fails and is refreshed with the current values
+    REQUIRE_FALSE(compareExchangeFields<State, Epoch>(word, expected, std::make_tuple(uint64_t(3), 0)));
+    REQUIRE(expected == std::make_tuple(uint64_t(2), -4));
+    REQUIRE(getField<State>(word.load()) == 2);
+}
+
+TEST_CASE("Concurrent updates of different fields of one word.") {
+    const unsigned UPDATES = 20000;
+    std::atomic<uint64_t> word(0);
+    std::atomic<unsigned> failedExchanges(0);
+
+    // each thread owns a 15-bit counter and the flag bit above it
+    std::vector<std::thread> threads;
+    threads.push_back(std::thread([&] {
+        for (unsigned i = 1; i <= UPDATES; ++i) {
+            atomicSetBits<15, 0>(word, i);
+            atomicSetBit<15>(word);
+        }
+    }));
+    threads.push_back(std::thread([&] {
+        for (unsigned i = 1; i <= UPDATES; ++i) {
+            atomicSetBits<15, 16>(word, i, std::memory_order_release);
+            atomicSetBit<31>(word, std::memory_order_relaxed);
+        }
+    }));
+    threads.push_back(std::thread([&] {
+        for (unsigned i = 1; i <= UPDATES; ++i) {
+            atomicSetBits<15, 32>(word, i);
+            atomicClearBit<47>(word);
+        }
+    }));
+    threads.push_back(std::thread([&] {
+        for (unsigned i = 1; i <= UPDATES; ++i) {
+            std::tuple<uint64_t> expected(i - 1);
+            if (!compareExchangeFields<Field<15, 48>>(word, expected, std::make_tuple(uint64_t(i)))) {
+                ++failedExchanges;
+            }
+        }
+    }));
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+
+    const uint64_t final = word.load();
+    REQUIRE(failedExchanges.load() == 0);
+    REQUIRE(getUbits<15, 0>(final) == UPDATES);
+    REQUIRE(getBit<15>(final));
+    REQUIRE(getUbits<15, 16>(final) == UPDATES);
+    REQUIRE(getBit<31>(final));
+    REQUIRE(getUbits<15, 32>(final) == UPDATES);
+    REQUIRE_FALSE(getBit<47>(final));
+    REQUIRE(getUbits<15, 48>(final) == UPDATES);
+}
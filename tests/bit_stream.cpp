@@ -0,0 +1,170 @@
+#include "doctest.h"
+#include "bit_stream.hpp"
+#include "test_util.hpp"
+#include <cinttypes>
+#include <utility>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+struct Item {
+    unsigned width;
+    uint64_t value;
+};
+
+std::vector<Item> testItems(size_t n) {
+    std::vector<Item> items;
+    test::Random random(0);
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t x = random.next();
+        const unsigned width = static_cast<unsigned>(x % 64) + 1;
+        const uint64_t value = (x * 0xD6E8FEB86659FD93ULL) & (~0ULL >> (64 - width));
+        Item item = { width, value };
+        items.push_back(item);
+    }
+    return items;
+}
+
+template<typename Order>
+void checkRoundTrip(size_t n) {
+    const std::vector<Item> items = testItems(n);
+    BitWriter<Order> writer;
+    size_t bits = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        writer.put(items[i].width, items[i].value);
+        bits += items[i].width;
+    }
+    REQUIRE(writer.bitCount() == bits);
+    const std::vector<unsigned char>& bytes = writer.finish();
+    REQUIRE(bytes.size() == (bits + 7) / 8);
+
+    BitReader<Order> reader(bytes.data(), bytes.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].width <= BitReader<Order>::MAX_PEEK) {
+            REQUIRE(reader.peek(items[i].width) == items[i].value);
+        }
+        REQUIRE(reader.get(items[i].width) == items[i].value);
+    }
+    REQUIRE(reader.bitPosition() == bits);
+    REQUIRE(!reader.overrun());
+}
+
+// Wide fields split into two chunks must also drop the bits above width.
+template<typename Order>
+void checkUnmaskedWide() {
+    const uint64_t values[] = { ~0ULL, 0xD6E8FEB86659FD93ULL };
+    for (unsigned width = 57; width < 64; ++width) {
+        for (size_t v = 0; v < 2; ++v) {
+            const uint64_t mask = ~0ULL >> (64 - width);
+            BitWriter<Order> writer;
+            writer.put(width, values[v]);
+            writer.put(4, 0);
+            writer.template put<60>(values[v]);
+            writer.template put<4>(0xA);
+            const std::vector<unsigned char>& bytes = writer.finish();
+
+            BitReader<Order> reader(bytes.data(), bytes.size());
+            REQUIRE(reader.get(width) == (values[v] & mask));
+            REQUIRE(reader.get(4) == 0);
+            REQUIRE(reader.get(60) == (values[v] & (~0ULL >> 4)));
+            REQUIRE(reader.get(4) == 0xA);
+            REQUIRE(!reader.overrun());
+        }
+    }
+}
+
+}
+
+TEST_CASE("BitWriter and BitReader round trip.") {
+    checkRoundTrip<LsbFirst>(1);
+    checkRoundTrip<LsbFirst>(5000);
+    checkRoundTrip<MsbFirst>(1);
+    checkRoundTrip<MsbFirst>(5000);
+}
+
+TEST_CASE("BitWriter truncates wide values to their width.") {
+    checkUnmaskedWide<LsbFirst>();
+    checkUnmaskedWide<MsbFirst>();
+}
+
+TEST_CASE("BitWriter bit orders.") {
+    BitWriter<LsbFirst> lsb;
+    lsb.put<3>(5);
+    lsb.put<7>(0x41);
+    lsb.put<6>(0x3F);
+    const std::vector<unsigned char>& lsbBytes = lsb.finish();
+    REQUIRE(lsbBytes.size() == 2);
+    REQUIRE(lsbBytes[0] == 0x0D);   // 1 | 0x41 << 3, truncated
+    REQUIRE(lsbBytes[1] == 0xFE);
+
+    BitWriter<MsbFirst> msb;
+    msb.put<4>(4);              // IPv4 version
+    msb.put<4>(5);              // IHL
+    msb.put<16>(0x0102);
+    msb.put<3>(0xFF);           // truncated to 3 bits
+    const std::vector<unsigned char>& msbBytes = msb.finish();
+    REQUIRE(msbBytes.size() == 4);
+    REQUIRE(msbBytes[0] == 0x45);
+    REQUIRE(msbBytes[1] == 0x01);
+    REQUIRE(msbBytes[2] == 0x02);
+    REQUIRE(msbBytes[3] == 0xE0);
+}
+
+TEST_CASE("BitWriter copies and moves mid-stream.") {
+    BitWriter<LsbFirst> a;
+    a.put<8>(0x11);
+    a.put<4>(0x5);
+    BitWriter<LsbFirst> b(a);
+    a.put<4>(0x3);
+    b.put<4>(0x2);
+    REQUIRE(a.finish() == std::vector<unsigned char>({ 0x11, 0x35 }));
+    REQUIRE(b.finish() == std::vector<unsigned char>({ 0x11, 0x25 }));
+
+    BitWriter<LsbFirst> c;
+    c.put<8>(0x77);
+    c = b;
+    c.put<8>(0x44);
+    b.put<8>(0x66);
+    REQUIRE(c.finish() == std::vector<unsigned char>({ 0x11, 0x25, 0x44 }));
+    REQUIRE(b.finish() == std::vector<unsigned char>({ 0x11, 0x25, 0x66 }));
+
+    BitWriter<LsbFirst> d(std::move(c));
+    d.put<8>(0x55);
+    REQUIRE(d.finish() == std::vector<unsigned char>({ 0x11, 0x25, 0x44, 0x55 }));
+    BitWriter<LsbFirst> e;
+    e = std::move(d);
+    e.put<4>(0x9);
+    REQUIRE(e.finish() == std::vector<unsigned char>({ 0x11, 0x25, 0x44, 0x55, 0x09 }));
+
+    // a moved-from writer starts over
+    d.put<8>(0xAB);
+    REQUIRE(d.finish() == std::vector<unsigned char>(1, 0xAB));
+}
+
+TEST_CASE("BitReader skip, alignment and overrun.") {
+    BitWriter<MsbFirst> writer;
+    for (unsigned i = 0; i < 40; ++i) {
+        writer.put<6>(i);
+    }
+    writer.put<3>(7);
+    writer.alignToByte();
+    writer.put<8>(0xA5);
+    const std::vector<unsigned char>& bytes = writer.finish();
+    REQUIRE(bytes.size() == 32);
+
+    BitReader<MsbFirst> reader(bytes.data(), bytes.size());
+    reader.skip(6);
+    REQUIRE(reader.get<6>() == 1);
+    reader.skip(6 * 30);
+    REQUIRE(reader.get<6>() == 32);
+    reader.skip(6 * 7);
+    REQUIRE(reader.peek<3>() == 7);
+    reader.skip(3);
+    reader.alignToByte();
+    REQUIRE(reader.get<8>() == 0xA5);
+    REQUIRE(!reader.overrun());
+    REQUIRE(reader.get<4>() == 0);
+    REQUIRE(reader.overrun());
+}
@@ -0,0 +1,123 @@
+#include "doctest.h"
+#include "bitmap_allocator.hpp"
+#include "test_util.hpp"
+#include <atomic>
+#include <cinttypes>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace bits;
+
+TEST_CASE("BitmapAllocator returns the lowest free slot.") {
+    // up to four levels: 262145 slots need 4097, 65, 2 and 1 words
+    const size_t capacities[] = { 0, 1, 64, 65, 4096, 4097, 262145 };
+    for (size_t c = 0; c < 7; ++c) {
+        const size_t capacity = capacities[c];
+        BitmapAllocator allocator(capacity);
+        REQUIRE(allocator.capacity() == capacity);
+        for (size_t i = 0; i < capacity; ++i) {
+            REQUIRE(allocator.allocate() == i);
+        }
+        REQUIRE(allocator.allocate() == capacity);
+        REQUIRE(allocator.count() == capacity);
+
+        // random frees and allocations against a set of the free slots
+        std::set<size_t> free;
+        test::Random random(c);
+        for (unsigned step = 0; step < 20000 && capacity > 0; ++step) {
+            const uint64_t x = random.next();
+            const size_t slot = static_cast<size_t>(x % capacity);
+            if (x % 3 != 0) {
+                REQUIRE(allocator.free(slot) == (free.count(slot) == 0));
+                free.insert(slot);
+            } else {
+                const size_t expected = free.empty() ? capacity : *free.begin();
+                REQUIRE(allocator.allocate() == expected);
+                free.erase(expected);
+            }
+            REQUIRE(allocator.test(slot) == (free.count(slot) == 0));
+        }
+        REQUIRE(allocator.count() == capacity - free.size());
+
+        allocator.clear();
+        REQUIRE(allocator.count() == 0);
+        REQUIRE(allocator.allocate() == 0);
+    }
+}
+
+TEST_CASE("BitmapAllocator ignores slots past its capacity.") {
+    BitmapAllocator allocator(10);
+    for (size_t i = 0; i < 10; ++i) {
+        REQUIRE(allocator.allocate() == i);
+    }
+    REQUIRE(!allocator.free(10));
+    REQUIRE(!allocator.free(12));
+    REQUIRE(!allocator.free(64));
+    REQUIRE(!allocator.free(1000));
+    REQUIRE(allocator.allocate() == 10);
+    REQUIRE(allocator.count() == 10);
+}
+
+TEST_CASE("AtomicBitmapAllocator hands each slot to one thread at a time.") {
+    const size_t CAPACITY = 5000;
+    const unsigned THREADS = 4;
+    AtomicBitmapAllocator allocator(CAPACITY);
+    std::vector<std::atomic<unsigned>> owners(CAPACITY);
+    for (size_t i = 0; i < CAPACITY; ++i) {
+        owners[i].store(0);
+    }
+    std::atomic<unsigned> conflicts(0);
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < THREADS; ++t) {
+        threads.push_back(std::thread([&, t] {
+            std::vector<size_t> held;
+            test::Random random(t);
+            for (unsigned step = 0; step < 50000; ++step) {
+                const uint64_t x = random.next();
+                // keep each thread near a quarter of the slots so the pool runs full
+                if (held.size() < CAPACITY / THREADS + 10 && x % 2 == 0) {
+                    const size_t slot = allocator.allocate();
+                    if (slot == CAPACITY) {
+                        continue;
+                    }
+                    if (owners[slot].exchange(t + 1) != 0) {
+                        ++conflicts;
+                    }
+                    held.push_back(slot);
+                } else if (!held.empty()) {
+                    const size_t i = static_cast<size_t>(x % held.size());
+                    const size_t slot = held[i];
+                    held[i] = held.back();
+                    held.pop_back();
+                    if (owners[slot].exchange(0) != t + 1) {
+                        ++conflicts;
+                    }
+                    if (!allocator.free(slot)) {
+                        ++conflicts;
+                    }
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    REQUIRE(conflicts.load() == 0);
+
+    size_t held = 0;
+    for (size_t i = 0; i < CAPACITY; ++i) {
+        held += owners[i].load() != 0;
+        REQUIRE(allocator.test(i) == (owners[i].load() != 0));
+    }
+    REQUIRE(allocator.count() == held);
+
+    // the summaries must still lead to every free slot
+    for (size_t i = held; i < CAPACITY; ++i) {
+        const size_t slot = allocator.allocate();
+        REQUIRE(slot < CAPACITY);
+        REQUIRE(owners[slot].exchange(1) == 0);
+    }
+    REQUIRE(allocator.allocate() == CAPACITY);
+}
@@ -0,0 +1,228 @@
+#include "doctest.h"
+#include "bitset.hpp"
+#include "test_util.hpp"
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+size_t referenceCount(const Bitset& set) {
+    size_t count = 0;
+    for (size_t i = 0; i < set.size(); ++i) {
+        count += set.test(i);
+    }
+    return count;
+}
+
+template<typename Op>
+void checkKernels(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b) {
+    const size_t n = a.size();
+    std::vector<uint64_t> expected(n);
+    detail::combinePortable<Op>(expected.data(), a.data(), b.data(), n);
+    const size_t expectedCount = detail::countPortable<Op>(a.data(), b.data(), n);
+    const bool expectedAny = detail::anyPortable<Op>(a.data(), b.data(), n);
+#if defined(BITS_X86)
+    const CpuFeatures& cpu = cpuFeatures();
+    std::vector<uint64_t> actual(n);
+    if (cpu.popcnt) {
+        REQUIRE(detail::countPopcnt<Op>(a.data(), b.data(), n) == expectedCount);
+    }
+    if (cpu.avx2 && cpu.popcnt) {
+        detail::combineAvx2<Op>(actual.data(), a.data(), b.data(), n);
+        REQUIRE(actual == expected);
+        REQUIRE(detail::countAvx2<Op>(a.data(), b.data(), n) == expectedCount);
+        REQUIRE(detail::anyAvx2<Op>(a.data(), b.data(), n) == expectedAny);
+    }
+    if (cpu.avx512f) {
+        detail::combineAvx512<Op>(actual.data(), a.data(), b.data(), n);
+        REQUIRE(actual == expected);
+        REQUIRE(detail::anyAvx512<Op>(a.data(), b.data(), n) == expectedAny);
+    }
+    if (cpu.avx512f && cpu.avx512vpopcntdq && cpu.popcnt) {
+        REQUIRE(detail::countAvx512<Op>(a.data(), b.data(), n) == expectedCount);
+    }
+#else
+    (void)expectedCount;
+    (void)expectedAny;
+#endif
+}
+
+}
+
+TEST_CASE("Bitset operations agree with bit-by-bit results.") {
+    const size_t sizes[] = { 0, 1, 63, 64, 65, 1000, 1024, 5003 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        const size_t size = sizes[s];
+        const Bitset a = test::randomBits(size, 3, 1);
+        const Bitset b = test::randomBits(size, 5, 2);
+        const Bitset both = a & b;
+        const Bitset either = a | b;
+        const Bitset diff = a ^ b;
+        Bitset onlyA = a;
+        onlyA.andNot(b);
+        for (size_t i = 0; i < size; ++i) {
+            REQUIRE(both[i] == (a[i] && b[i]));
+            REQUIRE(either[i] == (a[i] || b[i]));
+            REQUIRE(diff[i] == (a[i] != b[i]));
+            REQUIRE(onlyA[i] == (a[i] && !b[i]));
+        }
+        REQUIRE(a.count() == referenceCount(a));
+        REQUIRE(andCount(a, b) == referenceCount(both));
+        REQUIRE(orCount(a, b) == referenceCount(either));
+        REQUIRE(xorCount(a, b) == referenceCount(diff));
+        REQUIRE(andNotCount(a, b) == referenceCount(onlyA));
+        REQUIRE(intersects(a, b) == both.any());
+        REQUIRE((a == b) == (referenceCount(diff) == 0));
+        REQUIRE(a == Bitset(a));
+    }
+}
+
+TEST_CASE("Bitset set, flip, resize and the bits past the end.") {
+    Bitset set(70, true);
+    REQUIRE(set.count() == 70);
+    REQUIRE(set.all());
+    REQUIRE(set.data()[1] == 0x3F);
+
+    set.flip();
+    REQUIRE(set.none());
+    set.flip(69).set(3, true).set(64);
+    REQUIRE(set.count() == 3);
+
+    set.resize(66);
+    REQUIRE(set.count() == 2);
+    REQUIRE(set.data()[1] == 1);
+    set.resize(130, true);
+    REQUIRE(set.count() == 2 + 64);
+    REQUIRE_FALSE(set[65]);
+    REQUIRE(set[66]);
+    REQUIRE(set[129]);
+    REQUIRE(set.data()[2] == 0x3);
+
+    set.reset();
+    REQUIRE(set.none());
+    REQUIRE(set != Bitset(130, true));
+    REQUIRE(set != Bitset(131));
+}
+
+TEST_CASE("FixedBitset.") {
+    FixedBitset<100> a;
+    FixedBitset<100> b;
+    REQUIRE(a.size() == 100);
+    REQUIRE(FixedBitset<100>::WORDS == 2);
+    a.set(1).set(64).set(99);
+    b.set(64).set(98);
+    REQUIRE(andCount(a, b) == 1);
+    REQUIRE(xorCount(a, b) == 3);
+    REQUIRE((a | b).count() == 4);
+    b.set();
+    REQUIRE(b.count() == 100);
+    REQUIRE(a != b);
+    b &= a;
+    REQUIRE(a == b);
+
+    // big enough to use the kernels
+    FixedBitset<4096> big;
+    big.set();
+    REQUIRE(big.all());
+    big.reset(4095);
+    REQUIRE(big.count() == 4095);
+    REQUIRE(intersects(big, big));
+}
+
+TEST_CASE("Bitset kernels agree with the portable loops.") {
+    for (size_t n = 0; n < 70; n += 3) {
+        std::vector<uint64_t> a(n);
+        std::vector<uint64_t> b(n);
+        test::Random random(n);
+        for (size_t i = 0; i < n; ++i) {
+            a[i] = random.next();
+            b[i] = random.next();
+        }
+        checkKernels<detail::OpFirst>(a, b);
+        checkKernels<detail::OpAnd>(a, b);
+        checkKernels<detail::OpOr>(a, b);
+        checkKernels<detail::OpXor>(a, b);
+        checkKernels<detail::OpAndNot>(a, b);
+
+        // any must also find a single bit anywhere, including in the tail
+        std::vector<uint64_t> zero(n);
+        for (size_t i = 0; i < n; ++i) {
+            zero[i] = static_cast<uint64_t>(1) << (i % 64);
+            checkKernels<detail::OpAnd>(zero, zero);
+            zero[i] = 0;
+        }
+    }
+}
+
+TEST_CASE("Iterating over set bits.") {
+    std::vector<size_t> seen;
+    forEachSetBit(0x8000000000000005ULL, [&](unsigned pos) { seen.push_back(pos); });
+    REQUIRE(seen == std::vector<size_t>({ 0, 2, 63 }));
+
+    const Bitset set = test::randomBits(3000, 7, 3);
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < set.size(); ++i) {
+        if (set[i]) {
+            expected.push_back(i);
+        }
+    }
+
+    seen.clear();
+    set.forEachSetBit([&](size_t i) { seen.push_back(i); });
+    REQUIRE(seen == expected);
+
+    seen.clear();
+    for (size_t i = set.findFirst(); i < set.size(); i = set.findNext(i + 1)) {
+        seen.push_back(i);
+    }
+    REQUIRE(seen == expected);
+
+    for (size_t from = 0; from < set.size(); from += 37) {
+        size_t clear = from;
+        while (clear < set.size() && set[clear]) {
+            ++clear;
+        }
+        REQUIRE(set.findNextClear(from) == clear);
+    }
+
+    Bitset full(130, true);
+    REQUIRE(full.findNextClear(0) == 130);
+    full.reset(129);
+    REQUIRE(full.findNextClear(5) == 129);
+    REQUIRE(Bitset(130).findFirst() == 130);
+    REQUIRE(Bitset(130).findNext(500) == 130);
+}
+
+TEST_CASE("setBitIndexes decoders write exactly one index per set bit.") {
+    const unsigned densities[] = { 1, 2, 3, 50 };
+    for (unsigned d = 0; d < 4; ++d) {
+        const Bitset set = test::randomBits(4099, densities[d], d + 10);
+        std::vector<uint32_t> expected;
+        set.forEachSetBit([&](size_t i) { expected.push_back(static_cast<uint32_t>(i)); });
+
+        std::vector<uint32_t> out(set.count() + 1, 0xFFFFFFFF);
+        REQUIRE(set.setBitIndexes(out.data()) == expected.size());
+        REQUIRE(out.back() == 0xFFFFFFFF); // nothing written past the end
+        out.pop_back();
+        REQUIRE(out == expected);
+
+        std::vector<detail::SetBitIndexesFn> kernels(1, &detail::setBitIndexesPortable);
+#if defined(BITS_X86)
+        if (cpuFeatures().avx2 && cpuFeatures().popcnt) {
+            kernels.push_back(&detail::setBitIndexesAvx2);
+        }
+        if (cpuFeatures().avx512f && cpuFeatures().popcnt) {
+            kernels.push_back(&detail::setBitIndexesAvx512);
+        }
+#endif
+        for (size_t k = 0; k < kernels.size(); ++k) {
+            std::vector<uint32_t> actual(expected.size() + 1, 0xFFFFFFFF);
+            kernels[k](set.data(), set.wordCount(), actual.data(), actual.data() + expected.size());
+            REQUIRE(actual.back() == 0xFFFFFFFF);
+            actual.pop_back();
+            REQUIRE(actual == expected);
+        }
+    }
+}
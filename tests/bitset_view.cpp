@@ -0,0 +1,131 @@
+#include "doctest.h"
+#include "bitset_view.hpp"
+#include "test_util.hpp"
+#include <cinttypes>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace bits;
+
+#if defined(BITS_LITTLE_ENDIAN)
+
+namespace {
+
+/** index serialized into 64-byte aligned memory, as a mapping would be. */
+struct Serialized {
+    std::vector<uint64_t> storage;
+
+    explicit Serialized(const RankSelectBitVector& index) {
+        const size_t bytes = BitsetView::bytes(index);
+        REQUIRE(bytes % 64 == 0);
+        storage.resize(bytes / sizeof(uint64_t) + 8);
+        REQUIRE_FALSE(BitsetView::write(index, data(), bytes - 1));
+        REQUIRE(BitsetView::write(index, data(), bytes));
+    }
+
+    unsigned char* data() {
+        const uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+        return reinterpret_cast<unsigned char*>(storage.data()) + (64 - address % 64) % 64;
+    }
+
+    size_t size() const { return (storage.size() - 8) * sizeof(uint64_t); }
+};
+
+}
+
+TEST_CASE("BitsetView answers queries from the serialized bits.") {
+    const size_t sizes[] = { 0, 1, 2048, 100003 };
+    for (size_t s = 0; s < 4; ++s) {
+        const Bitset bits = test::randomBits(sizes[s], 3, s);
+        const RankSelectBitVector index(bits);
+        Serialized file(index);
+        BitsetView view;
+        REQUIRE(BitsetView::parse(file.data(), file.size(), view));
+        REQUIRE(view.size() == bits.size());
+        REQUIRE(view.count() == bits.count());
+        REQUIRE(view.toBitset() == bits);
+
+        size_t rank = 0;
+        for (size_t i = 0; i < bits.size(); ++i) {
+            REQUIRE(view.test(i) == bits[i]);
+            REQUIRE(view.rank1(i) == rank);
+            if (bits[i]) {
+                REQUIRE(view.select1(rank) == i);
+                ++rank;
+            }
+        }
+        REQUIRE(view.rank1(bits.size()) == rank);
+        REQUIRE(view.findNext(0) == bits.findFirst());
+
+        std::vector<uint32_t> expected(bits.count());
+        std::vector<uint32_t> actual(bits.count());
+        bits.setBitIndexes(expected.data());
+        REQUIRE(view.setBitIndexes(actual.data()) == expected.size());
+        REQUIRE(actual == expected);
+        std::vector<uint32_t> visited;
+        view.forEachSetBit([&](size_t i) { visited.push_back(static_cast<uint32_t>(i)); });
+        REQUIRE(visited == expected);
+
+        // against an in-memory bitset of the same size
+        const Bitset other = test::randomBits(sizes[s], 2, s + 100);
+        REQUIRE(andCount(view, other) == andCount(bits, other));
+        REQUIRE(orCount(view, other) == orCount(bits, other));
+        Bitset both = other;
+        both &= view;
+        REQUIRE(both == (bits & other));
+        Bitset either = other;
+        either |= view;
+        REQUIRE(either == (bits | other));
+        Bitset onlyOther = other;
+        andNot(onlyOther, view);
+        Bitset expectedOnly = other;
+        expectedOnly.andNot(bits);
+        REQUIRE(onlyOther == expectedOnly);
+    }
+}
+
+TEST_CASE("BitsetView layout and validation.") {
+    const RankSelectBitVector index(test::randomBits(5000, 5, 1));
+    Serialized file(index);
+    detail::BitsetFileHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    REQUIRE(header.version == BITSET_FILE_VERSION);
+    REQUIRE(header.wordsOffset % 64 == 0);
+    REQUIRE(header.entriesOffset % 64 == 0);
+    REQUIRE(header.upperOffset % 64 == 0);
+    REQUIRE(header.samplesOffset % 64 == 0);
+
+    // the stream writer produces the same bytes
+    std::ostringstream stream;
+    REQUIRE(BitsetView::write(index, stream));
+    const std::string written = stream.str();
+    REQUIRE(written.size() == BitsetView::bytes(index));
+    REQUIRE(memcmp(written.data(), file.data(), written.size()) == 0);
+
+    BitsetView view;
+    REQUIRE_FALSE(BitsetView::parse(file.data(), BitsetView::bytes(index) - 1, view));
+    REQUIRE_FALSE(BitsetView::parse(file.data() + 8, file.size() - 8, view));
+    REQUIRE_FALSE(BitsetView::parse(nullptr, 0, view));
+
+    file.data()[0] = 'X';
+    REQUIRE_FALSE(BitsetView::parse(file.data(), file.size(), view));
+    file.data()[0] = 'B';
+    REQUIRE(BitsetView::parse(file.data(), file.size(), view));
+
+    const uint32_t nextVersion = BITSET_FILE_VERSION + 1;
+    memcpy(file.data() + 8, &nextVersion, sizeof(nextVersion));
+    REQUIRE_FALSE(BitsetView::parse(file.data(), file.size(), view));
+}
+
+#else
+
+TEST_CASE("BitsetView refuses to write or parse on big-endian hosts.") {
+    const RankSelectBitVector index(Bitset(100));
+    std::vector<uint64_t> storage(BitsetView::bytes(index) / sizeof(uint64_t));
+    BitsetView view;
+    REQUIRE_FALSE(BitsetView::write(index, storage.data(), storage.size() * sizeof(uint64_t)));
+    REQUIRE_FALSE(BitsetView::parse(storage.data(), storage.size() * sizeof(uint64_t), view));
+}
+
+#endif
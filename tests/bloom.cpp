@@ -0,0 +1,196 @@
+#include "doctest.h"
+#include "bloom.hpp"
+#include "test_util.hpp"
+#include <cinttypes>
+#include <cmath>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+std::vector<uint64_t> randomKeys(size_t n, uint64_t seed) {
+    std::vector<uint64_t> keys(n);
+    test::Random random(seed);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = random.next();
+    }
+    return keys;
+}
+
+/** Check no false negatives and a false positive rate near the expected one. */
+template<typename Filter>
+void checkFilter(Filter& filter, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& others) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+        filter.add(keys[i]);
+    }
+    REQUIRE(filter.keys() == keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        REQUIRE(filter.contains(keys[i]));
+    }
+
+    // an odd count leaves a partial batch and a partial group of four
+    std::vector<char> out(keys.size());
+    bool* found = reinterpret_cast<bool*>(out.data());
+    REQUIRE(filter.containsMany(keys.data(), keys.size() - 3, found) == keys.size() - 3);
+
+    std::vector<char> otherOut(others.size());
+    bool* otherFound = reinterpret_cast<bool*>(otherOut.data());
+    const size_t falsePositives = filter.containsMany(others.data(), others.size(), otherFound);
+    size_t single = 0;
+    for (size_t i = 0; i < others.size(); ++i) {
+        REQUIRE(otherFound[i] == filter.contains(others[i]));
+        single += filter.contains(others[i]);
+    }
+    REQUIRE(single == falsePositives);
+
+    const double measured = static_cast<double>(falsePositives) / others.size();
+    const double expected = filter.falsePositiveRate();
+    REQUIRE(measured > expected * 0.8);
+    REQUIRE(measured < expected * 1.2);
+
+    filter.clear();
+    REQUIRE(filter.keys() == 0);
+    REQUIRE(filter.falsePositiveRate() == 0);
+    REQUIRE(filter.containsMany(keys.data(), keys.size(), found) == 0);
+}
+
+}
+
+TEST_CASE("bloomFalsePositiveRate") {
+    REQUIRE(std::fabs(bloomFalsePositiveRate(1000, 10000, 7) - 0.00819) < 0.00001);
+    REQUIRE(bloomFalsePositiveRate(0, 10000, 7) == 0);
+    REQUIRE(bloomFalsePositiveRate(10, 0, 7) == 1);
+}
+
+TEST_CASE("Bloom filter sizes stay within the 32-bit index range.") {
+    REQUIRE(detail::bloomCount(0, 64) == 1);
+    REQUIRE(detail::bloomCount(65, 64) == 2);
+    REQUIRE(detail::bloomCount(64.0 * 0xFFFFFFFFU, 64) == 0xFFFFFFFFU);
+    REQUIRE(detail::bloomCount(64.0 * 0x100000000ULL, 64) == detail::BLOOM_MAX_COUNT);
+    REQUIRE(detail::bloomCount(1e30, 512) == detail::BLOOM_MAX_COUNT);
+    // the largest index is still below the count
+    REQUIRE(detail::bloomIndex(~0ULL, detail::BLOOM_MAX_COUNT) == detail::BLOOM_MAX_COUNT - 1);
+}
+
+TEST_CASE("BlockedBloomFilter has no false negatives and the expected false positive rate.") {
+    const std::vector<uint64_t> keys = randomKeys(100001, 1);
+    const std::vector<uint64_t> others = randomKeys(200000, 2);
+    const double bitsPerKey[] = { 8, 10, 16 };
+    for (unsigned b = 0; b < 3; ++b) {
+        BlockedBloomFilter filter(keys.size(), bitsPerKey[b]);
+        REQUIRE(filter.bits() % 512 == 0);
+        REQUIRE(filter.bits() >= keys.size() * bitsPerKey[b]);
+        checkFilter(filter, keys, others);
+    }
+    // ten bits per key is close to 1%, a little above a standard filter
+    BlockedBloomFilter filter(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        filter.add(keys[i]);
+    }
+    REQUIRE(filter.falsePositiveRate() > bloomFalsePositiveRate(keys.size(), filter.bits(), 8));
+    REQUIRE(filter.falsePositiveRate() < 0.012);
+
+    // copies have their own aligned blocks
+    BlockedBloomFilter copy(filter);
+    BlockedBloomFilter assigned(1);
+    assigned = filter;
+    filter.clear();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        REQUIRE(copy.contains(keys[i]));
+        REQUIRE(assigned.contains(keys[i]));
+    }
+}
+
+TEST_CASE("RegisterBloomFilter has no false negatives and the expected false positive rate.") {
+    const std::vector<uint64_t> keys = randomKeys(100001, 3);
+    const std::vector<uint64_t> others = randomKeys(200000, 4);
+    const double bitsPerKey[] = { 8, 10, 16 };
+    const unsigned hashes[] = { 4, 5, 7 };
+    for (unsigned b = 0; b < 3; ++b) {
+        RegisterBloomFilter filter(keys.size(), bitsPerKey[b]);
+        REQUIRE(filter.hashes() == hashes[b]);
+        checkFilter(filter, keys, others);
+    }
+    for (unsigned k = 1; k <= 8; ++k) {
+        RegisterBloomFilter filter(keys.size(), 10, k);
+        REQUIRE(filter.hashes() == k);
+        checkFilter(filter, keys, others);
+    }
+}
+
+TEST_CASE("Bloom filter false positive rates of overloaded filters.") {
+    // thousands of keys per block or word, where e^-lambda underflows
+    const std::vector<uint64_t> keys = randomKeys(100000, 7);
+    const std::vector<uint64_t> others = randomKeys(1000, 8);
+    std::vector<char> out(others.size());
+    BlockedBloomFilter blocked(10);
+    RegisterBloomFilter registers(10);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        blocked.add(keys[i]);
+        registers.add(keys[i]);
+    }
+    REQUIRE(blocked.containsMany(others.data(), others.size(), reinterpret_cast<bool*>(out.data())) == others.size());
+    REQUIRE(registers.containsMany(others.data(), others.size(), reinterpret_cast<bool*>(out.data())) == others.size());
+    REQUIRE(blocked.falsePositiveRate() > 0.999);
+    REQUIRE(registers.falsePositiveRate() > 0.999);
+
+    // and the rate grows smoothly through moderate loads
+    BlockedBloomFilter filter(1000, 10);
+    double last = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        filter.add(keys[i]);
+        if (i % 1000 == 999) {
+            const double rate = filter.falsePositiveRate();
+            REQUIRE(rate >= last - 1e-9);
+            REQUIRE(rate <= 1);
+            last = rate;
+        }
+    }
+}
+
+TEST_CASE("Bloom filter lookup kernels agree.") {
+    std::vector<uint64_t> words = randomKeys(1024, 5);
+    // dense words so that about half the lookups hit
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] |= randomKeys(1, i + 6)[0] | randomKeys(1, i + 7000)[0];
+    }
+    const std::vector<uint64_t> hashes = randomKeys(1001, 6);
+    std::vector<char> expected(hashes.size());
+    std::vector<char> got(hashes.size());
+
+    std::vector<detail::BlockedContainsFn> blocked(1, &detail::blockedContainsPortable);
+    std::vector<detail::RegisterContainsFn> registers(1, &detail::registerContainsPortable);
+#if defined(BITS_X86)
+    if (cpuFeatures().avx2) {
+        blocked.push_back(&detail::blockedContainsAvx2);
+        registers.push_back(&detail::registerContainsAvx2);
+    }
+#endif
+    // blockedContainsAvx2 needs 32-byte aligned blocks
+    std::vector<uint64_t> storage(words.size() + 7);
+    const uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+    uint64_t* blocks = storage.data() + (64 - address % 64) % 64 / sizeof(uint64_t);
+    std::copy(words.begin(), words.end(), blocks);
+
+    const size_t blockCount = words.size() / detail::BLOOM_BLOCK_WORDS;
+    const size_t blockedFound = detail::blockedContainsPortable(blocks, blockCount,
+        hashes.data(), hashes.size(), reinterpret_cast<bool*>(expected.data()));
+    REQUIRE(blockedFound > 0);
+    for (size_t k = 0; k < blocked.size(); ++k) {
+        REQUIRE(blocked[k](blocks, blockCount, hashes.data(), hashes.size(),
+            reinterpret_cast<bool*>(got.data())) == blockedFound);
+        REQUIRE(got == expected);
+    }
+
+    for (unsigned bitsPerKey = 1; bitsPerKey <= 8; ++bitsPerKey) {
+        const size_t registerFound = detail::registerContainsPortable(words.data(), words.size(),
+            bitsPerKey, hashes.data(), hashes.size(), reinterpret_cast<bool*>(expected.data()));
+        REQUIRE(registerFound > 0);
+        for (size_t k = 0; k < registers.size(); ++k) {
+            REQUIRE(registers[k](words.data(), words.size(), bitsPerKey, hashes.data(), hashes.size(),
+                reinterpret_cast<bool*>(got.data())) == registerFound);
+            REQUIRE(got == expected);
+        }
+    }
+}
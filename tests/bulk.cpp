@@ -0,0 +1,267 @@
+#include "doctest.h"
+#include "bulk.hpp"
+#include "test_util.hpp"
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+template<typename T>
+std::vector<T> testWords(size_t n) {
+    std::vector<T> words;
+    test::Random random(0);
+    for (size_t i = 0; i < n; ++i) {
+        words.push_back(static_cast<T>(random.next()));
+    }
+    return words;
+}
+
+template<typename T, typename Out>
+struct KernelChecker {
+    typedef void (*Kernel)(const T*, size_t, Out*, unsigned, unsigned);
+
+    // Run kernel and the portable loop over the same input and compare.
+    static void check(Kernel kernel, Kernel portable, unsigned width, unsigned lsb) {
+        const std::vector<T> in = testWords<T>(67);
+        std::vector<Out> expected(in.size());
+        std::vector<Out> actual(in.size());
+        portable(&in[0], in.size(), &expected[0], width, lsb);
+        kernel(&in[0], in.size(), &actual[0], width, lsb);
+        REQUIRE(actual == expected);
+    }
+
+    static void checkAll(unsigned width, unsigned lsb) {
+        (void)width;
+        (void)lsb;
+#if defined(BITS_X86)
+        const CpuFeatures& cpu = cpuFeatures();
+        if (cpu.sse42) {
+            check(&detail::getUbitsBulkSse42<T, Out>, &detail::getUbitsBulkPortable<T, Out>, width, lsb);
+            check(&detail::getSbitsBulkSse42<T, Out>, &detail::getSbitsBulkPortable<T, Out>, width, lsb);
+        }
+        if (cpu.avx2) {
+            check(&detail::getUbitsBulkAvx2<T, Out>, &detail::getUbitsBulkPortable<T, Out>, width, lsb);
+            check(&detail::getSbitsBulkAvx2<T, Out>, &detail::getSbitsBulkPortable<T, Out>, width, lsb);
+        }
+        if (cpu.avx512f) {
+            check(&detail::getUbitsBulkAvx512<T, Out>, &detail::getUbitsBulkPortable<T, Out>, width, lsb);
+            check(&detail::getSbitsBulkAvx512<T, Out>, &detail::getSbitsBulkPortable<T, Out>, width, lsb);
+        }
+#endif
+    }
+};
+
+}
+
+TEST_CASE("Run-time getUbitsBulk and getSbitsBulk.") {
+    const std::vector<uint64_t> in = testWords<uint64_t>(100);
+    std::vector<uint64_t> uout(in.size());
+    std::vector<int64_t> sout(in.size());
+    getUbitsBulk(&in[0], in.size(), &uout[0], 13, 40);
+    getSbitsBulk(&in[0], in.size(), &sout[0], 13, 40);
+    for (size_t i = 0; i < in.size(); ++i) {
+        REQUIRE(uout[i] == getUbits<13, 40>(in[i]));
+        REQUIRE(sout[i] == getSbits<13, 40, int64_t>(in[i]));
+    }
+}
+
+TEST_CASE("Compile-time getUbitsBulk and getSbitsBulk.") {
+    const std::vector<uint32_t> in32 = testWords<uint32_t>(45);
+    std::vector<uint8_t> u8(in32.size());
+    std::vector<int16_t> s16(in32.size());
+    std::vector<int32_t> s32(in32.size());
+    getUbitsBulk<3, 29>(&in32[0], in32.size(), &u8[0]);
+    getSbitsBulk<9, 0>(&in32[0], in32.size(), &s16[0]);
+    getSbitsBulk<31, 1>(&in32[0], in32.size(), &s32[0]);
+    for (size_t i = 0; i < in32.size(); ++i) {
+        REQUIRE(u8[i] == getUbits<3, 29>(in32[i]));
+        REQUIRE(s16[i] == getSbits<9, 0, int16_t>(in32[i]));
+        REQUIRE(s32[i] == getSbits<31, 1, int32_t>(in32[i]));
+    }
+
+    const std::vector<uint64_t> in64 = testWords<uint64_t>(45);
+    std::vector<uint32_t> u32(in64.size());
+    std::vector<int32_t> s32from64(in64.size());
+    std::vector<int64_t> s64(in64.size());
+    getUbitsBulk<20, 36>(&in64[0], in64.size(), &u32[0]);
+    getSbitsBulk<32, 32>(&in64[0], in64.size(), &s32from64[0]);
+    getSbitsBulk<63, 0>(&in64[0], in64.size(), &s64[0]);
+    for (size_t i = 0; i < in64.size(); ++i) {
+        REQUIRE(u32[i] == getUbits<20, 36>(in64[i]));
+        REQUIRE(s32from64[i] == getSbits<32, 32, int32_t>(in64[i]));
+        REQUIRE(s64[i] == getSbits<63, 0, int64_t>(in64[i]));
+    }
+}
+
+TEST_CASE("Bulk extraction kernels agree with the portable loop.") {
+    KernelChecker<uint32_t, uint32_t>::checkAll(31, 1);
+    KernelChecker<uint32_t, int32_t>::checkAll(7, 3);
+    KernelChecker<uint64_t, uint64_t>::checkAll(13, 40);
+    KernelChecker<uint64_t, int64_t>::checkAll(1, 63);
+    KernelChecker<uint64_t, uint32_t>::checkAll(32, 17);
+    KernelChecker<uint64_t, int32_t>::checkAll(20, 2);
+}
+
+#if defined(__SIZEOF_INT128__)
+
+TEST_CASE("getUbitsBulk and getSbitsBulk of 128-bit words.") {
+    __extension__ typedef unsigned __int128 Word128;
+    __extension__ typedef __int128 Int128;
+    const std::vector<uint64_t> halves = testWords<uint64_t>(2 * 37);
+    std::vector<Word128> in;
+    for (size_t i = 0; i < halves.size(); i += 2) {
+        in.push_back((static_cast<Word128>(halves[i]) << 64) | halves[i + 1]);
+    }
+    std::vector<Word128> uout(in.size());
+    std::vector<Int128> sout(in.size());
+    std::vector<uint64_t> u64(in.size());
+    getUbitsBulk(&in[0], in.size(), &uout[0], 70, 40);
+    getSbitsBulk(&in[0], in.size(), &sout[0], 70, 40);
+    getUbitsBulk<20, 100>(&in[0], in.size(), &u64[0]);
+    for (size_t i = 0; i < in.size(); ++i) {
+        REQUIRE(uout[i] == getUbits<70, 40>(in[i]));
+        REQUIRE(sout[i] == (getSbits<70, 40, Int128>(in[i])));
+        REQUIRE(u64[i] == static_cast<uint64_t>(getUbits<20, 100>(in[i])));
+    }
+}
+
+#endif
+
+TEST_CASE("Run-time setBitsBulk.") {
+    std::vector<uint16_t> dest(10, 0xFFFF);
+    std::vector<int> values(10, -4);
+    setBitsBulk(&dest[0], &values[0], dest.size(), 3, 2);
+    for (size_t i = 0; i < dest.size(); ++i) {
+        REQUIRE(dest[i] == 0xFFF3);
+    }
+}
+
+namespace {
+
+enum class Tag : uint32_t { IDLE, BUSY, DONE = 0xF };
+
+template<typename T, typename ValueType>
+std::vector<T> expectedSetBits(const std::vector<T>& original, const std::vector<ValueType>& values,
+        unsigned width, unsigned lsb) {
+    std::vector<T> expected(original);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        setBits(expected[i], width, lsb, values[i]);
+    }
+    return expected;
+}
+
+template<unsigned width, unsigned lsb, typename T, typename ValueType>
+void checkSetBitsBulk(const std::vector<ValueType>& values) {
+    const std::vector<T> original = testWords<T>(values.size());
+    std::vector<T> expected(original);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        setBits<width, lsb>(expected[i], values[i]);
+    }
+    REQUIRE(expected == expectedSetBits(original, values, width, lsb));
+    std::vector<T> dest(original);
+    setBitsBulk<width, lsb>(&dest[0], &values[0], dest.size());
+    REQUIRE(dest == expected);
+}
+
+// Only for word/value combinations that have SIMD kernels.
+template<typename T, typename ValueType>
+void checkSetKernels(const std::vector<ValueType>& values, unsigned width, unsigned lsb) {
+    (void)values;
+    (void)width;
+    (void)lsb;
+#if defined(BITS_X86)
+    const std::vector<T> original = testWords<T>(values.size());
+    const std::vector<T> expected = expectedSetBits(original, values, width, lsb);
+    typedef void (*Kernel)(T*, const ValueType*, size_t, unsigned, unsigned);
+    const Kernel kernels[] = {
+        cpuFeatures().sse42 ? &detail::setBitsBulkSse42<T, ValueType> : 0,
+        cpuFeatures().avx2 ? &detail::setBitsBulkAvx2<T, ValueType> : 0,
+        cpuFeatures().avx512f ? &detail::setBitsBulkAvx512<T, ValueType> : 0,
+    };
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (kernels[k] != 0) {
+            std::vector<T> dest(original);
+            kernels[k](&dest[0], &values[0], dest.size(), width, lsb);
+            REQUIRE(dest == expected);
+        }
+    }
+#endif
+}
+}
+
+TEST_CASE("Compile-time setBitsBulk keeps setBits semantics.") {
+    std::vector<Tag> tags;
+    std::vector<int32_t> signedValues;
+    std::vector<uint32_t> unsignedValues;
+    std::vector<int64_t> wideValues;
+    for (int i = 0; i < 37; ++i) {
+        tags.push_back(i % 3 == 0 ? Tag::DONE : (i % 3 == 1 ? Tag::BUSY : Tag::IDLE));
+        signedValues.push_back(i * 7919 - 150000);
+        unsignedValues.push_back(static_cast<uint32_t>(i) * 0x9E3779B9U);
+        wideValues.push_back(-static_cast<int64_t>(i) * (INT64_C(1) << 30));
+    }
+    checkSetBitsBulk<4, 8, uint32_t>(tags);
+    checkSetBitsBulk<4, 60, uint64_t>(tags);
+    checkSetBitsBulk<19, 3, uint32_t>(signedValues);
+    // sign extension of 32-bit values matters once the field is wider than 32 bits
+    checkSetBitsBulk<40, 20, uint64_t>(signedValues);
+    checkSetBitsBulk<40, 20, uint64_t>(unsignedValues);
+    checkSetBitsBulk<63, 1, uint64_t>(wideValues);
+    checkSetBitsBulk<3, 5, uint8_t>(signedValues);
+
+    checkSetKernels<uint32_t>(tags, 4, 8);
+    checkSetKernels<uint64_t>(tags, 4, 60);
+    checkSetKernels<uint32_t>(signedValues, 19, 3);
+    checkSetKernels<uint64_t>(signedValues, 40, 20);
+    checkSetKernels<uint64_t>(unsignedValues, 40, 20);
+    checkSetKernels<uint64_t>(wideValues, 63, 1);
+}
+
+TEST_CASE("fillBits.") {
+    std::vector<uint16_t> dest16(21, 0xFFFF);
+    fillBits<3, 2>(&dest16[0], dest16.size(), -4);
+    for (size_t i = 0; i < dest16.size(); ++i) {
+        REQUIRE(dest16[i] == 0xFFF3);
+    }
+
+    const std::vector<uint64_t> original = testWords<uint64_t>(50);
+    std::vector<uint64_t> dest64(original);
+    fillBits<4, 60>(&dest64[0], dest64.size(), Tag::BUSY);
+    for (size_t i = 0; i < dest64.size(); ++i) {
+        uint64_t expected = original[i];
+        setBits<4, 60>(expected, Tag::BUSY);
+        REQUIRE(dest64[i] == expected);
+    }
+
+    std::vector<uint8_t> dest8(100, 0);
+    fillBits(&dest8[0], dest8.size(), 4, 4, 0xA);
+    for (size_t i = 0; i < dest8.size(); ++i) {
+        REQUIRE(dest8[i] == 0xA0);
+    }
+}
+
+#if defined(__SIZEOF_INT128__)
+
+TEST_CASE("setBitsBulk and fillBits of 128-bit words.") {
+    __extension__ typedef unsigned __int128 Word128;
+    std::vector<Word128> dest(9, 0);
+    fillBits<4, 100>(&dest[0], dest.size(), 0xA);
+    for (size_t i = 0; i < dest.size(); ++i) {
+        REQUIRE(static_cast<uint64_t>(dest[i] >> 64) == 0xA000000000ULL);
+        REQUIRE(static_cast<uint64_t>(dest[i]) == 0);
+    }
+
+    std::vector<Word128> values(dest.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<Word128>(i) << 64 | 0x55;
+    }
+    setBitsBulk(&dest[0], &values[0], dest.size(), 72, 8);
+    for (size_t i = 0; i < dest.size(); ++i) {
+        REQUIRE(static_cast<uint64_t>(dest[i] >> 64) == (0xA000000000ULL | i << 8));
+        REQUIRE(static_cast<uint64_t>(dest[i]) == 0x5500);
+    }
+}
+
+#endif
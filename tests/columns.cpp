@@ -0,0 +1,55 @@
+#include "doctest.h"
+#include "columns.hpp"
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+enum class Kind : uint8_t { A, B, C, D };
+
+typedef Field<2, 62, Kind> KindField;
+typedef Field<22, 40, int32_t> Delta;
+typedef Field<32, 8> Id;
+typedef Field<7, 0, uint8_t> Flags;
+typedef Layout<uint64_t, KindField, Delta, Id, Flags> Record;
+
+}
+
+TEST_CASE("unpackColumns and packColumns round trip.") {
+    const size_t n = 1500; // several blocks plus a partial one
+    std::vector<uint64_t> records;
+    for (size_t i = 0; i < n; ++i) {
+        records.push_back(Record::pack(static_cast<Kind>(i % 4),
+            static_cast<int32_t>(i * 1031) - 700000, static_cast<uint64_t>(i) * 0x9E3779B9U,
+            static_cast<uint8_t>(i)));
+    }
+
+    std::vector<Kind> kinds(n);
+    std::vector<int64_t> deltas(n);
+    std::vector<uint32_t> ids(n);
+    std::vector<uint8_t> flags(n);
+    unpackColumns<Record>(&records[0], n, &kinds[0], &deltas[0], &ids[0], &flags[0]);
+    for (size_t i = 0; i < n; ++i) {
+        REQUIRE(kinds[i] == Record::get<KindField>(records[i]));
+        REQUIRE(deltas[i] == Record::get<Delta>(records[i]));
+        REQUIRE(ids[i] == Record::get<Id>(records[i]));
+        REQUIRE(flags[i] == Record::get<Flags>(records[i]));
+    }
+
+    std::vector<uint64_t> packed(n, ~0ULL);
+    packColumns<Record>(&packed[0], n, &kinds[0], &deltas[0], &ids[0], &flags[0]);
+    REQUIRE(packed == records);
+}
+
+TEST_CASE("packColumns zeroes unused bits.") {
+    typedef Layout<uint32_t, Field<4, 28>, Field<8, 0, int32_t>> Sparse;
+    const uint32_t tops[] = { 1, 2, 0xF };
+    const int32_t lows[] = { -1, 5, -128 };
+    uint32_t records[3] = { ~0u, ~0u, ~0u };
+    packColumns<Sparse>(records, 3, tops, lows);
+    REQUIRE(records[0] == 0x100000FF);
+    REQUIRE(records[1] == 0x20000005);
+    REQUIRE(records[2] == 0xF0000080);
+}
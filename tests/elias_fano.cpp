@@ -0,0 +1,116 @@
+#include "doctest.h"
+#include "elias_fano.hpp"
+#include "test_util.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+/** n sorted values with gaps below maxGap, and some repeats when maxGap is small. */
+std::vector<uint64_t> randomSorted(size_t n, uint64_t maxGap, uint64_t seed) {
+    std::vector<uint64_t> values(n);
+    test::Random random(seed);
+    uint64_t value = 0;
+    for (size_t i = 0; i < n; ++i) {
+        value += random.next() % maxGap;
+        values[i] = value;
+    }
+    return values;
+}
+
+void checkSequence(const std::vector<uint64_t>& values) {
+    const EliasFanoSequence sequence(values);
+    REQUIRE(sequence.size() == values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        REQUIRE(sequence.access(i) == values[i]);
+    }
+    size_t i = 0;
+    for (EliasFanoSequence::Iterator it = sequence.begin(); it != sequence.end(); ++it, ++i) {
+        REQUIRE(*it == values[i]);
+        REQUIRE(it.index() == i);
+    }
+    REQUIRE(i == values.size());
+
+    // every value, its neighbours and a few points between values
+    std::vector<uint64_t> probes;
+    for (size_t j = 0; j < values.size(); ++j) {
+        probes.push_back(values[j]);
+        probes.push_back(values[j] + 1);
+        if (values[j] > 0) {
+            probes.push_back(values[j] - 1);
+        }
+    }
+    probes.push_back(0);
+    for (size_t p = 0; p < probes.size(); ++p) {
+        const size_t expected = static_cast<size_t>(
+            std::lower_bound(values.begin(), values.end(), probes[p]) - values.begin());
+        REQUIRE(sequence.nextGEQ(probes[p]) == expected);
+    }
+}
+
+}
+
+TEST_CASE("EliasFanoSequence round trips sorted values.") {
+    const size_t sizes[] = { 1, 2, 255, 256, 257, 5000 };
+    const uint64_t gaps[] = { 1, 2, 3, 100, 1000000 };
+    for (size_t s = 0; s < 6; ++s) {
+        for (size_t g = 0; g < 5; ++g) {
+            checkSequence(randomSorted(sizes[s], gaps[g], s * 5 + g));
+        }
+    }
+}
+
+TEST_CASE("EliasFanoSequence edge cases.") {
+    const EliasFanoSequence empty;
+    REQUIRE(empty.size() == 0);
+    REQUIRE(empty.begin() == empty.end());
+    REQUIRE(empty.nextGEQ(0) == 0);
+
+    // a few values spread over the whole 64-bit range
+    std::vector<uint64_t> wide;
+    wide.push_back(0);
+    wide.push_back(1);
+    wide.push_back(0x8000000000000000ULL);
+    wide.push_back(~0ULL - 1);
+    wide.push_back(~0ULL);
+    checkSequence(wide);
+    REQUIRE(EliasFanoSequence(wide).lowBits() == 61);
+
+    // dense input has no low bits, so nothing may be read from them
+    std::vector<uint64_t> dense(1000);
+    for (size_t i = 0; i < dense.size(); ++i) {
+        dense[i] = i;
+    }
+    REQUIRE(EliasFanoSequence(dense).lowBits() == 0);
+    REQUIRE(EliasFanoSequence(dense).memoryBytes() > 0);
+    checkSequence(dense);
+    checkSequence(std::vector<uint64_t>(1, 0));
+
+    // the same value repeated, and 32-bit input
+    std::vector<uint32_t> repeated(1000, 77);
+    const EliasFanoSequence sequence(repeated);
+    REQUIRE(sequence.back() == 77);
+    REQUIRE(sequence.nextGEQ(77) == 0);
+    REQUIRE(sequence.nextGEQ(78) == 1000);
+    REQUIRE(*sequence.lowerBound(50) == 77);
+    REQUIRE(sequence.lowerBound(78) == sequence.end());
+    REQUIRE(*sequence.iteratorAt(999) == 77);
+    REQUIRE(sequence.iteratorAt(1000) == sequence.end());
+}
+
+TEST_CASE("EliasFanoSequence size stays near the bound.") {
+    // about 1 in 16 of the universe, so L = 4 and at most about
+    // 2 + 4 bits per value plus the samples
+    const std::vector<uint64_t> values = randomSorted(100000, 34, 3);
+    const EliasFanoSequence sequence(values);
+    REQUIRE(sequence.lowBits() == 4);
+    REQUIRE(sequence.memoryBytes() * 8 < values.size() * 7);
+
+    EliasFanoSequence::Iterator it = sequence.iteratorAt(12345);
+    for (size_t i = 12345; i < 12400; ++i, ++it) {
+        REQUIRE(*it == values[i]);
+    }
+}
@@ -0,0 +1,71 @@
+#include "doctest.h"
+#include "field_view.hpp"
+#include <cinttypes>
+#include <cstring>
+
+using namespace bits;
+
+namespace {
+
+// the first word of an IPv4 header in network order
+typedef Field<4, 28> Version;
+typedef Field<4, 24> Ihl;
+typedef Field<8, 16> Tos;
+typedef Field<16, 0> TotalLength;
+typedef CompleteLayout<uint32_t, Version, Ihl, Tos, TotalLength> Ipv4Word0;
+
+// a 48-bit record: a 12-bit signed delta, a 4-bit kind and a 32-bit id
+typedef Field<12, 36, int16_t> Delta;
+typedef Field<4, 32> Kind;
+typedef Field<32, 0> Id;
+typedef Layout<uint64_t, Delta, Kind, Id> Record48;
+
+}
+
+TEST_CASE("FieldView over a big-endian packet word at an odd address.") {
+    unsigned char packet[21] = { 0xEE, 0x45, 0x00, 0x05, 0xDC };
+    const ConstFieldView<Ipv4Word0, BigEndian> header(packet + 1);
+    REQUIRE(header.word() == 0x450005DC);
+    REQUIRE(header.get<Version>() == 4);
+    REQUIRE(header.get<Ihl>() == 5);
+    REQUIRE(header.getFields<Version, TotalLength>() == std::make_tuple(4u, 1500u));
+
+    const FieldView<Ipv4Word0, BigEndian> writable(packet + 1);
+    writable.set<Tos, TotalLength>(0xB8, 40);
+    const unsigned char expected[] = { 0xEE, 0x45, 0xB8, 0x00, 0x28, 0x00 };
+    REQUIRE(memcmp(packet, expected, sizeof(expected)) == 0);
+}
+
+TEST_CASE("FieldView over little-endian records shorter than their word.") {
+    unsigned char buf[3 * 6 + 2] = {};
+    for (unsigned i = 0; i < 3; ++i) {
+        FieldView<Record48, LittleEndian, 6>(buf + i * 6).pack(-100 + static_cast<int16_t>(i), 9, 0x89ABCDEF + i);
+    }
+    // the records are packed back to back, 6 bytes each
+    const unsigned char first[] = { 0xEF, 0xCD, 0xAB, 0x89, 0xC9, 0xF9 };
+    REQUIRE(memcmp(buf, first, sizeof(first)) == 0);
+    REQUIRE(buf[18] == 0);
+
+    for (unsigned i = 0; i < 3; ++i) {
+        const ConstFieldView<Record48, LittleEndian, 6> exact(buf + i * 6);
+        const ConstFieldView<Record48, LittleEndian, 6, true> padded(buf + i * 6);
+        REQUIRE(exact.unpack() == std::make_tuple(static_cast<int16_t>(-100 + i), 9u, 0x89ABCDEFu + i));
+        REQUIRE(padded.word() == exact.word());
+    }
+
+    FieldView<Record48, LittleEndian, 6, true> second(buf + 6);
+    second.set<Kind>(2);
+    REQUIRE(second.get<Kind>() == 2);
+    REQUIRE(second.get<Delta>() == -99);
+    REQUIRE((ConstFieldView<Record48, LittleEndian, 6>(buf + 12).get<Delta>()) == -98);
+}
+
+TEST_CASE("FieldView over big-endian records shorter than their word.") {
+    unsigned char buf[8] = {};
+    const FieldView<Record48, BigEndian, 6> record(buf);
+    record.pack(-2, 0xA, 0x01020304);
+    const unsigned char expected[] = { 0xFF, 0xEA, 0x01, 0x02, 0x03, 0x04, 0, 0 };
+    REQUIRE(memcmp(buf, expected, sizeof(expected)) == 0);
+    REQUIRE((ConstFieldView<Record48, BigEndian, 6, true>(buf).unpack())
+        == std::make_tuple(static_cast<int16_t>(-2), 0xAu, 0x01020304u));
+}
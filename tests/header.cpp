@@ -0,0 +1,169 @@
+#include "doctest.h"
+#include "header.hpp"
+#include <cinttypes>
+#include <cstring>
+
+using namespace bits;
+
+namespace {
+
+enum class IpProtocol : uint8_t { TCP = 6, UDP = 17 };
+
+struct Ipv4 {
+    uint8_t version, ihl, tos;
+    uint16_t totalLength, id;
+    uint8_t flags;
+    uint16_t fragmentOffset;
+    uint8_t ttl;
+    IpProtocol protocol;
+    uint16_t checksum;
+    uint32_t src, dst;
+};
+
+typedef Field<4, 28> Version;
+typedef Field<4, 24> Ihl;
+typedef Field<8, 16> Tos;
+typedef Field<16, 0> TotalLength;
+typedef Field<16, 16> Id;
+typedef Field<3, 13> Flags;
+typedef Field<13, 0> FragmentOffset;
+typedef Field<8, 24> Ttl;
+typedef Field<8, 16, IpProtocol> Protocol;
+typedef Field<16, 0> HeaderChecksum;
+typedef Field<32, 32> SrcAddr;
+typedef Field<32, 0> DstAddr;
+
+// the addresses are whole 32-bit words, so they share one 64-bit word
+typedef Header<Ipv4, BigEndian,
+    HeaderWord<0, uint32_t,
+        BITS_BIND(Version, &Ipv4::version),
+        BITS_BIND(Ihl, &Ipv4::ihl),
+        BITS_BIND(Tos, &Ipv4::tos),
+        BITS_BIND(TotalLength, &Ipv4::totalLength)>,
+    HeaderWord<4, uint32_t,
+        BITS_BIND(Id, &Ipv4::id),
+        BITS_BIND(Flags, &Ipv4::flags),
+        BITS_BIND(FragmentOffset, &Ipv4::fragmentOffset)>,
+    HeaderWord<8, uint32_t,
+        BITS_BIND(Ttl, &Ipv4::ttl),
+        BITS_BIND(Protocol, &Ipv4::protocol),
+        BITS_BIND(HeaderChecksum, &Ipv4::checksum)>,
+    HeaderWord<12, uint64_t,
+        BITS_BIND(SrcAddr, &Ipv4::src),
+        BITS_BIND(DstAddr, &Ipv4::dst)>> Ipv4Header;
+
+// a UDP header followed by a VXLAN header, whose reserved bytes are skipped
+struct UdpVxlan {
+    uint16_t srcPort, dstPort, length, checksum;
+    uint8_t vxlanFlags;
+    uint32_t vni;
+};
+
+typedef Field<16, 48> SrcPort;
+typedef Field<16, 32> DstPort;
+typedef Field<16, 16> UdpLength;
+typedef Field<16, 0> UdpChecksum;
+typedef Field<8, 8, uint8_t> VxlanFlags;
+typedef Field<24, 8> Vni;
+
+typedef Header<UdpVxlan, BigEndian,
+    HeaderWord<0, uint64_t,
+        BITS_BIND(SrcPort, &UdpVxlan::srcPort),
+        BITS_BIND(DstPort, &UdpVxlan::dstPort),
+        BITS_BIND(UdpLength, &UdpVxlan::length),
+        BITS_BIND(UdpChecksum, &UdpVxlan::checksum)>,
+    HeaderWord<8, uint16_t,
+        BITS_BIND(VxlanFlags, &UdpVxlan::vxlanFlags)>,
+    HeaderWord<12, uint32_t,
+        BITS_BIND(Vni, &UdpVxlan::vni)>> UdpVxlanHeader;
+
+// an in-house little-endian header with a signed field
+struct Sample {
+    int16_t delta;
+    uint8_t channel;
+    uint32_t timestamp;
+};
+
+typedef Field<12, 4, int16_t> Delta;
+typedef Field<4, 0> Channel;
+typedef Field<40, 0> Timestamp;
+
+typedef Header<Sample, LittleEndian,
+    HeaderWord<0, uint16_t,
+        BITS_BIND(Delta, &Sample::delta),
+        BITS_BIND(Channel, &Sample::channel)>,
+    HeaderWord<2, uint64_t,
+        BITS_BIND(Timestamp, &Sample::timestamp)>> SampleHeader;
+
+}
+
+TEST_CASE("Header parses an IPv4 header.") {
+    const unsigned char packet[] = {
+        0x45, 0x00, 0x00, 0x3C, 0x1C, 0x46, 0x40, 0x00, 0x40, 0x06,
+        0xB1, 0xE6, 0xAC, 0x10, 0x0A, 0x63, 0xAC, 0x10, 0x0A, 0x0C };
+    REQUIRE(Ipv4Header::BYTES == 20);
+
+    Ipv4 ip;
+    REQUIRE(Ipv4Header::parse(packet, sizeof(packet), ip));
+    REQUIRE(ip.version == 4);
+    REQUIRE(ip.ihl == 5);
+    REQUIRE(ip.tos == 0);
+    REQUIRE(ip.totalLength == 60);
+    REQUIRE(ip.id == 0x1C46);
+    REQUIRE(ip.flags == 2);
+    REQUIRE(ip.fragmentOffset == 0);
+    REQUIRE(ip.ttl == 64);
+    REQUIRE(ip.protocol == IpProtocol::TCP);
+    REQUIRE(ip.checksum == 0xB1E6);
+    REQUIRE(ip.src == 0xAC100A63);
+    REQUIRE(ip.dst == 0xAC100A0C);
+
+    unsigned char copy[sizeof(packet)];
+    REQUIRE(Ipv4Header::write(ip, copy, sizeof(copy)));
+    REQUIRE(memcmp(copy, packet, sizeof(packet)) == 0);
+
+    // a short buffer is rejected before anything is read or written
+    Ipv4 untouched = Ipv4();
+    REQUIRE_FALSE(Ipv4Header::parse(packet, sizeof(packet) - 1, untouched));
+    REQUIRE(untouched.version == 0);
+    REQUIRE_FALSE(Ipv4Header::write(ip, copy, sizeof(copy) - 1));
+}
+
+TEST_CASE("Header skips bytes that belong to no word.") {
+    REQUIRE(UdpVxlanHeader::BYTES == 16);
+
+    unsigned char packet[16];
+    memset(packet, 0xAA, sizeof(packet));
+    UdpVxlan in = { 49152, 4789, 16, 0, 0x08, 0x123456 };
+    REQUIRE(UdpVxlanHeader::write(in, packet, sizeof(packet)));
+    const unsigned char expected[] = {
+        0xC0, 0x00, 0x12, 0xB5, 0x00, 0x10, 0x00, 0x00,
+        0x08, 0x00, 0xAA, 0xAA, 0x12, 0x34, 0x56, 0x00 };
+    REQUIRE(memcmp(packet, expected, sizeof(expected)) == 0);
+
+    UdpVxlan out;
+    REQUIRE(UdpVxlanHeader::parse(packet, sizeof(packet), out));
+    REQUIRE(out.srcPort == 49152);
+    REQUIRE(out.dstPort == 4789);
+    REQUIRE(out.length == 16);
+    REQUIRE(out.checksum == 0);
+    REQUIRE(out.vxlanFlags == 0x08);
+    REQUIRE(out.vni == 0x123456);
+}
+
+TEST_CASE("Header over a little-endian header with a signed field.") {
+    unsigned char buf[SampleHeader::BYTES];
+    REQUIRE(sizeof(buf) == 10);
+    const Sample in = { -300, 9, 0xDEADBEEF };
+    REQUIRE(SampleHeader::write(in, buf, sizeof(buf)));
+    // delta is bits 4-15 of the first little-endian 16-bit word
+    REQUIRE(buf[0] == ((static_cast<unsigned>(-300) << 4 | 9) & 0xFF));
+    REQUIRE(buf[2] == 0xEF);
+    REQUIRE(buf[6] == 0);
+
+    Sample out;
+    REQUIRE(SampleHeader::parse(buf, sizeof(buf), out));
+    REQUIRE(out.delta == -300);
+    REQUIRE(out.channel == 9);
+    REQUIRE(out.timestamp == 0xDEADBEEF);
+}
@@ -1,7 +1,9 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 #include "bits.hpp"
+#include "test_util.hpp"
 #include <cinttypes>
+#include <cstring>
 
 using namespace bits;
 
@@ -230,3 +232,497 @@ TEST_CASE("Set three fields, dest = 0xFFFF, uint16_t.") {
     setBits<3, 0>(dest, value);
     REQUIRE(dest == 0x1FE4);
 }
+
+TEST_CASE("Run-time field width and lsb match the template versions.") {
+    uint32_t src = 0xA0000F45;
+    REQUIRE(getUbits(src, 3, 29) == getUbits<3, 29>(src));
+    REQUIRE(getUbits(src, 9, 0) == 0x145);
+    REQUIRE(getSbits<int32_t>(src, 3, 29) == -3);
+    REQUIRE(getSbits<int32_t>(src, 9, 0) == -187);
+
+    uint64_t src64 = 0xA000000000000F45;
+    REQUIRE(getUbits(src64, 3, 61) == 5);
+    REQUIRE(getSbits<int64_t>(src64, 3, 61) == -3);
+    REQUIRE(getUbits(src64, 63, 0) == 0x2000000000000F45);
+
+    uint8_t src8 = 0x45;
+    REQUIRE(getUbits(src8, 3, 0) == 5);
+    REQUIRE(getSbits<int8_t>(src8, 3, 0) == -3);
+}
+
+TEST_CASE("Run-time setBits.") {
+    uint32_t dest = 0;
+    setBits(dest, 3, 29, 0xFFFFFFFF);
+    REQUIRE(dest == 0xE0000000);
+    setBits(dest, 3, 0, -1);
+    REQUIRE(dest == 0xE0000007);
+    setBits(dest, 4, 5, State::SuperconductiveAtRoomTemperature);
+    REQUIRE(dest == 0xE0000147);
+
+    uint64_t dest64 = 0xFFFFFFFFFFFFFFFF;
+    setBits(dest64, 3, 61, 0);
+    REQUIRE(dest64 == 0x1FFFFFFFFFFFFFFF);
+    setBits(dest64, 3, 0, -4);
+    REQUIRE(dest64 == 0x1FFFFFFFFFFFFFFC);
+}
+
+TEST_CASE("getFields reads several fields from one word.") {
+    uint32_t src = 0xA0000F45;
+    typedef Field<3, 29> Top;
+    typedef Field<3, 29, int32_t> SignedTop;
+    typedef Field<9, 0, int32_t> Low;
+    typedef Field<4, 8, State> SignedState;
+    typedef Field<4, 8, Ustate> UnsignedState;
+    std::tuple<uint32_t, int32_t, int32_t, State, Ustate> fields =
+        getFields<Top, SignedTop, Low, SignedState, UnsignedState>(src);
+    REQUIRE(std::get<0>(fields) == 5);
+    REQUIRE(std::get<1>(fields) == -3);
+    REQUIRE(std::get<2>(fields) == -187);
+    REQUIRE(std::get<3>(fields) == State::ON);
+    REQUIRE(std::get<4>(fields) == Ustate::ON);
+}
+
+TEST_CASE("getFields from a volatile 64-bit word.") {
+    volatile uint64_t src = 0xA000000000000F45;
+    uint64_t top;
+    int64_t signedTop;
+    uint8_t low;
+    std::tie(top, signedTop, low) =
+        getFields<Field<3, 61>, Field<3, 61, int64_t>, Field<8, 0, uint8_t>>(src);
+    REQUIRE(top == 5);
+    REQUIRE(signedTop == -3);
+    REQUIRE(low == 0x45);
+    REQUIRE(getField<Field<3, 61, int8_t>>(src) == -3);
+}
+
+TEST_CASE("setFields matches repeated setBits.") {
+    uint32_t expected = 0x12345678;
+    setBits<3, 29>(expected, 0xFFFFFFFF);
+    setBits<3, 0>(expected, -4);
+    setBits<4, 5>(expected, State::SuperconductiveAtRoomTemperature);
+
+    uint32_t dest = 0x12345678;
+    setFields<Field<3, 29>, Field<3, 0>, Field<4, 5>>(dest,
+        0xFFFFFFFF, -4, State::SuperconductiveAtRoomTemperature);
+    REQUIRE(dest == expected);
+}
+
+TEST_CASE("setFields on a volatile 16-bit word.") {
+    volatile uint16_t dest = 0xFFFF;
+    setFields<Field<3, 13>, Field<3, 2>>(dest, 0, 0);
+    REQUIRE(dest == 0x1FE3);
+}
+
+TEST_CASE("setFields covering the whole word.") {
+    uint8_t dest = 0xA5;
+    setFields<Field<4, 4>, Field<4, 0>>(dest, 0x3, Ustate::CA);
+    REQUIRE(dest == 0x35);
+}
+
+namespace {
+
+enum class Op : uint8_t { NOP, ADDI, LOAD, STORE };
+
+typedef Field<4, 28, Op> Opcode;
+typedef Field<5, 23> Dest;
+typedef Field<5, 18> Source;
+typedef Field<18, 0, int32_t> Imm;
+typedef Layout<uint32_t, Opcode, Dest, Source, Imm> Insn;
+
+}
+
+TEST_CASE("Layout masks.") {
+    REQUIRE(Insn::FIELD_COUNT == 4);
+    REQUIRE(Insn::MASK == 0xFFFFFFFF);
+    REQUIRE(Insn::UNUSED_MASK == 0);
+    REQUIRE(Insn::IS_COMPLETE);
+    REQUIRE(Insn::fieldMask<Dest>() == 0x0F800000);
+
+    typedef Layout<uint16_t, Field<3, 13>, Field<3, 2>> Sparse;
+    REQUIRE(Sparse::MASK == 0xE01C);
+    REQUIRE(Sparse::UNUSED_MASK == 0x1FE3);
+    REQUIRE(!Sparse::IS_COMPLETE);
+}
+
+TEST_CASE("Layout pack, get, set and unpack.") {
+    uint32_t word = Insn::pack(Op::ADDI, 3, 7, -12);
+    REQUIRE(word == 0x119FFFF4);
+    REQUIRE(Insn::get<Opcode>(word) == Op::ADDI);
+    REQUIRE(Insn::get<Dest>(word) == 3);
+    REQUIRE(Insn::get<Source>(word) == 7);
+    REQUIRE(Insn::get<Imm>(word) == -12);
+
+    Insn::set<Opcode, Imm>(word, Op::STORE, 100);
+    REQUIRE(Insn::get<Opcode>(word) == Op::STORE);
+    REQUIRE(Insn::get<Imm>(word) == 100);
+    REQUIRE(Insn::get<Dest>(word) == 3);
+
+    REQUIRE(Insn::unpack(word) == std::make_tuple(Op::STORE, 3u, 7u, 100));
+}
+
+TEST_CASE("CompleteLayout accepts a layout covering the word.") {
+    typedef CompleteLayout<uint8_t, Field<4, 4>, Field<4, 0, int8_t>> Nibbles;
+    REQUIRE(Nibbles::pack(0xA, -1) == 0xAF);
+    REQUIRE(Nibbles::get<Field<4, 0, int8_t>>(0xAF) == -1);
+}
+
+TEST_CASE("Field functions are usable in constant expressions.") {
+    static_assert(getUbits<3, 29>(0xA0000F45u) == 5, "getUbits");
+    static_assert(getSbits<9, 0, int32_t>(0xA0000F45u) == -187, "getSbits");
+    static_assert(getBit<31>(0x80000000u), "getBit");
+    static_assert(withBit<2>(0u, true) == 0x4, "withBit");
+    static_assert(withBits<4, 5>(0xE0000007u, State::SuperconductiveAtRoomTemperature) == 0xE0000147,
+        "withBits");
+    static_assert(withFields<Field<3, 13>, Field<3, 2>>(static_cast<uint16_t>(0xFFFF), 0, 0) == 0x1FE3,
+        "withFields");
+    static_assert(Insn::pack(Op::ADDI, 3, 7, -12) == 0x119FFFF4, "Layout::pack");
+
+    constexpr uint32_t word = withBits<3, 0>(withBits<3, 29>(0u, 0xFFFFFFFF), -1);
+    REQUIRE(word == 0xE0000007);
+}
+
+#ifdef BITS_HAS_CXX14
+
+namespace {
+
+struct InsnTable {
+    uint32_t words[16];
+};
+
+constexpr InsnTable makeInsnTable() {
+    InsnTable table = {};
+    for (unsigned i = 0; i < 16; ++i) {
+        setBits<4, 28>(table.words[i], Op::LOAD);
+        setBits<5, 23>(table.words[i], i);
+        setFields<Source, Imm>(table.words[i], i + 1, -static_cast<int32_t>(i));
+        setBit<17>(table.words[i], i != 0); // the sign bit of Imm
+    }
+    return table;
+}
+
+constexpr InsnTable INSN_TABLE = makeInsnTable();
+
+}
+
+TEST_CASE("Constant tables built with setBits at compile time.") {
+    static_assert(Insn::get<Dest>(INSN_TABLE.words[5]) == 5, "table entry");
+    static_assert(getField<Imm>(INSN_TABLE.words[5]) == -5, "table entry");
+    for (unsigned i = 0; i < 16; ++i) {
+        REQUIRE(Insn::unpack(INSN_TABLE.words[i])
+            == std::make_tuple(Op::LOAD, i, i + 1, -static_cast<int32_t>(i)));
+    }
+}
+
+#endif
+
+namespace {
+
+// bit k of buf, counting the same way getUbitsAt does
+template<typename Word>
+unsigned long long referenceBitsAt(const Word* buf, size_t bitOffset, unsigned width) {
+    const unsigned wordBits = sizeof(Word) * BITS_IN_BYTE;
+    unsigned long long value = 0;
+    for (unsigned i = 0; i < width; ++i) {
+        const size_t bit = bitOffset + i;
+        value |= static_cast<unsigned long long>((buf[bit / wordBits] >> (bit % wordBits)) & 1) << i;
+    }
+    return value;
+}
+
+template<unsigned width, typename Word>
+void checkBitsAt() {
+    Word buf[80 / sizeof(Word)];
+    const size_t bufBits = sizeof(buf) * BITS_IN_BYTE;
+    test::Random random(width);
+    for (size_t i = 0; i < sizeof(buf); i += sizeof(uint64_t)) {
+        const uint64_t bytes = random.next();
+        memcpy(reinterpret_cast<unsigned char*>(buf) + i, &bytes, sizeof(bytes));
+    }
+    for (size_t offset = 0; offset + width <= bufBits; ++offset) {
+        REQUIRE(getUbitsAt<width>(buf, offset) == referenceBitsAt(buf, offset, width));
+
+        Word copy[sizeof(buf) / sizeof(Word)];
+        memcpy(copy, buf, sizeof(buf));
+        const unsigned long long value = ~referenceBitsAt(buf, offset, width);
+        setBitsAt<width>(copy, offset, value);
+        REQUIRE(getUbitsAt<width>(copy, offset) == (value & (~0ULL >> (64 - width))));
+        // everything outside the field is untouched
+        setBitsAt<width>(copy, offset, ~value);
+        REQUIRE(memcmp(copy, buf, sizeof(buf)) == 0);
+    }
+}
+
+}
+
+TEST_CASE("Fields that cross word boundaries.") {
+    checkBitsAt<1, uint8_t>();
+    checkBitsAt<12, uint8_t>();
+    checkBitsAt<12, uint32_t>();
+    checkBitsAt<20, uint16_t>();
+    checkBitsAt<20, uint64_t>();
+    checkBitsAt<36, uint32_t>();
+    checkBitsAt<36, uint64_t>();
+    checkBitsAt<57, uint8_t>();
+    checkBitsAt<60, uint64_t>();
+    checkBitsAt<64, uint8_t>();
+    checkBitsAt<64, uint32_t>();
+    checkBitsAt<64, uint64_t>();
+}
+
+TEST_CASE("Fields at compile-time bit offsets.") {
+    uint32_t buf[3] = { 0, 0, 0 };
+    setBitsAt<36, 28>(buf, 0x923456789ULL);
+    REQUIRE(buf[0] == 0x90000000);
+    REQUIRE(buf[1] == 0x92345678);
+    REQUIRE(buf[2] == 0);
+    REQUIRE((getUbitsAt<36, 28>(buf)) == 0x923456789ULL);
+    REQUIRE((getSbitsAt<36, 28, int64_t>(buf)) == static_cast<int64_t>(0x923456789ULL) - (1LL << 36));
+
+    setBitsAt<12, 60>(buf, -3);
+    REQUIRE((getSbitsAt<12, 60, int16_t>(buf)) == -3);
+    REQUIRE(buf[1] == 0xD2345678);
+    REQUIRE(buf[2] == 0xFF);
+    REQUIRE((getSbitsAt<20, int32_t>(buf, 28)) == 0x56789);
+}
+
+#if defined(__SIZEOF_INT128__)
+
+TEST_CASE("Fields of a 128-bit word.") {
+    __extension__ typedef unsigned __int128 Word128;
+    Word128 word = 0;
+    setBits<48, 72>(word, 0xABCDEF012345ULL);
+    setBits<20, 50>(word, -2);
+    setBit<127>(word, true);
+    REQUIRE(static_cast<uint64_t>(word >> 64) == 0x80ABCDEF0123453FULL);
+    REQUIRE(static_cast<uint64_t>(word) == 0xFFF8000000000000ULL);
+    REQUIRE(static_cast<uint64_t>(getUbits<48, 72>(word)) == 0xABCDEF012345ULL);
+    REQUIRE((getSbits<20, 50, int32_t>(word)) == -2);
+    REQUIRE(getBit<127>(word));
+    REQUIRE(!getBit<126>(word));
+
+    // the run-time functions must not truncate to 64 bits, with or without BMI
+    REQUIRE(static_cast<uint64_t>(getUbits(word, 16, 72)) == 0x2345);
+    REQUIRE(static_cast<uint64_t>(getUbits(word, 16, 70)) == static_cast<uint64_t>(getUbits<16, 70>(word)));
+    REQUIRE((getSbits<int32_t>(word, 20, 50)) == -2);
+    setBits(word, 24, 96, 0x123456);
+    REQUIRE(static_cast<uint64_t>(getUbits<24, 96>(word)) == 0x123456);
+    REQUIRE(static_cast<uint64_t>(word >> 64) == 0x801234560123453FULL);
+
+    typedef Field<16, 100> High;
+    typedef Field<8, 0> Low;
+    setFields<High, Low>(word, 0xBEEF, 0x42);
+    REQUIRE(static_cast<uint64_t>(getUbits<16, 100>(word)) == 0xBEEF);
+    REQUIRE(static_cast<uint64_t>(word) == 0xFFF8000000000042ULL);
+    const Word128 other = withFields<High>(word, 0x1234);
+    REQUIRE(static_cast<uint64_t>(getUbits(other, 16, 100)) == 0x1234);
+
+    typedef Layout<Word128, High, Field<20, 50, int32_t>, Low> Wide;
+    REQUIRE(static_cast<uint64_t>(Wide::MASK >> 64) == 0x000FFFF00000003FULL);
+    const Word128 packed = Wide::pack(0xBEEF, -2, 0x42);
+    REQUIRE(static_cast<uint64_t>(Wide::get<High>(packed)) == 0xBEEF);
+    REQUIRE(Wide::get<Field<20, 50, int32_t>>(packed) == -2);
+    REQUIRE(static_cast<uint64_t>(Wide::get<Low>(packed)) == 0x42);
+
+    // fields crossing 128-bit words, including ones that start in the high half
+    checkBitsAt<20, Word128>();
+    checkBitsAt<64, Word128>();
+}
+
+#endif
+
+TEST_CASE("Fields of a multi-limb word.") {
+    // a 256-bit descriptor
+    std::array<Limb, 4> desc = {{ 0, 0, 0, 0 }};
+    setBits<64, 0>(desc, 0x1122334455667788ULL);    // address, a whole limb
+    setBits<20, 54>(desc, 0xABCDE);                 // crosses limbs 0 and 1
+    setBits<12, 120>(desc, -5);                     // crosses limbs 1 and 2
+    setBits<64, 160>(desc, ~0ULL);                  // crosses limbs 2 and 3
+    setBit<255>(desc, false);
+    setBit<200>(desc, false);
+
+    REQUIRE(desc[0] == 0x37A2334455667788ULL);
+    REQUIRE(desc[1] == 0xFB000000000002AFULL);
+    REQUIRE(desc[2] == 0xFFFFFFFF0000000FULL);
+    REQUIRE(desc[3] == 0x00000000FFFFFEFFULL);
+
+    REQUIRE((getUbits<64, 0>(desc)) == 0x37A2334455667788ULL);
+    REQUIRE((getUbits<20, 54>(desc)) == 0xABCDE);
+    REQUIRE((getSbits<12, 120, int16_t>(desc)) == -5);
+    REQUIRE((getUbits<64, 160>(desc)) == 0xFFFFFEFFFFFFFFFFULL);
+    REQUIRE(!getBit<200>(desc));
+    REQUIRE(getBit<199>(desc));
+}
+
+TEST_CASE("MSB-first fields of an IPv4 header.") {
+    unsigned char header[20] = {
+        0x45, 0x00, 0x05, 0xDC, 0x1C, 0x46, 0x40, 0x00, 0x40, 0x06,
+        0xB1, 0xE6, 0xC0, 0xA8, 0x00, 0x68, 0xC0, 0xA8, 0x00, 0x01
+    };
+    REQUIRE((Msb0::getUbits<4, 0>(header)) == 4);           // version
+    REQUIRE((Msb0::getUbits<4, 4>(header)) == 5);           // IHL
+    REQUIRE((Msb0::getUbits<16, 16>(header)) == 1500);      // total length
+    REQUIRE((Msb0::getBit<49>(header)));                    // don't fragment
+    REQUIRE((Msb0::getUbits<13, 51>(header)) == 0);         // fragment offset
+    REQUIRE((Msb0::getUbits<32, 96>(header)) == 0xC0A80068);
+
+    Msb0::setBits<13, 51>(header, 0x1ABC);
+    REQUIRE(header[6] == 0x5A);
+    REQUIRE(header[7] == 0xBC);
+    REQUIRE((Msb0::getUbits<3, 48>(header)) == 2);
+    Msb0::setBit<49>(header, false);
+    REQUIRE(header[6] == 0x1A);
+
+    Msb0::setBits<8, 64>(header, 63);
+    REQUIRE((Msb0::getSbits<12, 60, int16_t>(header)) == 0xC3F - 0x1000);
+    Msb0::setBits<12, 60>(header, -2);
+    REQUIRE((Msb0::getSbits<12, 60, int16_t>(header)) == -2);
+    REQUIRE(header[7] == 0xBF);
+    REQUIRE(header[8] == 0xFE);
+}
+
+namespace {
+
+// bit k of buf in MSB-first order, most significant bit of the field first
+unsigned long long referenceMsbFirst(const unsigned char* buf, size_t bitOffset, unsigned width) {
+    unsigned long long value = 0;
+    for (unsigned i = 0; i < width; ++i) {
+        const size_t bit = bitOffset + i;
+        value = (value << 1) | ((buf[bit / 8] >> (7 - bit % 8)) & 1);
+    }
+    return value;
+}
+
+template<unsigned width>
+void checkMsbFirst() {
+    unsigned char buf[24];
+    for (size_t i = 0; i < sizeof(buf); ++i) {
+        buf[i] = static_cast<unsigned char>((i + 1) * 0x9D);
+    }
+    for (size_t offset = 0; offset + width <= sizeof(buf) * 8; ++offset) {
+        REQUIRE(Msb0::getUbits<width>(buf, offset) == referenceMsbFirst(buf, offset, width));
+        REQUIRE(Lsb0::getUbits<width>(buf, offset) == getUbitsAt<width>(buf, offset));
+
+        unsigned char copy[sizeof(buf)];
+        memcpy(copy, buf, sizeof(buf));
+        const unsigned long long value = ~referenceMsbFirst(buf, offset, width);
+        Msb0::setBits<width>(copy, offset, value);
+        REQUIRE(Msb0::getUbits<width>(copy, offset) == (value & (~0ULL >> (64 - width))));
+        Msb0::setBits<width>(copy, offset, ~value);
+        REQUIRE(memcmp(copy, buf, sizeof(buf)) == 0);
+    }
+}
+
+}
+
+TEST_CASE("MSB-first fields at every offset.") {
+    checkMsbFirst<1>();
+    checkMsbFirst<7>();
+    checkMsbFirst<12>();
+    checkMsbFirst<33>();
+    checkMsbFirst<57>();
+    checkMsbFirst<64>();
+}
+
+namespace {
+
+// a simulated device register that counts bus accesses
+struct SimulatedRegister {
+    uint32_t value;
+    bool writeOneToClear;
+    unsigned reads;
+    unsigned writes;
+};
+
+class SimulatedPort {
+public:
+    SimulatedPort(SimulatedRegister* reg) : reg_(reg) {}
+
+    uint32_t read() const {
+        ++reg_->reads;
+        return reg_->value;
+    }
+
+    void write(uint32_t word) const {
+        ++reg_->writes;
+        reg_->value = reg_->writeOneToClear ? reg_->value & ~word : word;
+    }
+
+private:
+    SimulatedRegister* reg_;
+};
+
+typedef Field<1, 0> Enable;
+typedef Field<3, 1> Mode;
+typedef Field<12, 4> Divisor;
+typedef Field<16, 16> Reserved;
+typedef Layout<uint32_t, Enable, Mode, Divisor, Reserved> Control;
+
+typedef Field<1, 0> RxReady;
+typedef Field<1, 1> TxEmpty;
+typedef Field<1, 2> Overrun;
+typedef Layout<uint32_t, RxReady, TxEmpty, Overrun> Status;
+
+}
+
+TEST_CASE("Register batches field writes into one read and one write.") {
+    SimulatedRegister sim = { 0xABCD0000, false, 0, 0 };
+    Register<Control, ReadWrite, SimulatedPort> control(&sim);
+    control.set<Enable, Mode, Divisor>(1, 5, 0x123);
+    REQUIRE(sim.reads == 1);
+    REQUIRE(sim.writes == 1);
+    REQUIRE(sim.value == 0xABCD123B);
+
+    REQUIRE(control.getFields<Mode, Divisor>() == std::make_tuple(5u, 0x123u));
+    REQUIRE(sim.reads == 2);
+
+    // setting every field doesn't need the old value
+    control.set<Enable, Mode, Divisor, Reserved>(0, 0, 0, 0);
+    control.pack(1, 2, 3, 4);
+    REQUIRE(sim.reads == 2);
+    REQUIRE(sim.writes == 3);
+    REQUIRE(sim.value == 0x00040035);
+}
+
+TEST_CASE("Register over volatile memory.") {
+    volatile uint32_t reg = 0;
+    Register<Control> control(&reg);
+    control.set<Divisor>(26);
+    REQUIRE(reg == 26 << 4);
+    REQUIRE(control.get<Divisor>() == 26);
+}
+
+TEST_CASE("WriteOnly registers update a shadow without reading.") {
+    SimulatedRegister sim = { 0, false, 0, 0 };
+    Register<Control, WriteOnly, SimulatedPort> control(&sim, 0x00010000);
+    control.set<Enable>(1);
+    control.set<Mode, Divisor>(3, 7);
+    REQUIRE(sim.reads == 0);
+    REQUIRE(sim.writes == 2);
+    REQUIRE(sim.value == 0x00010077);
+    REQUIRE(control.get<Reserved>() == 1);
+    REQUIRE(sim.reads == 0);
+}
+
+TEST_CASE("WriteOneToClear registers are cleared without reading.") {
+    SimulatedRegister sim = { 0x7, true, 0, 0 };
+    Register<Status, WriteOneToClear, SimulatedPort> status(&sim);
+    status.clear<RxReady, Overrun>();
+    REQUIRE(sim.reads == 0);
+    REQUIRE(sim.writes == 1);
+    REQUIRE(sim.value == 0x2);
+
+    // only the bits that were seen set are cleared
+    sim.value = 0x5;
+    REQUIRE(status.acknowledge<RxReady, TxEmpty>() == 0x5);
+    REQUIRE(sim.reads == 1);
+    REQUIRE(sim.writes == 2);
+    REQUIRE(sim.value == 0x4);
+}
+
+TEST_CASE("ReadOnly registers are read once per call.") {
+    SimulatedRegister sim = { 0x6, false, 0, 0 };
+    const Register<Status, ReadOnly, SimulatedPort> status(&sim);
+    REQUIRE(status.getFields<RxReady, TxEmpty, Overrun>() == std::make_tuple(0u, 1u, 1u));
+    REQUIRE(sim.reads == 1);
+    REQUIRE(sim.writes == 0);
+}
@@ -0,0 +1,95 @@
+#include "doctest.h"
+#include "packed_vector.hpp"
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+// A deterministic sequence that exercises every bit of a width-bit field.
+uint32_t testValue(size_t i) {
+    return static_cast<uint32_t>((i + 1) * 0x9E3779B9U ^ (i >> 3));
+}
+
+template<unsigned width, bool Signed>
+void checkPackedVector(size_t n) {
+    typedef PackedVector<width, Signed> Vector;
+    typedef typename Vector::ValueType ValueType;
+    Vector packed;
+    std::vector<ValueType> expected;
+    for (size_t i = 0; i < n; ++i) {
+        const ValueType value = static_cast<ValueType>(testValue(i));
+        packed.push_back(value);
+        if (Signed) {
+            expected.push_back(static_cast<ValueType>(getSbits<width, 0, int64_t>(static_cast<uint64_t>(value))));
+        } else {
+            expected.push_back(static_cast<ValueType>(getUbits<width, 0>(static_cast<uint64_t>(value))));
+        }
+    }
+    REQUIRE(packed.size() == n);
+    for (size_t i = 0; i < n; ++i) {
+        REQUIRE(packed[i] == expected[i]);
+    }
+
+    // unpack ranges that start and end on and off group boundaries
+    const size_t bounds[][2] = { {0, n}, {3, n - 5}, {8, 40}, {13, 14}, {n, n} };
+    for (size_t b = 0; b < sizeof(bounds) / sizeof(bounds[0]); ++b) {
+        std::vector<ValueType> out(n + 1);
+        packed.unpack(bounds[b][0], bounds[b][1], out.data());
+        for (size_t i = bounds[b][0]; i < bounds[b][1]; ++i) {
+            REQUIRE(out[i - bounds[b][0]] == expected[i]);
+        }
+    }
+
+    // pack a middle range back in reverse and check its neighbours are intact
+    std::vector<ValueType> reversed(expected.rbegin(), expected.rend());
+    packed.pack(7, reversed.data() + 7, n - 20);
+    for (size_t i = 0; i < n; ++i) {
+        const bool inRange = i >= 7 && i < 7 + n - 20;
+        REQUIRE(packed[i] == (inRange ? reversed[i] : expected[i]));
+    }
+}
+
+}
+
+TEST_CASE("PackedVector push_back, random access, unpack and pack.") {
+    checkPackedVector<1, false>(200);
+    checkPackedVector<5, false>(200);
+    checkPackedVector<5, true>(200);
+    checkPackedVector<13, false>(301);
+    checkPackedVector<17, true>(301);
+    checkPackedVector<25, false>(150);
+    checkPackedVector<25, true>(150);
+    checkPackedVector<31, true>(150);
+    checkPackedVector<32, false>(150);
+}
+
+TEST_CASE("PackedVector set across a word boundary.") {
+    PackedVector<12> packed(10);
+    packed.set(5, 0xABC); // bits 60..71
+    REQUIRE(packed[5] == 0xABC);
+    REQUIRE(packed[4] == 0);
+    REQUIRE(packed[6] == 0);
+    REQUIRE(packed.data()[0] == 0xC000000000000000ULL);
+    REQUIRE(packed.data()[1] == 0xAB);
+    packed.set(5, 0x1FFF); // truncated to 12 bits like setBits
+    REQUIRE(packed[5] == 0xFFF);
+}
+
+TEST_CASE("PackedVector resize and append.") {
+    PackedVector<7, true> packed(3, -2);
+    REQUIRE(packed[2] == -2);
+    packed.resize(1);
+    packed.resize(4);
+    REQUIRE(packed[0] == -2);
+    REQUIRE(packed[1] == 0);
+    REQUIRE(packed[3] == 0);
+    const int32_t values[] = { 63, -64, 5 };
+    packed.append(values, 3);
+    REQUIRE(packed.size() == 7);
+    REQUIRE(packed[4] == 63);
+    REQUIRE(packed[5] == -64);
+    REQUIRE(packed[6] == 5);
+    REQUIRE(packed.memoryBytes() == 3 * sizeof(uint64_t));
+}
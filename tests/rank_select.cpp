@@ -0,0 +1,88 @@
+#include "doctest.h"
+#include "rank_select.hpp"
+#include "test_util.hpp"
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+void checkRankSelect(const Bitset& bits, unsigned threads) {
+    const RankSelectBitVector vector(bits, threads);
+    REQUIRE(vector.size() == bits.size());
+    REQUIRE(vector.count() == bits.count());
+    size_t rank = 0;
+    for (size_t i = 0; i < bits.size(); ++i) {
+        REQUIRE(vector.rank1(i) == rank);
+        if (bits[i]) {
+            REQUIRE(vector[i]);
+            REQUIRE(vector.select1(rank) == i);
+            ++rank;
+        }
+    }
+    REQUIRE(vector.rank1(bits.size()) == rank);
+    REQUIRE(vector.rank0(bits.size()) == bits.size() - rank);
+}
+
+}
+
+TEST_CASE("In-word select.") {
+    REQUIRE(detail::selectInWord(1, 0) == 0);
+    REQUIRE(detail::selectInWord(0x8000000000000000ULL, 0) == 63);
+    const uint64_t word = 0xF0F0000000000F01ULL;
+    const unsigned positions[] = { 0, 8, 9, 10, 11, 52, 53, 54, 55, 60, 61, 62, 63 };
+    for (unsigned r = 0; r < 13; ++r) {
+        REQUIRE(detail::selectInWord(word, r) == positions[r]);
+    }
+    for (unsigned r = 0; r < 64; ++r) {
+        REQUIRE(detail::selectInWord(~0ULL, r) == r);
+    }
+
+    // random words of varying density against a bit-by-bit scan
+    test::Random random(7);
+    for (unsigned i = 0; i < 2000; ++i) {
+        const uint64_t x = random.next();
+        const uint64_t w = i % 3 == 0 ? x & random.next() : i % 3 == 1 ? x : x | random.next();
+        unsigned r = 0;
+        for (unsigned pos = 0; pos < 64; ++pos) {
+            if ((w >> pos) & 1) {
+                REQUIRE(detail::selectInWord(w, r) == pos);
+                ++r;
+            }
+        }
+    }
+}
+
+TEST_CASE("RankSelectBitVector agrees with counting bit by bit.") {
+    const size_t sizes[] = { 0, 1, 64, 2047, 2048, 2049, 20000 };
+    const unsigned densities[] = { 1, 2, 9, 1000 };
+    for (size_t s = 0; s < 7; ++s) {
+        for (unsigned d = 0; d < 4; ++d) {
+            checkRankSelect(test::randomBits(sizes[s], densities[d], s * 4 + d), 1);
+        }
+    }
+}
+
+TEST_CASE("RankSelectBitVector built by several threads.") {
+    // large enough for the parallel build, with long runs of zeros between
+    // select samples
+    Bitset bits = test::randomBits(9000000, 3, 7);
+    for (size_t i = 3000000; i < 6000000; ++i) {
+        bits.reset(i);
+    }
+    const RankSelectBitVector serial(bits, 1);
+    const RankSelectBitVector parallel(bits, 4);
+    REQUIRE(parallel.count() == serial.count());
+    REQUIRE(parallel.indexBytes() == serial.indexBytes());
+    REQUIRE(parallel.indexBytes() * 8 < bits.size() / 25);
+    for (size_t i = 0; i <= bits.size(); i += 997) {
+        REQUIRE(parallel.rank1(i) == serial.rank1(i));
+    }
+    for (size_t k = 0; k < serial.count(); k += 1009) {
+        const size_t pos = serial.select1(k);
+        REQUIRE(parallel.select1(k) == pos);
+        REQUIRE(bits[pos]);
+        REQUIRE(serial.rank1(pos) == k);
+    }
+}
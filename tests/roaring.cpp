@@ -0,0 +1,196 @@
+#include "doctest.h"
+#include "roaring.hpp"
+#include "test_util.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <vector>
+
+using namespace bits;
+
+namespace {
+
+const size_t UNIVERSE = 4 * 65536 + 1000;
+
+/**
+ * Bits set with probability 1 / density, plus runs of 3000 set bits every
+ * runEvery bits when runEvery != 0. Chunk 2 is left empty.
+ */
+Bitset randomBits(unsigned density, size_t runEvery, uint64_t seed) {
+    Bitset bits(UNIVERSE);
+    test::Random random(seed);
+    for (size_t i = 0; i < UNIVERSE; ++i) {
+        const bool inRun = runEvery != 0 && i % runEvery < 3000;
+        if ((inRun || random.next() % density == 0) && i >> 16 != 2) {
+            bits.set(i);
+        }
+    }
+    return bits;
+}
+
+std::vector<uint32_t> indexes(const Bitset& bits) {
+    std::vector<uint32_t> out(bits.count());
+    bits.setBitIndexes(out.data());
+    return out;
+}
+
+std::vector<uint32_t> indexes(const RoaringBitmap& bitmap) {
+    std::vector<uint32_t> out(bitmap.count());
+    REQUIRE(bitmap.setBitIndexes(out.data()) == out.size());
+    std::vector<uint32_t> visited;
+    bitmap.forEachSetBit([&](uint32_t i) { visited.push_back(i); });
+    REQUIRE(visited == out);
+    return out;
+}
+
+void checkSame(const RoaringBitmap& bitmap, const Bitset& bits) {
+    REQUIRE(bitmap.count() == bits.count());
+    REQUIRE(indexes(bitmap) == indexes(bits));
+    REQUIRE(bitmap == RoaringBitmap(bits));
+}
+
+}
+
+TEST_CASE("RoaringBitmap set, reset and test.") {
+    RoaringBitmap bitmap;
+    REQUIRE(bitmap.none());
+    bitmap.set(7).set(70000).set(0xFFFFFFFFu);
+    REQUIRE(bitmap.count() == 3);
+    REQUIRE(bitmap.test(7));
+    REQUIRE(bitmap[70000]);
+    REQUIRE(bitmap.test(0xFFFFFFFFu));
+    REQUIRE_FALSE(bitmap.test(8));
+    REQUIRE_FALSE(bitmap.test(7 + 65536));
+
+    // one chunk through the array limit and back
+    for (uint32_t i = 0; i < 5000; ++i) {
+        bitmap.set(i * 13);
+    }
+    REQUIRE(bitmap.count() == 5003);
+    const size_t bitmapBytes = bitmap.memoryBytes();
+    REQUIRE(bitmapBytes > 8192);
+    for (uint32_t i = 0; i < 5000; i += 2) {
+        bitmap.reset(i * 13);
+    }
+    REQUIRE(bitmap.count() == 2503);
+    REQUIRE(bitmap.memoryBytes() < bitmapBytes);
+    for (uint32_t i = 0; i < 5000; ++i) {
+        REQUIRE(bitmap.test(i * 13) == (i % 2 == 1));
+    }
+
+    bitmap.reset(70000).reset(70001);
+    REQUIRE_FALSE(bitmap.test(70000));
+    REQUIRE(bitmap.count() == 2502);
+}
+
+TEST_CASE("RoaringBitmap agrees with Bitset.") {
+    const unsigned densities[] = { 1000, 20, 9, 2 };
+    const size_t runs[] = { 0, 0, 0, 0, 20000, 70000 };
+    for (unsigned d = 0; d < 4; ++d) {
+        for (unsigned r = 0; r < 6; ++r) {
+            const Bitset bits = randomBits(densities[d], runs[r], d * 6 + r);
+            RoaringBitmap bitmap;
+            bits.forEachSetBit([&](size_t i) { bitmap.set(static_cast<uint32_t>(i)); });
+            checkSame(bitmap, bits);
+            bitmap.runOptimize();
+            checkSame(bitmap, bits);
+            for (size_t i = 0; i < UNIVERSE; i += 7) {
+                REQUIRE(bitmap.test(static_cast<uint32_t>(i)) == bits.test(i));
+            }
+        }
+    }
+}
+
+TEST_CASE("RoaringBitmap set operations.") {
+    // sparse arrays, dense bitmaps and runs, each against the others
+    const unsigned densities[] = { 1000, 300, 3, 100000 };
+    const size_t runs[] = { 0, 0, 0, 25000 };
+    for (unsigned i = 0; i < 4; ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            const Bitset a = randomBits(densities[i], runs[i], i + 1);
+            const Bitset b = randomBits(densities[j], runs[j], j + 11);
+            for (unsigned optimize = 0; optimize < 4; ++optimize) {
+                RoaringBitmap ra(a);
+                RoaringBitmap rb(b);
+                if (optimize & 1) {
+                    ra.runOptimize();
+                }
+                if (optimize & 2) {
+                    rb.runOptimize();
+                }
+                checkSame(ra & rb, a & b);
+                checkSame(ra | rb, a | b);
+                Bitset difference = a;
+                difference.andNot(b);
+                checkSame(RoaringBitmap(ra).andNot(rb), difference);
+                REQUIRE(andCount(ra, rb) == andCount(a, b));
+                REQUIRE(orCount(ra, rb) == orCount(a, b));
+                REQUIRE(andNotCount(ra, rb) == andNotCount(a, b));
+                REQUIRE((ra == rb) == (a == b));
+            }
+        }
+    }
+}
+
+TEST_CASE("RoaringBitmap ranges and runs.") {
+    RoaringBitmap bitmap;
+    bitmap.setRange(100, 200000);
+    bitmap.setRange(300000, 300001);
+    REQUIRE(bitmap.count() == 199901);
+    REQUIRE(bitmap.test(100));
+    REQUIRE(bitmap.test(199999));
+    REQUIRE_FALSE(bitmap.test(200000));
+    REQUIRE_FALSE(bitmap.test(99));
+
+    const RoaringBitmap plain = bitmap;
+    bitmap.runOptimize();
+    REQUIRE(bitmap == plain);
+    REQUIRE(bitmap.memoryBytes() < 64);
+    REQUIRE(bitmap.count() == 199901);
+    REQUIRE(indexes(bitmap) == indexes(plain));
+
+    // changing a run chunk turns it back into a bitmap
+    bitmap.reset(150000);
+    REQUIRE_FALSE(bitmap.test(150000));
+    REQUIRE(bitmap.count() == 199900);
+    REQUIRE(bitmap.memoryBytes() > 8192);
+}
+
+TEST_CASE("Array intersection and difference kernels.") {
+    test::Random random(99);
+    for (unsigned trial = 0; trial < 200; ++trial) {
+        std::vector<uint16_t> a;
+        std::vector<uint16_t> b;
+        const unsigned density = 1 + trial % 7;
+        for (uint32_t v = 0; v < 2000; ++v) {
+            if (random.next() % density == 0) {
+                a.push_back(static_cast<uint16_t>(v));
+            }
+            if (random.next() % (8 - density) == 0) {
+                b.push_back(static_cast<uint16_t>(v));
+            }
+        }
+        a.resize(a.size() * (trial % 5 + 1) / 5);
+        std::vector<detail::ArrayOpFn> intersect(1, &detail::intersectArrays);
+        std::vector<detail::ArrayOpFn> difference(1, &detail::differenceArrays);
+#if defined(BITS_X86)
+        if (cpuFeatures().sse42 && cpuFeatures().popcnt) {
+            intersect.push_back(&detail::intersectArraysSse42);
+            difference.push_back(&detail::differenceArraysSse42);
+        }
+#endif
+        std::vector<uint16_t> expected(a.size() + detail::ROARING_ARRAY_PADDING);
+        std::vector<uint16_t> got(a.size() + detail::ROARING_ARRAY_PADDING);
+        const size_t both = detail::intersectArraysPortable(a.data(), a.size(), b.data(), b.size(), expected.data());
+        for (size_t k = 0; k < intersect.size(); ++k) {
+            REQUIRE(intersect[k](a.data(), a.size(), b.data(), b.size(), got.data()) == both);
+            REQUIRE(std::equal(expected.begin(), expected.begin() + both, got.begin()));
+            REQUIRE(intersect[k](a.data(), a.size(), b.data(), b.size(), nullptr) == both);
+        }
+        const size_t onlyA = detail::differenceArraysPortable(a.data(), a.size(), b.data(), b.size(), expected.data());
+        for (size_t k = 0; k < difference.size(); ++k) {
+            REQUIRE(difference[k](a.data(), a.size(), b.data(), b.size(), got.data()) == onlyA);
+            REQUIRE(std::equal(expected.begin(), expected.begin() + onlyA, got.begin()));
+            REQUIRE(difference[k](a.data(), a.size(), b.data(), b.size(), nullptr) == onlyA);
+        }
+    }
+}
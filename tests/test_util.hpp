@@ -0,0 +1,47 @@
+#ifndef BITS_TEST_UTIL_HPP
+#define BITS_TEST_UTIL_HPP
+
+// Random test data shared by the test files. The sequences are fixed per
+// seed so a failure reproduces.
+
+#include "bitset.hpp"
+#include <cinttypes>
+#include <cstddef>
+
+namespace test {
+
+/**
+ * xorshift64: fast, and good enough for test inputs.
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed) : x_(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+    uint64_t next() {
+        x_ ^= x_ << 13;
+        x_ ^= x_ >> 7;
+        x_ ^= x_ << 17;
+        return x_;
+    }
+
+private:
+    uint64_t x_;
+};
+
+/**
+ * A set of size bits with each bit set with probability 1 / density.
+ */
+inline bits::Bitset randomBits(size_t size, unsigned density, uint64_t seed) {
+    bits::Bitset set(size);
+    Random random(seed);
+    for (size_t i = 0; i < size; ++i) {
+        if (random.next() % density == 0) {
+            set.set(i);
+        }
+    }
+    return set;
+}
+
+}
+
+#endif